@@ -35,19 +35,58 @@ FocusScope {
     /*! This property holds instance of SynoAlbum */
     readonly property var synoAlbum: internal.synoAlbumWrapper ? internal.synoAlbumWrapper.object : null
 
+    /*! This property holds sorting and filtering layer of the album */
+    readonly property alias albumProxy: _albumProxy
+
     /*! This property holds id of selected image */
     readonly property var selectedImageId: _view.currentItem ? _view.currentItem.imageId : null
 
     /*! This property holds current item of the view */
     readonly property alias currentItem: _view.currentItem
 
-    /*! This method assigns album wrapper object */
-    function setAlbumWrapper(albumWrapper, forceRefresh) {
+    /*! This method assigns album wrapper object, optionally with vertical scroll position to restore */
+    function setAlbumWrapper(albumWrapper, forceRefresh, contentY) {
+        // album which is not displayed anymore yields the connection, and keeps the position for back navigation
+        if (root.synoAlbum && root.synoAlbum !== albumWrapper.object) {
+            root.synoAlbum.viewIndex = _view.currentIndex;
+            root.synoAlbum.isActive = false;
+        }
+
         if (albumWrapper.object) {
+            if (albumWrapper.object !== root.synoAlbum) {
+                internal.pendingViewIndex = albumWrapper.object.viewIndex;
+                internal.pendingContentY = contentY !== undefined ? contentY : -1;
+            }
+            albumWrapper.object.isActive = true;
             albumWrapper.object.refresh(forceRefresh);
         }
 
         internal.synoAlbumWrapper = albumWrapper;
+
+        // child albums are loaded ahead while the user looks at this one
+        SynoAlbumFactory.setDisplayedAlbum(root.synoAlbum);
+
+        Qt.callLater(internal.restoreViewIndex);
+    }
+
+    /*! This method persists the displayed album with the visible items for the next launch */
+    function saveSession() {
+        if (!root.synoAlbum || _view.count === 0) {
+            return;
+        }
+
+        let firstIndex = _view.indexAt(_view.contentX + 1, _view.contentY + 1);
+        let lastIndex = _view.indexAt(_view.contentX + _view.width - 1, _view.contentY + _view.height - 1);
+        firstIndex = firstIndex !== -1 ? firstIndex : 0;
+        lastIndex = lastIndex !== -1 ? lastIndex : _view.count - 1;
+        lastIndex = Math.min(lastIndex, firstIndex + internal.maxSessionRows - 1);
+
+        let rows = [];
+        for (let i = firstIndex; i <= lastIndex; ++i) {
+            rows.push(_albumProxy.mapToSource(_albumProxy.index(i, 0)).row);
+        }
+
+        SynoSessionSnapshot.save(root.synoAlbum, rows, _view.currentIndex, _view.contentY);
     }
 
     focus: true
@@ -113,9 +152,21 @@ FocusScope {
                 verticalAlignment: Qt.AlignVCenter
                 Layout.fillWidth: true
             }
+
+            Label {
+                text: qsTr("(cached)")
+                visible: root.synoAlbum ? root.synoAlbum.isStale : false
+                color: Assets.appPalette.mid
+                verticalAlignment: Qt.AlignVCenter
+            }
         }
     }
 
+    SynoAlbumProxy {
+        id: _albumProxy
+        album: root.synoAlbum
+    }
+
     MouseArea {
         anchors.fill: _view
         onPressed: {
@@ -147,11 +198,11 @@ FocusScope {
             active: true
         }
 
-        model: root.synoAlbum
+        model: _albumProxy
         delegate: Rectangle {
             id: _delegate
 
-            readonly property var imageId: model.synoData.id
+            readonly property var imageId: model.itemId
 
             width: _view.cellWidth - 4
             height: _view.cellHeight - 4
@@ -216,6 +267,8 @@ FocusScope {
         }
 
         onCountChanged: {
+            internal.restoreViewIndex();
+
             if (currentIndex === -1 && count > 0) {
                 currentIndex = 0;
                 positionViewAtBeginning();
@@ -256,8 +309,30 @@ FocusScope {
 
         property var synoAlbumWrapper: null
 
+        /*! Index of the current item to be restored once the album has enough items, or -1 */
+        property int pendingViewIndex: -1
+
+        /*! Vertical scroll position to be restored along with the current item, or -1 */
+        property real pendingContentY: -1
+
+        /*! Maximum amount of visible items persisted on exit */
+        readonly property int maxSessionRows: 200
+
+        function restoreViewIndex() {
+            if (pendingViewIndex >= 0 && pendingViewIndex < _view.count) {
+                _view.currentIndex = pendingViewIndex;
+                if (pendingContentY >= 0) {
+                    _view.contentY = pendingContentY;
+                } else {
+                    _view.positionViewAtIndex(pendingViewIndex, GridView.Center);
+                }
+                pendingViewIndex = -1;
+                pendingContentY = -1;
+            }
+        }
+
         function openCurrentIndex() {
-            var synoData = root.synoAlbum.get(_view.currentIndex);
+            var synoData = _albumProxy.get(_view.currentIndex);
             switch (synoData.type) {
             case "album":
                 let albumWrapper = SynoAlbumFactory.createAlbumForData(synoData);
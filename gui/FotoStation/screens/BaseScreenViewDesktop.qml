@@ -61,6 +61,30 @@ FocusScope {
 
             orientation: Qt.Vertical
 
+            Rectangle {
+                color: Assets.appPalette.shadow
+
+                SplitView.minimumHeight: 100
+                SplitView.preferredHeight: root.height / 4
+
+                Rectangle {
+                    color: Assets.appPalette.window
+
+                    anchors.fill: parent
+                    anchors.margins: 1
+                }
+
+                SearchView {
+                    anchors.fill: parent
+                    anchors.margins: 1
+
+                    onAlbumRequested: {
+                        _albumView.setAlbumWrapper(SynoAlbumFactory.createAlbumForPath(path));
+                        _albumView.forceActiveFocus();
+                    }
+                }
+            }
+
             Rectangle {
                 color: Assets.appPalette.shadow
 
@@ -108,9 +132,29 @@ FocusScope {
                 anchors.margins: 1
 
                 Component.onCompleted: {
-                    setAlbumWrapper(SynoAlbumFactory.createAlbumForPath());
+                    // the last session is displayed at once, and is reconciled once the session is restored
+                    let snapshotWrapper = SynoSessionSnapshot.createAlbum();
+                    if (snapshotWrapper) {
+                        setAlbumWrapper(snapshotWrapper, false, SynoSessionSnapshot.contentY);
+                    } else {
+                        setAlbumWrapper(SynoAlbumFactory.createAlbumForPath());
+                    }
                     forceActiveFocus();
                 }
+
+                Connections {
+                    target: SynoSessionSnapshot
+                    function onDiscarded() {
+                        _albumView.setAlbumWrapper(SynoAlbumFactory.createAlbumForPath());
+                    }
+                }
+
+                Connections {
+                    target: Qt.application
+                    function onAboutToQuit() {
+                        _albumView.saveSession();
+                    }
+                }
             }
         }
     }
@@ -74,6 +74,8 @@ Rectangle {
             text: {
                 if (Facade.isConnecting) {
                     return qsTr("Connecting...");
+                } else if (SynoPS.conn.status === SynoConn.OFFLINE) {
+                    return qsTr("Offline, reconnecting...");
                 } else if(SynoPS.conn.auth.status === SynoAuth.AUTHORIZED) {
                     return qsTr("Logged in as: %1").arg(SynoPS.conn.auth.username);
                 } else {
@@ -0,0 +1,108 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2019 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import QtQuick 2.15
+import QtQuick.Controls 2.15
+
+import FotoStation 1.0
+import FotoStation.assets 1.0
+import FotoStation.native 1.0
+import FotoStation.widgets 1.0
+
+FocusScope {
+    id: root
+
+    /*! This signal is emitted when an album should be opened */
+    signal albumRequested(string path)
+
+    FSTextField {
+        id: _queryField
+
+        anchors.top: parent.top
+        anchors.left: parent.left
+        anchors.right: parent.right
+        anchors.margins: 4
+
+        placeholderText: qsTr("Search")
+        focus: true
+    }
+
+    SynoSearchModel {
+        id: _searchModel
+        query: _queryField.text
+    }
+
+    ListView {
+        id: _view
+
+        readonly property int thumbSize: 48
+
+        anchors.top: _queryField.bottom
+        anchors.bottom: parent.bottom
+        anchors.left: parent.left
+        anchors.right: parent.right
+        anchors.margins: 4
+
+        clip: true
+        spacing: 2
+
+        ScrollBar.vertical: ScrollBar {}
+
+        model: _searchModel
+        delegate: Rectangle {
+            width: _view.width
+            height: _view.thumbSize
+
+            color: index === _view.currentIndex ? Assets.appPalette.highlight : Assets.appPalette.window
+
+            FSCoverArt {
+                id: _cover
+                anchors.left: parent.left
+                anchors.verticalCenter: parent.verticalCenter
+                width: _view.thumbSize
+                height: _view.thumbSize
+                sourceSizeHeight: height
+                sourceSizeWidth: width
+                source: Facade.coverThumbUrl(model.itemId)
+                fillMode: Image.PreserveAspectCrop
+            }
+
+            Text {
+                anchors.left: _cover.right
+                anchors.right: parent.right
+                anchors.leftMargin: 4
+                anchors.verticalCenter: parent.verticalCenter
+                text: model.display
+                color: index === _view.currentIndex ? Assets.appPalette.highlightedText : Assets.appPalette.text
+                elide: Text.ElideRight
+            }
+
+            MouseArea {
+                anchors.fill: parent
+                onClicked: {
+                    _view.currentIndex = index;
+                }
+                onDoubleClicked: {
+                    _view.currentIndex = index;
+                    // albums are opened as is, other items are shown in their album
+                    root.albumRequested(model.itemType === "album" ? model.synoData.path : model.albumPath);
+                }
+            }
+        }
+    }
+}
@@ -135,6 +135,16 @@ ApplicationWindow {
         }
     }
 
+    Loader {
+        id: _autoLoginLoader
+        objectName: "AutoLoginLoader"
+
+        // login form restores the session in background, while the snapshot of the last session is displayed
+        active: false
+        visible: false
+        source: internal.loginViewUrl
+    }
+
     Loader {
         id: _overlayManager
         objectName: "OverlayManagerLoader"
@@ -183,6 +193,18 @@ ApplicationWindow {
         }
     }
 
+    Connections {
+        target: Facade
+        function onIsConnectingChanged() {
+            // the session is not restored automatically, the user logs in
+            if (_autoLoginLoader.active && !Facade.isConnecting
+                && SynoPS.conn.auth.status !== SynoAuth.AUTHORIZED) {
+                _autoLoginLoader.active = false;
+                internal.showAuthorizationForm();
+            }
+        }
+    }
+
     QtObject {
         id: internal
 
@@ -253,8 +275,13 @@ ApplicationWindow {
         }
 
         function processConnectionStatusChange() {
-            if (SynoPS.conn.status === SynoConn.API_LOADED
-                && SynoPS.conn.auth.status === SynoAuth.AUTHORIZED) {
+            // the session could be resumed in offline mode, when the service is unreachable at launch
+            let isSessionActive = (SynoPS.conn.status === SynoConn.API_LOADED
+                                   || SynoPS.conn.status === SynoConn.OFFLINE)
+                                  && SynoPS.conn.auth.status === SynoAuth.AUTHORIZED;
+
+            if (isSessionActive) {
+                _autoLoginLoader.active = false;
                 internal.showBaseScreenViewForm();
             } else if (SynoPS.conn.status === SynoConn.NONE) {
                 internal.showAuthorizationForm();
@@ -265,7 +292,12 @@ ApplicationWindow {
     Component.onCompleted: {
         Assets.appPalette = Qt.binding(function() { return root.palette; });
 
-        internal.showAuthorizationForm();
+        if (SynoSessionSnapshot.isAvailable && Facade.autoLoginAllowed) {
+            internal.showBaseScreenViewForm();
+            _autoLoginLoader.active = true;
+        } else {
+            internal.showAuthorizationForm();
+        }
 
         _appStyler.ensureStyleApplied(root, function() {
             internal.restoreWindowGeometry();
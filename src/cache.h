@@ -116,6 +116,13 @@ public:
 
     inline bool contains(const Key &key) const { return hash.contains(key); }
 
+    /*! Returns the object without marking it as recently used */
+    T peek(const Key& key, const T& def = T()) const;
+    /*! Returns keys in order of usage, from the least recently used one */
+    QList<Key> keysByUsage() const;
+    /*! Changes cost of the object without marking it as recently used; the cache is not trimmed */
+    bool setCost(const Key& key, int cost);
+
     T operator[](const Key &key);
 
     bool remove(const Key &key);
@@ -191,6 +198,39 @@ template <class Key, class T>
 inline T Cache<Key,T>::operator[](const Key &key)
 { return object(key); }
 
+template <class Key, class T>
+inline T Cache<Key,T>::peek(const Key &key, const T& def) const
+{
+    typename QHash<Key, Node>::const_iterator i = hash.constFind(key);
+    return i == hash.constEnd() ? def : i->t;
+}
+
+template <class Key, class T>
+inline QList<Key> Cache<Key,T>::keysByUsage() const
+{
+    QList<Key> result;
+    result.reserve(hash.size());
+    for (Node *n = l; n; n = n->p) {
+        result.append(*n->keyPtr);
+    }
+    return result;
+}
+
+template <class Key, class T>
+inline bool Cache<Key,T>::setCost(const Key &key, int cost)
+{
+    Q_ASSERT(cost > 0);
+
+    typename QHash<Key, Node>::iterator i = hash.find(key);
+    if (i == hash.end()) {
+        return false;
+    }
+
+    total += cost - i->c;
+    i->c = cost;
+    return true;
+}
+
 template <class Key, class T>
 inline bool Cache<Key,T>::remove(const Key &key)
 {
@@ -38,19 +38,34 @@ HEADERS += \
     $$PWD/synoalbum.h \
     $$PWD/synoalbumcache.h \
     $$PWD/synoalbumdata.h \
+    $$PWD/synoalbumpager.h \
+    $$PWD/synoalbumprefetcher.h \
+    $$PWD/synoalbumproxy.h \
+    $$PWD/synoalbumreplycache.h \
+    $$PWD/synoalbumreplyparser.h \
     $$PWD/synoalbumfactory.h \
     $$PWD/synoauth.h \
     $$PWD/synoconn.h \
+    $$PWD/synocontenttype.h \
     $$PWD/synoerror.h \
     $$PWD/synoimagecache.h \
+    $$PWD/synoimagediskcache.h \
     $$PWD/synoimageprovider.h \
     $$PWD/synoimageprovider_p.h \
+    $$PWD/synolibrarycrawler.h \
+    $$PWD/synolibraryindex.h \
     $$PWD/synops.h \
     $$PWD/synoreplyjson.h \
     $$PWD/synorequest.h \
+    $$PWD/synorequesthandle.h \
+    $$PWD/synosearchindex.h \
+    $$PWD/synosearchmodel.h \
+    $$PWD/synosessionsnapshot.h \
     $$PWD/synosettings.h \
     $$PWD/synosize.h \
     $$PWD/synosslconfig.h \
+    $$PWD/synotimeline.h \
+    $$PWD/synotimelinemodel.h \
     $$PWD/synotraits.h
 
 SOURCES += \
@@ -61,18 +76,32 @@ SOURCES += \
     $$PWD/synoalbum.cpp \
     $$PWD/synoalbumcache.cpp \
     $$PWD/synoalbumdata.cpp \
+    $$PWD/synoalbumpager.cpp \
+    $$PWD/synoalbumprefetcher.cpp \
+    $$PWD/synoalbumproxy.cpp \
+    $$PWD/synoalbumreplycache.cpp \
+    $$PWD/synoalbumreplyparser.cpp \
     $$PWD/synoalbumfactory.cpp \
     $$PWD/synoauth.cpp \
     $$PWD/synoconn.cpp \
+    $$PWD/synocontenttype.cpp \
     $$PWD/synoerror.cpp \
     $$PWD/synoimagecache.cpp \
+    $$PWD/synoimagediskcache.cpp \
     $$PWD/synoimageprovider.cpp \
+    $$PWD/synolibrarycrawler.cpp \
+    $$PWD/synolibraryindex.cpp \
     $$PWD/synops.cpp \
     $$PWD/synoreplyjson.cpp \
     $$PWD/synorequest.cpp \
+    $$PWD/synosearchindex.cpp \
+    $$PWD/synosearchmodel.cpp \
+    $$PWD/synosessionsnapshot.cpp \
     $$PWD/synosettings.cpp \
     $$PWD/synosize.cpp \
-    $$PWD/synosslconfig.cpp
+    $$PWD/synosslconfig.cpp \
+    $$PWD/synotimeline.cpp \
+    $$PWD/synotimelinemodel.cpp
 
 # MSVC section
 msvc: {
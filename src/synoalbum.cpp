@@ -17,16 +17,74 @@
  */
 
 #include "synoalbum.h"
+#include "synoalbumpager.h"
+#include "synoalbumreplycache.h"
+#include "synoalbumreplyparser.h"
 #include "synoconn.h"
-#include "synoreplyjson.h"
 #include "synorequest.h"
 #include "synosettings.h"
 
+#include <QtConcurrent>
 #include <QDebug>
-#include <QJsonArray>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
 #include <QMetaEnum>
 #include <QTimer>
 
+/*!
+ * \brief Page of album items parsed by a worker thread
+ *
+ * After commit the page holds the replaced records, and is released on a worker thread.
+ */
+struct SynoAlbum::ParsedPage
+{
+    int offset = 0;
+    int total = 0;
+    /*! The page is fetched from the service, rather than loaded from cache */
+    bool isFetched = false;
+    QVector<SynoAlbumData> items;
+    /*! Records of the page when the reply was received, the items are diffed against them */
+    QVector<SynoAlbumData> base;
+    /*! Diff masks of the items against the base records */
+    QVector<quint32> diffs;
+    /*! Memory cost of the items */
+    qint64 cost = 0;
+    /*! Signature of the first page, it covers ids, thumbnails and modification times of the items */
+    quint64 itemsHash = 0;
+    QString errorString;
+};
+
+// eviction counters of all albums
+static quint64 g_evictedPageCount = 0;
+static quint64 g_reloadedPageCount = 0;
+
+// page fetch counters of all albums
+static SynoAlbum::FetchStatistics g_fetchStatistics;
+
+static qint64 recordsCost(const QVector<SynoAlbumData>& records)
+{
+    qint64 cost = 0;
+    for (const SynoAlbumData& record : records) {
+        cost += record.memoryCost();
+    }
+    return cost;
+}
+
+static QVector<quint32> recordsDiff(const QVector<SynoAlbumData>& records, const QVector<SynoAlbumData>& replaced)
+{
+    // records without counterpart are changed entirely
+    QVector<quint32> diffs(records.size());
+    for (int i = 0; i < records.size(); ++i) {
+        diffs[i] = (i < replaced.size()) ? records[i].diff(replaced[i]) : ~0u;
+    }
+    return diffs;
+}
+
+static QByteArrayList defaultItemTypes()
+{
+    return { QByteArrayLiteral("album"), QByteArrayLiteral("photo"), QByteArrayLiteral("video") };
+}
+
 int constexpr const_str_length(const char* str)
 {
     return *str ? 1 + const_str_length(str + 1) : 0;
@@ -71,11 +129,61 @@ SynoAlbum::SynoAlbum(SynoConn* conn, const SynoAlbumData& synoData, QObject* par
     : QAbstractListModel(parent)
     , m_conn(conn)
     , m_selfData(synoData.isNull() ? nullptr : new SynoAlbumData(synoData))
-    , m_path(synoData.path)
+    , m_residentCost(0)
+    , m_count(0)
+    , m_sortDescending(false)
+    , m_itemTypes(defaultItemTypes())
+    , m_path(synoData.path())
     , m_id(albumIdByPath(m_path))
+    , m_isCacheValidated(false)
+    , m_firstPageParseCount(0)
+    , m_isOffline(conn->status() == SynoConn::OFFLINE)
+    , m_isSnapshot(false)
+    , m_generation(0)
+    , m_focusPage(0)
+    , m_scrollDirection(1)
+    , m_isSeeking(false)
+    , m_fetchGeneration(0)
+    , m_infoGeneration(0)
+    , m_isActive(true)
+    , m_viewIndex(-1)
+    , m_refreshPageCount(0)
+    , m_refreshExtent(0)
+    , m_refreshGeneration(0)
+    , m_refreshRetryCount(0)
+    , m_refreshRecords(nullptr)
+    , m_placeholder()
 {
     SynoSettings settings("performance");
     m_batchSize = qBound(1, settings.value("albumBatchSize", 50).toInt(), std::numeric_limits<int>::max());
+    if (settings.value("albumAdaptiveBatchSize", true).toBool()) {
+        m_batchSize = SynoAlbumPager::instance().batchSize(m_batchSize);
+    }
+    m_memoryBudget = qBound<qint64>(0, settings.value("albumMemoryBudgetKb", 32768).toLongLong(), std::numeric_limits<int>::max()) * 1024;
+    m_maxPagesInFlight = qBound(1, settings.value("albumPagesInFlight", 4).toInt(), 64);
+    m_pagesAhead = qBound(0, settings.value("albumPagesAhead", 2).toInt(), 64);
+    m_commitBudgetMs = qBound(1, settings.value("albumCommitBudgetMs", 4).toInt(), 1000);
+    m_refreshMaxItems = qBound(0, settings.value("albumRefreshMaxItems", 2000).toInt(), std::numeric_limits<int>::max());
+    m_refreshMaxRetries = qBound(0, settings.value("albumRefreshMaxRetries", 3).toInt(), 16);
+
+    m_commitTimer.setSingleShot(true);
+    m_commitTimer.setTimerType(Qt::PreciseTimer);
+    m_commitTimer.setInterval(qBound(0, settings.value("albumCommitIntervalMs", 16).toInt(), 1000));
+    connect(&m_commitTimer, &QTimer::timeout, this, &SynoAlbum::commitParsedPages);
+
+    m_prefetchTimer.setSingleShot(true);
+    m_prefetchTimer.setInterval(0);
+    connect(&m_prefetchTimer, &QTimer::timeout, this, &SynoAlbum::prefetchPages);
+
+    m_seekTimer.setSingleShot(true);
+    m_seekTimer.setInterval(qBound(0, settings.value("albumSeekDebounceMs", 150).toInt(), 10000));
+    connect(&m_seekTimer, &QTimer::timeout, this, &SynoAlbum::finishSeek);
+
+    m_refreshRetryDelayMs = qBound(0, settings.value("albumRefreshRetryDelayMs", 500).toInt(), 60000);
+    m_refreshRetryTimer.setSingleShot(true);
+    connect(&m_refreshRetryTimer, &QTimer::timeout, this, &SynoAlbum::startRefresh);
+
+    connect(m_conn, &SynoConn::statusChanged, this, &SynoAlbum::onConnStatusChanged);
 
     // TBD: implement path, id, hasParent change on album move
 }
@@ -89,12 +197,26 @@ SynoAlbum::SynoAlbum(SynoConn *conn, const QString& path, QObject *parent)
 
 SynoAlbum::~SynoAlbum()
 {
+    // replies would not be used by anyone
+    cancelInfoRequests();
     clear();
 }
 
 QHash<int, QByteArray> SynoAlbum::roleNames() const {
     QHash<int, QByteArray> roles = QAbstractListModel::roleNames();
     roles.insert(RoleSynoData, QByteArrayLiteral("synoData"));
+    roles.insert(RoleId, QByteArrayLiteral("itemId"));
+    roles.insert(RoleType, QByteArrayLiteral("itemType"));
+    roles.insert(RoleThumbPreviewSize, QByteArrayLiteral("thumbPreviewSize"));
+    roles.insert(RoleThumbSmallSize, QByteArrayLiteral("thumbSmallSize"));
+    roles.insert(RoleThumbLargeSize, QByteArrayLiteral("thumbLargeSize"));
+    roles.insert(RoleThumbPreviewMtime, QByteArrayLiteral("thumbPreviewMtime"));
+    roles.insert(RoleThumbSmallMtime, QByteArrayLiteral("thumbSmallMtime"));
+    roles.insert(RoleThumbLargeMtime, QByteArrayLiteral("thumbLargeMtime"));
+    roles.insert(RolePermBrowse, QByteArrayLiteral("permBrowse"));
+    roles.insert(RolePermUpload, QByteArrayLiteral("permUpload"));
+    roles.insert(RolePermManage, QByteArrayLiteral("permManage"));
+    roles.insert(RoleTakenDate, QByteArrayLiteral("takenDate"));
     return roles;
 }
 
@@ -104,7 +226,7 @@ int SynoAlbum::rowCount(const QModelIndex& parent) const
         return 0;
     }
 
-    return m_descendantData.size();
+    return m_count;
 }
 
 QVariant SynoAlbum::data(const QModelIndex& index, int role) const
@@ -113,7 +235,7 @@ QVariant SynoAlbum::data(const QModelIndex& index, int role) const
         return QVariant();
     }
 
-    SynoAlbumData* pSynoData = const_cast<SynoAlbum*>(this)->getPtr(index.row());
+    const SynoAlbumData* pSynoData = const_cast<SynoAlbum*>(this)->getPtr(index.row());
     if (!pSynoData) {
         return QVariant();
     }
@@ -123,6 +245,30 @@ QVariant SynoAlbum::data(const QModelIndex& index, int role) const
         return pSynoData->name;
     case RoleSynoData:
         return QVariant::fromValue(*pSynoData);
+    case RoleId:
+        return pSynoData->id;
+    case RoleType:
+        return pSynoData->type();
+    case RoleThumbPreviewSize:
+        return pSynoData->thumb_preview_size;
+    case RoleThumbSmallSize:
+        return pSynoData->thumb_small_size;
+    case RoleThumbLargeSize:
+        return pSynoData->thumb_large_size;
+    case RoleThumbPreviewMtime:
+        return pSynoData->thumb_preview_mtime;
+    case RoleThumbSmallMtime:
+        return pSynoData->thumb_small_mtime;
+    case RoleThumbLargeMtime:
+        return pSynoData->thumb_large_mtime;
+    case RolePermBrowse:
+        return pSynoData->perm_browse();
+    case RolePermUpload:
+        return pSynoData->perm_upload();
+    case RolePermManage:
+        return pSynoData->perm_manage();
+    case RoleTakenDate:
+        return pSynoData->takendate();
     default:
         break;
     }
@@ -130,164 +276,1479 @@ QVariant SynoAlbum::data(const QModelIndex& index, int role) const
     return QVariant();
 }
 
+QVector<int> SynoAlbum::rolesForDiff(quint32 diff)
+{
+    // diff bits of each role are found once, by changing the role field of a blank record
+    static const QVector< QPair<int, quint32> > roleDiffs = []() {
+        auto diffOf = [](const std::function<void(SynoAlbumData&)>& change) {
+            SynoAlbumData record = SynoAlbumData::null;
+            change(record);
+            return SynoAlbumData::null.diff(record);
+        };
+
+        return QVector< QPair<int, quint32> > {
+            { Qt::DisplayRole, diffOf([](SynoAlbumData& d) { d.name = QStringLiteral("_"); }) },
+            { RoleId, diffOf([](SynoAlbumData& d) { d.id = QStringLiteral("_"); }) },
+            { RoleType, diffOf([](SynoAlbumData& d) { d.setType(QStringLiteral("_")); }) },
+            { RoleThumbPreviewSize, diffOf([](SynoAlbumData& d) { d.thumb_preview_size = QSize(1, 1); }) },
+            { RoleThumbSmallSize, diffOf([](SynoAlbumData& d) { d.thumb_small_size = QSize(1, 1); }) },
+            { RoleThumbLargeSize, diffOf([](SynoAlbumData& d) { d.thumb_large_size = QSize(1, 1); }) },
+            { RoleThumbPreviewMtime, diffOf([](SynoAlbumData& d) { d.thumb_preview_mtime = 1; }) },
+            { RoleThumbSmallMtime, diffOf([](SynoAlbumData& d) { d.thumb_small_mtime = 1; }) },
+            { RoleThumbLargeMtime, diffOf([](SynoAlbumData& d) { d.thumb_large_mtime = 1; }) },
+            { RolePermBrowse, diffOf([](SynoAlbumData& d) { d.setPermBrowse(true); }) },
+            { RolePermUpload, diffOf([](SynoAlbumData& d) { d.setPermUpload(true); }) },
+            { RolePermManage, diffOf([](SynoAlbumData& d) { d.setPermManage(true); }) },
+            { RoleTakenDate, diffOf([](SynoAlbumData& d) { d.setTakenDate(QStringLiteral("2000-01-01 00:00:00")); }) },
+        };
+    }();
+
+    QVector<int> roles;
+    if (diff) {
+        roles.append(RoleSynoData);
+    }
+
+    for (const QPair<int, quint32>& roleDiff : roleDiffs) {
+        if (diff & roleDiff.second) {
+            roles.append(roleDiff.first);
+        }
+    }
+
+    return roles;
+}
+
 SynoAlbumData SynoAlbum::get(int index) const
 {
-    SynoAlbumData* pSynoData = const_cast<SynoAlbum*>(this)->getPtr(index);
+    const SynoAlbumData* pSynoData = const_cast<SynoAlbum*>(this)->getPtr(index);
     return pSynoData ? *pSynoData : SynoAlbumData::null;
 }
 
-SynoAlbumData* SynoAlbum::getPtr(int index)
+const SynoAlbumData* SynoAlbum::peek(int index) const
 {
-    if (index < 0 || index >= m_descendantData.size()) {
+    if (index < 0 || index >= m_count) {
         return nullptr;
     }
 
-    if (!m_descendantData[index]) {
-        // allocate data according to batch size
-        int begin = index - (index % m_batchSize);
-        int end = std::min(begin + m_batchSize, m_descendantData.size());
-        for (int i = begin; i < end; ++i) {
-            if (!m_descendantData[i]) {
-                m_descendantData[i] = new SynoAlbumData();
-            }
+    if (m_refreshRecords) {
+        return index < m_refreshRecords->size() ? &(*m_refreshRecords)[index] : nullptr;
+    }
+
+    const QVector<SynoAlbumData>& page = m_pages[index / m_batchSize];
+    if (page.isEmpty() || page[index % m_batchSize].id.isEmpty()) {
+        return nullptr;
+    }
+
+    return &page[index % m_batchSize];
+}
+
+bool SynoAlbum::isLoaded() const
+{
+    return std::all_of(m_pageCosts.cbegin(), m_pageCosts.cend(), [](qint64 cost) {
+        return cost > 0;
+    });
+}
+
+void SynoAlbum::setListing(const QByteArray& sortBy, bool sortDescending, const QByteArrayList& itemTypes)
+{
+    if (sortBy == m_sortBy && sortDescending == m_sortDescending && itemTypes == m_itemTypes) {
+        return;
+    }
+
+    m_sortBy = sortBy;
+    m_sortDescending = sortDescending;
+    m_itemTypes = itemTypes;
+
+    // the listing is requested in another order, loaded items do not match it
+    resetValidation();
+    m_cachedOffsets.clear();
+    m_offlineOffsets.clear();
+    loadInfo();
+    clear();
+    load(0);
+    emit isStaleChanged();
+}
+
+bool SynoAlbum::hasDefaultListing() const
+{
+    return m_sortBy.isEmpty() && m_itemTypes == defaultItemTypes();
+}
+
+const SynoAlbumData* SynoAlbum::getPtr(int index)
+{
+    if (index < 0 || index >= m_count) {
+        return nullptr;
+    }
+
+    if (m_refreshRecords) {
+        // the diff is being applied, rows beyond the refreshed range are loaded afterwards
+        return index < m_refreshRecords->size() ? &m_refreshRecords->at(index) : &m_placeholder;
+    }
+
+    const int pageIndex = index / m_batchSize;
+    if (pageIndex != m_focusPage) {
+        setFocusPage(pageIndex);
+    }
+
+    QVector<SynoAlbumData>& page = m_pages[pageIndex];
+    if (page.isEmpty()) {
+        if (m_evictedPages.remove(pageIndex)) {
+            ++g_reloadedPageCount;
         }
 
-        // send request
-        load(begin);
+        // allocate the whole page at once
+        page.resize(pageSize(pageIndex));
+
+        if (m_isSeeking) {
+            // the page is requested if the view stops near it
+            m_deferredPages.insert(pageIndex);
+        } else {
+            // send request
+            load(pageIndex * m_batchSize);
+        }
     }
 
-    return m_descendantData[index];
+    // the page is not detached, it could be shared with a parse task
+    return &page.at(index % m_batchSize);
 }
 
 void SynoAlbum::clear()
 {
-    if (m_descendantData.size()) {
+    cancelLoading();
+
+    if (m_count) {
         resetSize(0);
     }
 }
 
+void SynoAlbum::cancelLoading()
+{
+    cancelRefresh();
+
+    // replies being parsed are dropped
+    ++m_generation;
+    m_commitTimer.stop();
+
+    // pages not sent yet are dropped, the sent ones are cancelled
+    ++m_fetchGeneration;
+    m_pendingPages.clear();
+    cancelPageRequests();
+    m_prefetchTimer.stop();
+    m_isSeeking = false;
+    m_seekTimer.stop();
+    m_deferredPages.clear();
+
+    while (!m_parsedPages.isEmpty()) {
+        releaseParsedPage(m_parsedPages.dequeue());
+    }
+}
+
 void SynoAlbum::refresh(bool force)
 {
-    if (force || !m_selfData || !m_descendantData.size()) {
+    if (m_isSnapshot) {
+        // the snapshot is refreshed once it is reconciled
+        return;
+    }
+
+    if (force || !m_selfData || !m_count) {
+        resetValidation();
+        m_cachedOffsets.clear();
+        m_offlineOffsets.clear();
         loadInfo();
-        clear();
-        load(0);
+
+        if (m_count && !m_isOffline) {
+            // loaded items are kept until the listing is received and diffed
+            startRefresh();
+        } else {
+            clear();
+            load(0);
+        }
+
+        emit isStaleChanged();
     }
 }
 
 void SynoAlbum::load(int offset)
 {
-    QByteArrayList formData;
-    formData << QByteArrayLiteral("method=list");
-    formData << QByteArrayLiteral("version=1");
-    formData << QByteArrayLiteral("type=album,photo,video");
-    formData << QByteArrayLiteral("offset=") + QByteArray::number(offset);
-    formData << QByteArrayLiteral("limit=") + QByteArray::number(m_batchSize);
-    formData << QByteArrayLiteral("recursive=false");
-    formData << QByteArrayLiteral("additional=album_permission,photo_exif,video_codec,video_quality,thumb_size,file_location");
-    formData << QByteArrayLiteral("id=") + m_id;
+    // the listing the page is loaded for, the cached reply is dropped once it is replaced
+    const quint64 generation = m_generation;
+    const quint64 fetchGeneration = m_fetchGeneration;
 
-    std::shared_ptr<SynoRequest> req = m_conn->createRequest(QByteArrayLiteral("SYNO.PhotoStation.Album"), formData);
-    req->send(this, [this, offset, req] {
-        if (req->errorString().isEmpty()) {
-            SynoReplyJSON replyJSON(req.get());
+    // replies are read and applied asynchronously, so it is safe to load during model data access
+    const int count = pageSize(offset / m_batchSize);
+    SynoAlbumReplyCache::instance().range(m_conn, m_id, listingFormData(), offset, count, this,
+                                          [this, offset, count, generation, fetchGeneration](const QMap<int, QByteArray>& cachedReplies) {
+        if (generation != m_generation || fetchGeneration != m_fetchGeneration) {
+            return;
+        }
+
+        if (cachedReplies.isEmpty()) {
+            fetch(offset);
+            return;
+        }
 
-            int total = replyJSON.dataObject()[QStringLiteral("total")].toInt();
-            if (total < 0) {
-                qWarning() << __FUNCTION__ << tr("Negative total value received: ") << total;
-                total = 0;
+        if (!m_isCacheValidated) {
+            m_cachedOffsets.insert(offset);
+
+            if (m_cachedOffsets.size() == 1) {
+                emit isStaleChanged();
             }
+        } else if (offset != 0 && !m_fetchedOffsets.contains(offset)) {
+            // the validator covers the first page only, the cached page is displayed until it is fetched
+            fetch(offset);
+        }
 
-            if (m_descendantData.size() != total) {
-                resetSize(total);
+        processListReply(offset, cachedReplies, false, generation, [this, offset, count](bool success, int itemCount) {
+            if (!success) {
+                SynoAlbumReplyCache::instance().remove(m_conn, m_id);
+                fetch(offset);
+            } else if (itemCount < count) {
+                // the rest of the page is not cached, the cached part is displayed until it is fetched
+                fetch(offset);
             }
+        });
+    });
+}
 
-            QJsonArray items = replyJSON.dataObject()[QStringLiteral("items")].toArray();
-            if (offset + items.size() <= total) {
-                int i = offset;
-                for (auto iter = items.cbegin(); iter != items.cend(); ++iter, ++i) {
-                    if (!m_descendantData[i]) {
-                        m_descendantData[i] = new SynoAlbumData();
-                    }
+void SynoAlbum::fetch(int offset)
+{
+    if (m_isOffline) {
+        // the page would be requested on reconnection
+        m_offlineOffsets.insert(offset);
+        return;
+    }
 
-                    m_descendantData[i]->readFrom(iter->toObject());
-                }
+    const int pageIndex = offset / m_batchSize;
+    if (m_inFlightPages.contains(pageIndex) || m_pendingPages.contains(pageIndex)) {
+        return;
+    }
 
-                emit dataChanged(index(offset), index(offset + items.size() - 1));
-            } else {
-                qWarning() << __FUNCTION__ << tr("Too much items received: ") << items.size();
+    m_pendingPages.append(pageIndex);
+    schedulePages();
+}
+
+void SynoAlbum::sendPage(int pageIndex)
+{
+    const int offset = pageIndex * m_batchSize;
+    // the listing the page is requested for, the reply is dropped once it is replaced
+    const quint64 generation = m_generation;
+    const quint64 fetchGeneration = m_fetchGeneration;
+    QByteArrayList formData = listingFormData();
+
+    QElapsedTimer elapsedTimer;
+    elapsedTimer.start();
+
+    std::shared_ptr<SynoRequest> req = m_conn->createRequest(QByteArrayLiteral("SYNO.PhotoStation.Album"), listFormData(offset));
+    req->setIsBatchable(true);
+    // album which is not displayed, e.g. a prefetched one, does not delay background work
+    req->setIsBackground(!m_isActive);
+    m_inFlightPages.insert(pageIndex, req);
+    req->send(this, [this, offset, pageIndex, generation, fetchGeneration, formData, req, elapsedTimer] {
+        if (fetchGeneration != m_fetchGeneration) {
+            // the model was cleared or refreshed after the page was requested
+            if (req->errorString().isEmpty()) {
+                ++g_fetchStatistics.wasted;
             }
+            return;
+        }
+
+        m_inFlightPages.remove(pageIndex);
+        schedulePages();
+
+        if (req->errorString().isEmpty()) {
+            const qint64 elapsedMs = elapsedTimer.elapsed();
+            QByteArray replyBody = req->replyBody();
+            processListReply(offset, { { offset, replyBody } }, true, generation, [this, offset, formData, replyBody, elapsedMs](bool success, int itemCount) {
+                if (success) {
+                    m_fetchedOffsets.insert(offset);
+                    SynoAlbumReplyCache::instance().insertRange(m_conn, m_id, formData, offset, itemCount, replyBody);
+                    SynoAlbumPager::instance().addSample(elapsedMs, replyBody.size(), itemCount);
+                }
+            });
         } else {
             qWarning() << __FUNCTION__ << tr("Error during retrieving album data. %1").arg(req->errorString());
+
+            if (m_isOffline) {
+                // the page is requested again once the connection is back
+                m_offlineOffsets.insert(offset);
+            } else {
+                // placeholders are requested again on access
+                dropPlaceholderPage(pageIndex);
+            }
         }
     });
 }
 
-void SynoAlbum::loadInfo()
+void SynoAlbum::schedulePages()
 {
-    QByteArrayList formData;
-    formData << QByteArrayLiteral("method=getinfo");
-    formData << QByteArrayLiteral("version=1");
-    formData << QByteArrayLiteral("additional=album_permission,photo_exif,video_codec,video_quality,thumb_size,file_location");
-    formData << QByteArrayLiteral("id=") + m_id;
+    // album which is not displayed yields the connection to the displayed ones
+    const int maxPagesInFlight = m_isActive ? m_maxPagesInFlight : 1;
+    if (m_isOffline || m_pendingPages.isEmpty() || m_inFlightPages.size() >= maxPagesInFlight) {
+        return;
+    }
 
-    std::shared_ptr<SynoRequest> req = m_conn->createRequest(QByteArrayLiteral("SYNO.PhotoStation.Album"), formData);
-    req->send(this, [this, req] {
-        if (req->errorString().isEmpty()) {
-            SynoReplyJSON replyJSON(req.get());
-            QJsonArray items = replyJSON.dataObject()[QStringLiteral("items")].toArray();
-            if (items.size()) {
-                m_selfData.reset(new SynoAlbumData());
-                m_selfData->readFrom(items[0].toObject());
-                emit synoDataChanged();
-            } else {
-                qWarning() << __FUNCTION__ << tr("Error during retrieving album data. %1").arg(replyJSON.errorString());
-            }
+    // the view may have jumped since the pages were queued, the closest ones are sent first
+    std::stable_sort(m_pendingPages.begin(), m_pendingPages.end(), [this](int a, int b) {
+        return pageDistance(a) < pageDistance(b);
+    });
+
+    while (!m_pendingPages.isEmpty() && m_inFlightPages.size() < maxPagesInFlight) {
+        sendPage(m_pendingPages.takeFirst());
+    }
+}
+
+void SynoAlbum::finishSeek()
+{
+    m_isSeeking = false;
+
+    // pages near the destination are requested, the rest is requested again on access
+    QSet<int> deferredPages;
+    std::swap(deferredPages, m_deferredPages);
+    for (int pageIndex : std::as_const(deferredPages)) {
+        if (isNearFocus(pageIndex)) {
+            load(pageIndex * m_batchSize);
         } else {
-            qWarning() << __FUNCTION__ << tr("Error during retrieving album data. %1").arg(req->errorString());
+            dropPlaceholderPage(pageIndex);
         }
-    });
+    }
+
+    // requests of the pages the view passed through are superseded, refetches of loaded pages are kept
+    for (auto iter = m_pendingPages.begin(); iter != m_pendingPages.end(); ) {
+        if (!isNearFocus(*iter) && dropPlaceholderPage(*iter)) {
+            iter = m_pendingPages.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+
+    for (auto iter = m_inFlightPages.begin(); iter != m_inFlightPages.end(); ) {
+        if (!isNearFocus(iter.key()) && dropPlaceholderPage(iter.key())) {
+            iter.value()->cancel();
+            ++g_fetchStatistics.cancelled;
+            iter = m_inFlightPages.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+
+    prefetchPages();
 }
 
-void SynoAlbum::resetSize(int size)
+bool SynoAlbum::isNearFocus(int pageIndex) const
 {
-    beginResetModel();
-    qDeleteAll(m_descendantData);
-    m_descendantData.resize(size);
-    endResetModel();
+    return std::abs(pageIndex - m_focusPage) <= m_pagesAhead + 1;
 }
 
-int SynoAlbum::batchSize() const
+bool SynoAlbum::dropPlaceholderPage(int pageIndex)
 {
-    return m_batchSize;
+    // loaded records are kept, placeholders are requested again on access
+    if (pageIndex < m_pages.size() && !m_pages[pageIndex].isEmpty() && m_pages[pageIndex].first().id.isEmpty()) {
+        m_pages[pageIndex] = QVector<SynoAlbumData>();
+        return true;
+    }
+
+    return false;
 }
 
-void SynoAlbum::setBatchSize(int size)
+int SynoAlbum::pageDistance(int pageIndex) const
 {
-    if (size != m_batchSize) {
-        m_batchSize = size;
-        emit batchSizeChanged();
+    // pages ahead of the scroll direction precede the ones behind at the same distance
+    const int distance = (pageIndex - m_focusPage) * m_scrollDirection;
+    return distance >= 0 ? distance * 2 : -distance * 2 + 1;
+}
+
+void SynoAlbum::setFocusPage(int pageIndex)
+{
+    if (std::abs(pageIndex - m_focusPage) > m_pagesAhead + 1) {
+        // the view jumped, e.g. the scroll bar is dragged; loading is postponed until it stops
+        m_isSeeking = true;
+        m_seekTimer.start();
+    }
+
+    m_scrollDirection = (pageIndex > m_focusPage) ? 1 : -1;
+    m_focusPage = pageIndex;
+
+    // pages are requested after the view finished data access
+    if (!m_prefetchTimer.isActive()) {
+        m_prefetchTimer.start();
     }
 }
 
-const SynoAlbumData& SynoAlbum::synoData() const
+void SynoAlbum::prefetchPages()
 {
-    return m_selfData ? *m_selfData : SynoAlbumData::null;
+    if (m_isSeeking || !m_isActive) {
+        return;
+    }
+
+    for (int i = 1; i <= m_pagesAhead; ++i) {
+        const int pageIndex = m_focusPage + i * m_scrollDirection;
+        if (pageIndex < 0 || pageIndex >= m_pages.size()) {
+            break;
+        }
+
+        QVector<SynoAlbumData>& page = m_pages[pageIndex];
+        if (page.isEmpty()) {
+            page.resize(pageSize(pageIndex));
+            load(pageIndex * m_batchSize);
+        }
+    }
+
+    schedulePages();
 }
 
-const QString& SynoAlbum::path() const
+void SynoAlbum::processListReply(int offset, const QMap<int, QByteArray>& replies, bool isFetched, quint64 generation,
+                                 const std::function<void(bool, int)>& callback)
 {
-    return m_path;
+    if (generation != m_generation) {
+        // the listing the reply belongs to is replaced already
+        if (isFetched) {
+            ++g_fetchStatistics.wasted;
+        }
+        return;
+    }
+
+    // the reply is diffed against the page as it is now, the commit verifies it is not replaced meanwhile
+    const int pageIndex = offset / m_batchSize;
+    QVector<SynoAlbumData> base;
+    if (offset % m_batchSize == 0 && pageIndex < m_pages.size()) {
+        base = m_pages.at(pageIndex);
+    }
+
+    // validation waits for the fetched first page, rather than probing it again
+    const bool isFirstPageFetched = isFetched && offset == 0;
+    if (isFirstPageFetched) {
+        ++m_firstPageParseCount;
+    }
+
+    parseReply(offset, replies, base, [this, generation, isFetched, isFirstPageFetched, callback](std::shared_ptr<ParsedPage> page) {
+        page->isFetched = isFetched;
+        if (isFirstPageFetched) {
+            --m_firstPageParseCount;
+        }
+
+        if (generation != m_generation) {
+            // the model was cleared meanwhile
+            if (page->isFetched) {
+                ++g_fetchStatistics.wasted;
+            }
+            releaseParsedPage(std::move(page));
+            return;
+        }
+
+        if (!page->errorString.isEmpty()) {
+            qWarning() << __FUNCTION__ << page->errorString;
+            if (page->isFetched) {
+                ++g_fetchStatistics.wasted;
+            }
+            releaseParsedPage(std::move(page));
+            callback(false, 0);
+            return;
+        }
+
+        const int itemCount = page->items.size();
+        if (isFirstPageFetched) {
+            setFirstPageSignature(*page);
+        }
+
+        m_parsedPages.enqueue(page);
+        if (!m_commitTimer.isActive()) {
+            m_commitTimer.start();
+        }
+
+        callback(true, itemCount);
+    });
 }
 
-const QByteArray& SynoAlbum::id() const
+void SynoAlbum::parseReply(int offset, const QMap<int, QByteArray>& replies, const QVector<SynoAlbumData>& base,
+                           const std::function<void(std::shared_ptr<ParsedPage>)>& callback)
 {
-    return m_id;
+    // the watcher is released with the album, so the result is not delivered to released album
+    auto* watcher = new QFutureWatcher< std::shared_ptr<ParsedPage> >(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [watcher, callback]() {
+        std::shared_ptr<ParsedPage> page = watcher->result();
+        watcher->deleteLater();
+        callback(std::move(page));
+    });
+
+    watcher->setFuture(QtConcurrent::run([offset, replies, base]() {
+        return parseListReply(offset, replies, base);
+    }));
 }
 
-bool SynoAlbum::hasParent() const
+std::shared_ptr<SynoAlbum::ParsedPage> SynoAlbum::parseListReply(int offset, const QMap<int, QByteArray>& replies,
+                                                                  const QVector<SynoAlbumData>& base)
 {
-    return m_path.size() > 0;
+    std::shared_ptr<ParsedPage> page = std::make_shared<ParsedPage>();
+    page->offset = offset;
+
+    for (auto iter = replies.cbegin(); iter != replies.cend(); ++iter) {
+        SynoAlbumReplyParser parser;
+        if (!parser.parse(iter.value())) {
+            page->errorString = tr("Error during retrieving album data. %1").arg(parser.errorString());
+            return page;
+        }
+
+        int total = parser.total();
+        if (total < 0) {
+            qWarning() << __FUNCTION__ << tr("Negative total value received: ") << total;
+            total = 0;
+        }
+
+        QVector<SynoAlbumData>& items = parser.items();
+        if (iter.key() + items.size() > total) {
+            page->errorString = tr("Too much items received: %1").arg(items.size());
+            return page;
+        }
+
+        if (iter == replies.cbegin()) {
+            page->total = total;
+        } else if (total != page->total) {
+            page->errorString = tr("Cached replies of different listings received");
+            return page;
+        }
+
+        // a reply continues the previous one, items it shares with it or precedes the page with are skipped
+        const int skipCount = offset + page->items.size() - iter.key();
+        if (skipCount < 0) {
+            break;
+        }
+
+        if (page->items.isEmpty() && !skipCount) {
+            // parsed records form the page storage as is
+            std::swap(page->items, items);
+        } else {
+            for (int i = skipCount; i < items.size(); ++i) {
+                page->items.append(std::move(items[i]));
+            }
+        }
+    }
+
+    // GUI thread only swaps the storage and signals the changes
+    page->base = base;
+    page->diffs = recordsDiff(page->items, base);
+    page->cost = recordsCost(page->items);
+
+    if (offset == 0) {
+        for (const SynoAlbumData& item : std::as_const(page->items)) {
+            page->itemsHash = page->itemsHash * 31 + item.contentHash();
+        }
+    }
+
+    return page;
+}
+
+void SynoAlbum::releaseParsedPage(std::shared_ptr<ParsedPage>&& page)
+{
+    // records are released on a worker thread, to keep GUI thread responsive
+    QtConcurrent::run([page = std::move(page)]() mutable {
+        page.reset();
+    });
+}
+
+void SynoAlbum::commitParsedPages()
+{
+    QElapsedTimer sliceTimer;
+    sliceTimer.start();
+
+    while (!m_parsedPages.isEmpty() && sliceTimer.elapsed() < m_commitBudgetMs) {
+        std::shared_ptr<ParsedPage> page = m_parsedPages.dequeue();
+
+        if (m_count != page->total) {
+            if (!m_count || m_isOffline) {
+                resetSize(page->total);
+            } else {
+                // the listing is changed, loaded items are diffed against it
+                if (page->isFetched) {
+                    ++g_fetchStatistics.wasted;
+                }
+                releaseParsedPage(std::move(page));
+                startRefresh();
+                continue;
+            }
+        }
+
+        const int pageIndex = page->offset / m_batchSize;
+        if (page->offset % m_batchSize || pageIndex >= m_pages.size()) {
+            // the page was requested with another batch size
+            if (page->isFetched) {
+                ++g_fetchStatistics.wasted;
+            }
+            releaseParsedPage(std::move(page));
+            continue;
+        }
+
+        if (page->isFetched) {
+            ++g_fetchStatistics.used;
+        }
+
+        // diffs and cost are computed by the parse task, unless the page is replaced or resized meanwhile
+        const int size = pageSize(pageIndex);
+        if (page->items.size() != size || m_pages.at(pageIndex).constData() != page->base.constData()) {
+            page->items.resize(size);
+            page->diffs = recordsDiff(page->items, m_pages.at(pageIndex));
+            page->cost = recordsCost(page->items);
+        }
+
+        // the page storage is swapped, the parsed page takes the replaced one
+        page->base = QVector<SynoAlbumData>();
+        std::swap(m_pages[pageIndex], page->items);
+        m_evictedPages.remove(pageIndex);
+        setPageCost(pageIndex, page->cost);
+
+        // only the records which actually changed are signalled, in contiguous runs
+        const QVector<quint32>& diffs = page->diffs;
+        int runBegin = -1;
+        quint32 runDiff = 0;
+        for (int i = 0; i <= diffs.size(); ++i) {
+            const quint32 recordDiff = (i < diffs.size()) ? diffs[i] : 0;
+            if (recordDiff) {
+                if (runBegin < 0) {
+                    runBegin = i;
+                }
+                runDiff |= recordDiff;
+            } else if (runBegin >= 0) {
+                emit dataChanged(index(page->offset + runBegin), index(page->offset + i - 1), rolesForDiff(runDiff));
+                runBegin = -1;
+                runDiff = 0;
+            }
+        }
+
+        releaseParsedPage(std::move(page));
+    }
+
+    enforceMemoryBudget();
+
+    if (!m_parsedPages.isEmpty()) {
+        // the rest is committed on the next frame
+        m_commitTimer.start();
+    }
+}
+
+void SynoAlbum::loadInfo()
+{
+    QByteArrayList formData = infoFormData();
+
+    // cached info is dropped if fetched info is processed before it is read
+    const quint64 infoGeneration = m_infoGeneration;
+    SynoAlbumReplyCache::instance().object(m_conn, m_id, formData, this, [this, infoGeneration](const QByteArray& cachedReplyBody) {
+        if (!cachedReplyBody.isNull() && infoGeneration == m_infoGeneration) {
+            processInfoReply(cachedReplyBody);
+        }
+    });
+
+    if (m_isOffline) {
+        return;
+    }
+
+    // album info is always requested, as it is used for validation of cached replies
+    std::shared_ptr<SynoRequest> req = m_conn->createRequest(QByteArrayLiteral("SYNO.PhotoStation.Album"), formData);
+    req->setIsBatchable(true);
+    req->setIsBackground(!m_isActive);
+    m_infoRequests.insert(req.get(), req);
+    req->send(this, [this, formData, req] {
+        m_infoRequests.remove(req.get());
+
+        if (req->errorString().isEmpty()) {
+            ++m_infoGeneration;
+            if (processInfoReply(req->replyBody())) {
+                SynoAlbumReplyCache::instance().insert(m_conn, m_id, formData, req->replyBody());
+
+                if (!m_isCacheValidated) {
+                    m_validationInfoReply = req->replyBody();
+
+                    // the first page is fetched as the probe, unless it is being fetched already
+                    if (m_firstPageSignature.isNull() && !m_firstPageParseCount && !m_refreshRequests.contains(0)) {
+                        fetch(0);
+                    }
+
+                    revalidate();
+                }
+            }
+        } else {
+            qWarning() << __FUNCTION__ << tr("Error during retrieving album data. %1").arg(req->errorString());
+        }
+    });
+}
+
+void SynoAlbum::setFirstPageSignature(const ParsedPage& page)
+{
+    m_firstPageSignature = QByteArray::number(page.total) + ':' + QByteArray::number(page.itemsHash, 16);
+    revalidate();
+}
+
+void SynoAlbum::revalidate()
+{
+    // both album info and the first page are fetched
+    if (m_isCacheValidated || m_validationInfoReply.isNull() || m_firstPageSignature.isNull()) {
+        return;
+    }
+
+    // the validator covers the total count, the album thumbnail and the items of the first page
+    const QByteArray validator = m_firstPageSignature + ':' + synoData().thumb_sig.toUtf8();
+
+    QByteArray infoReplyBody;
+    std::swap(infoReplyBody, m_validationInfoReply);
+    m_firstPageSignature = QByteArray();
+
+    QSet<int> cachedOffsets;
+    std::swap(cachedOffsets, m_cachedOffsets);
+    m_isCacheValidated = true;
+    emit isStaleChanged();
+
+    // if the album is changed, replies of the pages not displayed yet are dropped, the info is kept
+    SynoAlbumReplyCache& cache = SynoAlbumReplyCache::instance();
+    cache.validate(m_conn, m_id, validator);
+    cache.insert(m_conn, m_id, infoFormData(), infoReplyBody);
+
+    // the first page is fetched already, the other pages served from cache are not covered by the validator
+    cachedOffsets.remove(0);
+    for (int offset : std::as_const(cachedOffsets)) {
+        fetch(offset);
+    }
+}
+
+void SynoAlbum::resetValidation()
+{
+    m_isCacheValidated = false;
+    m_validationInfoReply = QByteArray();
+    m_firstPageSignature = QByteArray();
+    m_fetchedOffsets.clear();
+}
+
+bool SynoAlbum::processInfoReply(const QByteArray& replyBody)
+{
+    SynoAlbumReplyParser parser;
+    parser.parse(replyBody);
+    if (parser.items().isEmpty()) {
+        qWarning() << __FUNCTION__ << tr("Error during retrieving album data. %1").arg(parser.errorString());
+        return false;
+    }
+
+    m_selfData.reset(new SynoAlbumData(std::move(parser.items()[0])));
+    emit synoDataChanged();
+
+    return true;
+}
+
+QByteArrayList SynoAlbum::listFormData(int offset) const
+{
+    QByteArrayList formData = listingFormData();
+    formData << QByteArrayLiteral("offset=") + QByteArray::number(offset);
+    formData << QByteArrayLiteral("limit=") + QByteArray::number(m_batchSize);
+    return formData;
+}
+
+QByteArrayList SynoAlbum::listingFormData() const
+{
+    QByteArrayList formData;
+    formData << QByteArrayLiteral("method=list");
+    formData << QByteArrayLiteral("version=1");
+    formData << QByteArrayLiteral("type=") + m_itemTypes.join(',');
+    if (!m_sortBy.isEmpty()) {
+        formData << QByteArrayLiteral("sort_by=") + m_sortBy;
+        formData << QByteArrayLiteral("sort_direction=") + (m_sortDescending ? QByteArrayLiteral("desc") : QByteArrayLiteral("asc"));
+    }
+    formData << QByteArrayLiteral("recursive=false");
+    formData << QByteArrayLiteral("additional=album_permission,photo_exif,video_codec,video_quality,thumb_size,file_location");
+    formData << QByteArrayLiteral("id=") + m_id;
+    return formData;
+}
+
+QByteArrayList SynoAlbum::infoFormData() const
+{
+    QByteArrayList formData;
+    formData << QByteArrayLiteral("method=getinfo");
+    formData << QByteArrayLiteral("version=1");
+    formData << QByteArrayLiteral("additional=album_permission,photo_exif,video_codec,video_quality,thumb_size,file_location");
+    formData << QByteArrayLiteral("id=") + m_id;
+    return formData;
+}
+
+void SynoAlbum::resetSize(int size)
+{
+    beginResetModel();
+
+    QVector< QVector<SynoAlbumData> > pages(pageCount(size));
+    std::swap(pages, m_pages);
+    m_pageCosts.fill(0, m_pages.size());
+    m_residentCost = 0;
+    m_evictedPages.clear();
+    m_count = size;
+
+    endResetModel();
+    emit residentCostChanged();
+
+    // records are released on a worker thread, to keep GUI thread responsive
+    if (!pages.isEmpty()) {
+        QtConcurrent::run([pages = std::move(pages)]() mutable {
+            pages.clear();
+        });
+    }
+}
+
+void SynoAlbum::startRefresh()
+{
+    if (m_refreshPageCount) {
+        // the refresh is in progress already
+        return;
+    }
+
+    m_refreshRetryTimer.stop();
+
+    const int extent = std::max(loadedExtent(), std::min(m_count, m_batchSize));
+    if (extent > m_refreshMaxItems) {
+        // diffing of that many items does not pay off, the album is reloaded
+        clear();
+        load(0);
+        return;
+    }
+
+    m_refreshExtent = extent;
+    m_refreshPageCount = pageCount(extent);
+    for (int pageIndex = 0; pageIndex < m_refreshPageCount; ++pageIndex) {
+        fetchRefreshPage(pageIndex * m_batchSize);
+    }
+}
+
+void SynoAlbum::fetchRefreshPage(int offset)
+{
+    const quint64 refreshGeneration = m_refreshGeneration;
+    QByteArrayList formData = listingFormData();
+
+    std::shared_ptr<SynoRequest> req = m_conn->createRequest(QByteArrayLiteral("SYNO.PhotoStation.Album"), listFormData(offset));
+    req->setIsBatchable(true);
+    req->setIsBackground(!m_isActive);
+    m_refreshRequests.insert(offset, req);
+    req->send(this, [this, offset, formData, req, refreshGeneration] {
+        if (refreshGeneration != m_refreshGeneration) {
+            return;
+        }
+
+        m_refreshRequests.remove(offset);
+
+        if (!req->errorString().isEmpty()) {
+            // loaded items are kept as is
+            qWarning() << __FUNCTION__ << tr("Error during retrieving album data. %1").arg(req->errorString());
+            cancelRefresh();
+            return;
+        }
+
+        QByteArray replyBody = req->replyBody();
+        if (offset == 0) {
+            ++m_firstPageParseCount;
+        }
+
+        parseReply(offset, { { offset, replyBody } }, QVector<SynoAlbumData>(), [this, offset, formData, replyBody, refreshGeneration](std::shared_ptr<ParsedPage> page) {
+            if (offset == 0) {
+                --m_firstPageParseCount;
+            }
+
+            if (refreshGeneration != m_refreshGeneration) {
+                ++g_fetchStatistics.wasted;
+                releaseParsedPage(std::move(page));
+                return;
+            }
+
+            if (!page->errorString.isEmpty()) {
+                qWarning() << __FUNCTION__ << page->errorString;
+                ++g_fetchStatistics.wasted;
+                releaseParsedPage(std::move(page));
+                cancelRefresh();
+                return;
+            }
+
+            if (offset == 0) {
+                // the validation could drop cached replies, so it precedes caching of the page
+                setFirstPageSignature(*page);
+            }
+
+            SynoAlbumReplyCache::instance().insertRange(m_conn, m_id, formData, offset, page->items.size(), replyBody);
+
+            m_refreshPages.insert(page->offset, std::move(page));
+            if (m_refreshPages.size() == m_refreshPageCount) {
+                finishRefresh();
+            }
+        });
+    });
+}
+
+void SynoAlbum::finishRefresh()
+{
+    QMap< int, std::shared_ptr<ParsedPage> > pages;
+    std::swap(pages, m_refreshPages);
+    m_refreshPageCount = 0;
+    ++m_refreshGeneration;
+
+    const int total = pages.first()->total;
+    QVector<SynoAlbumData> fresh;
+    bool isConsistent = true;
+    for (std::shared_ptr<ParsedPage>& page : pages) {
+        if (page->total != total || (page->offset < total && page->offset != fresh.size())) {
+            isConsistent = false;
+        } else if (page->offset < total) {
+            fresh += page->items;
+        }
+
+        releaseParsedPage(std::move(page));
+    }
+
+    if (!isConsistent) {
+        g_fetchStatistics.wasted += pages.size();
+
+        if (m_refreshRetryCount >= m_refreshMaxRetries) {
+            // the listing keeps changing, e.g. during an upload, so the album is reloaded
+            clear();
+            load(0);
+            return;
+        }
+
+        // the listing was changed between the pages, it is requested again once it settles
+        m_refreshRetryTimer.start(m_refreshRetryDelayMs << m_refreshRetryCount);
+        ++m_refreshRetryCount;
+        return;
+    }
+
+    m_refreshRetryCount = 0;
+    g_fetchStatistics.used += pages.size();
+
+    applyRefresh(total, fresh);
+}
+
+void SynoAlbum::cancelRefresh()
+{
+    ++m_refreshGeneration;
+    m_refreshPageCount = 0;
+    m_refreshRetryCount = 0;
+    m_refreshRetryTimer.stop();
+
+    for (const std::shared_ptr<SynoRequest>& req : std::as_const(m_refreshRequests)) {
+        req->cancel();
+    }
+    g_fetchStatistics.cancelled += m_refreshRequests.size();
+    m_refreshRequests.clear();
+
+    for (std::shared_ptr<ParsedPage>& page : m_refreshPages) {
+        releaseParsedPage(std::move(page));
+    }
+    g_fetchStatistics.wasted += m_refreshPages.size();
+    m_refreshPages.clear();
+}
+
+void SynoAlbum::cancelPageRequests()
+{
+    for (const std::shared_ptr<SynoRequest>& req : std::as_const(m_inFlightPages)) {
+        req->cancel();
+    }
+    g_fetchStatistics.cancelled += m_inFlightPages.size();
+    m_inFlightPages.clear();
+}
+
+void SynoAlbum::cancelInfoRequests()
+{
+    for (const std::shared_ptr<SynoRequest>& req : std::as_const(m_infoRequests)) {
+        req->cancel();
+    }
+    m_infoRequests.clear();
+}
+
+void SynoAlbum::applyRefresh(int total, const QVector<SynoAlbumData>& fresh)
+{
+    // pages of the previous listing are dropped, the rows beyond the refreshed range are requested again
+    ++m_generation;
+    m_commitTimer.stop();
+    while (!m_parsedPages.isEmpty()) {
+        releaseParsedPage(m_parsedPages.dequeue());
+    }
+
+    // requests of the previous listing are superseded, their pages are requested again on access
+    int lastRequestedPage = -1;
+    for (int pageIndex : std::as_const(m_pendingPages)) {
+        lastRequestedPage = std::max(lastRequestedPage, pageIndex);
+    }
+    for (auto iter = m_inFlightPages.cbegin(); iter != m_inFlightPages.cend(); ++iter) {
+        lastRequestedPage = std::max(lastRequestedPage, iter.key());
+    }
+    ++m_fetchGeneration;
+    m_pendingPages.clear();
+    cancelPageRequests();
+
+    const int extent = std::min(m_refreshExtent, m_count);
+    const int tailSize = m_count - extent;
+
+    // the refreshed range is transformed into the fresh listing, the model follows every step
+    QVector<SynoAlbumData> records(extent);
+    for (int i = 0; i < extent; ++i) {
+        QVector<SynoAlbumData>& page = m_pages[i / m_batchSize];
+        if (!page.isEmpty()) {
+            records[i] = std::move(page[i % m_batchSize]);
+        }
+    }
+
+    bool hasTailPages = lastRequestedPage >= pageCount(extent);
+    for (int pageIndex = pageCount(extent); pageIndex < m_pages.size(); ++pageIndex) {
+        hasTailPages |= !m_pages[pageIndex].isEmpty();
+    }
+
+    m_refreshRecords = &records;
+
+    QSet<QString> freshIds;
+    freshIds.reserve(fresh.size());
+    for (const SynoAlbumData& record : fresh) {
+        freshIds.insert(record.id);
+    }
+
+    // records which are kept, rows not loaded or evicted are unknown and filled with fresh ones in place
+    QSet<QString> keptIds;
+    QVector<bool> isKept(records.size());
+    for (int i = 0; i < records.size(); ++i) {
+        const QString& id = records[i].id;
+        if (id.isEmpty()) {
+            isKept[i] = true;
+        } else {
+            isKept[i] = freshIds.contains(id) && !keptIds.contains(id);
+            if (isKept[i]) {
+                keptIds.insert(id);
+            }
+        }
+    }
+
+    // removals, in contiguous runs from the end
+    for (int last = records.size() - 1; last >= 0; --last) {
+        if (isKept[last]) {
+            continue;
+        }
+
+        int first = last;
+        while (first > 0 && !isKept[first - 1]) {
+            --first;
+        }
+
+        beginRemoveRows(QModelIndex(), first, last);
+        records.erase(records.begin() + first, records.begin() + last + 1);
+        m_count -= last - first + 1;
+        endRemoveRows();
+
+        last = first;
+    }
+
+    // moves and insertions, walking the fresh listing
+    QVector<quint32> recordDiffs(fresh.size());
+    for (int i = 0; i < fresh.size(); ) {
+        if (i < records.size() && records[i].id == fresh[i].id) {
+            recordDiffs[i] = records[i].diff(fresh[i]);
+            if (recordDiffs[i]) {
+                records[i] = fresh[i];
+            }
+            ++i;
+            continue;
+        }
+
+        const bool isKnownFresh = keptIds.contains(fresh[i].id);
+        if (i < records.size() && records[i].id.isEmpty() && !isKnownFresh) {
+            recordDiffs[i] = ~0u;
+            records[i] = fresh[i];
+            ++i;
+            continue;
+        }
+
+        int from = -1;
+        if (isKnownFresh) {
+            for (int j = i + 1; j < records.size(); ++j) {
+                if (records[j].id == fresh[i].id) {
+                    from = j;
+                    break;
+                }
+            }
+        }
+
+        if (from >= 0) {
+            beginMoveRows(QModelIndex(), from, from, QModelIndex(), i);
+            records.move(from, i);
+            endMoveRows();
+            continue;
+        }
+
+        int last = i;
+        while (last + 1 < fresh.size() && !keptIds.contains(fresh[last + 1].id)) {
+            ++last;
+        }
+
+        beginInsertRows(QModelIndex(), i, last);
+        records.insert(i, last - i + 1, SynoAlbumData());
+        std::copy(fresh.begin() + i, fresh.begin() + last + 1, records.begin() + i);
+        m_count += last - i + 1;
+        endInsertRows();
+
+        i = last + 1;
+    }
+
+    // unknown rows the fresh listing does not reach
+    if (records.size() > fresh.size()) {
+        beginRemoveRows(QModelIndex(), fresh.size(), records.size() - 1);
+        m_count -= records.size() - fresh.size();
+        records.resize(fresh.size());
+        endRemoveRows();
+    }
+
+    // rows beyond the refreshed range are not loaded, only their amount is adjusted
+    const int freshTailSize = std::max(0, total - fresh.size());
+    if (freshTailSize > tailSize) {
+        beginInsertRows(QModelIndex(), m_count, m_count + freshTailSize - tailSize - 1);
+        m_count += freshTailSize - tailSize;
+        endInsertRows();
+    } else if (freshTailSize < tailSize) {
+        beginRemoveRows(QModelIndex(), m_count - tailSize + freshTailSize, m_count - 1);
+        m_count -= tailSize - freshTailSize;
+        endRemoveRows();
+    }
+
+    Q_ASSERT(m_count == total);
+
+    QVector< QVector<SynoAlbumData> > pages(pageCount(m_count));
+    std::swap(pages, m_pages);
+    m_pageCosts.fill(0, m_pages.size());
+    m_residentCost = 0;
+    m_evictedPages.clear();
+    for (int pageIndex = 0; pageIndex * m_batchSize < fresh.size(); ++pageIndex) {
+        m_pages[pageIndex] = fresh.mid(pageIndex * m_batchSize, pageSize(pageIndex));
+        m_pages[pageIndex].resize(pageSize(pageIndex));
+
+        setPageCost(pageIndex, recordsCost(m_pages[pageIndex]));
+    }
+
+    m_refreshRecords = nullptr;
+
+    // the fresh listing could load more pages than the budget allows
+    enforceMemoryBudget();
+
+    // records are released on a worker thread, to keep GUI thread responsive
+    QtConcurrent::run([pages = std::move(pages), records = std::move(records)]() mutable {
+        pages.clear();
+        records.clear();
+    });
+
+    // only the records which actually changed are signalled, in contiguous runs
+    for (int first = 0; first < recordDiffs.size(); ++first) {
+        if (!recordDiffs[first]) {
+            continue;
+        }
+
+        int last = first;
+        quint32 runDiff = recordDiffs[first];
+        while (last + 1 < recordDiffs.size() && recordDiffs[last + 1]) {
+            runDiff |= recordDiffs[++last];
+        }
+
+        emit dataChanged(index(first), index(last), rolesForDiff(runDiff));
+        first = last;
+    }
+
+    if (hasTailPages && fresh.size() < m_count) {
+        // visible rows beyond the refreshed range are requested again on access
+        emit dataChanged(index(fresh.size()), index(m_count - 1));
+    }
+}
+
+int SynoAlbum::loadedExtent() const
+{
+    for (int pageIndex = m_pages.size() - 1; pageIndex >= 0; --pageIndex) {
+        if (m_pageCosts[pageIndex]) {
+            return std::min(m_count, (pageIndex + 1) * m_batchSize);
+        }
+    }
+
+    return 0;
+}
+
+void SynoAlbum::setPageCost(int pageIndex, qint64 cost)
+{
+    if (cost != m_pageCosts[pageIndex]) {
+        m_residentCost += cost - m_pageCosts[pageIndex];
+        m_pageCosts[pageIndex] = cost;
+        emit residentCostChanged();
+    }
+}
+
+void SynoAlbum::enforceMemoryBudget()
+{
+    if (!m_memoryBudget) {
+        return;
+    }
+
+    // the pages farthest from the focus page are evicted first, the ones near it are always kept
+    int first = 0;
+    int last = m_pages.size() - 1;
+    while (m_residentCost > m_memoryBudget) {
+        while (first <= last && !m_pageCosts[first]) {
+            ++first;
+        }
+        while (last >= first && !m_pageCosts[last]) {
+            --last;
+        }
+        if (first > last) {
+            break;
+        }
+
+        const int pageIndex = (m_focusPage - first >= last - m_focusPage) ? first : last;
+        if (isNearFocus(pageIndex)) {
+            break;
+        }
+
+        evictPage(pageIndex);
+    }
+}
+
+void SynoAlbum::releasePages()
+{
+    // the refresh diffs loaded items, they are kept until it is finished
+    if (m_refreshPageCount || m_refreshRecords) {
+        return;
+    }
+
+    // the first page is kept, so the album is displayed at once
+    for (int pageIndex = 1; pageIndex < m_pages.size(); ++pageIndex) {
+        if (m_pageCosts[pageIndex]) {
+            evictPage(pageIndex);
+        }
+    }
+}
+
+void SynoAlbum::evictPage(int pageIndex)
+{
+    // row count is not changed, the page is requested again on access
+    QVector<SynoAlbumData> page;
+    std::swap(page, m_pages[pageIndex]);
+    setPageCost(pageIndex, 0);
+    m_evictedPages.insert(pageIndex);
+    ++g_evictedPageCount;
+
+    // records are released on a worker thread, to keep GUI thread responsive
+    QtConcurrent::run([page = std::move(page)]() mutable {
+        page.clear();
+    });
+}
+
+int SynoAlbum::pageCount(int size) const
+{
+    return (size + m_batchSize - 1) / m_batchSize;
+}
+
+int SynoAlbum::pageSize(int pageIndex) const
+{
+    return std::min(m_batchSize, m_count - pageIndex * m_batchSize);
+}
+
+void SynoAlbum::reconcile()
+{
+    // pages loaded before reconnection are validated against the service
+    resetValidation();
+    for (int pageIndex = 0; pageIndex < m_pages.size(); ++pageIndex) {
+        if (!m_pages[pageIndex].isEmpty()) {
+            m_cachedOffsets.insert(pageIndex * m_batchSize);
+        }
+    }
+
+    QSet<int> offlineOffsets;
+    std::swap(offlineOffsets, m_offlineOffsets);
+    m_cachedOffsets.subtract(offlineOffsets);
+
+    for (int offset : std::as_const(offlineOffsets)) {
+        fetch(offset);
+    }
+
+    loadInfo();
+}
+
+void SynoAlbum::onConnStatusChanged()
+{
+    bool isOffline = m_isSnapshot || (m_conn->status() == SynoConn::OFFLINE);
+    if (isOffline != m_isOffline) {
+        m_isOffline = isOffline;
+
+        if (m_isOffline) {
+            // pages not sent yet are requested once the connection is back
+            for (int pageIndex : std::as_const(m_pendingPages)) {
+                m_offlineOffsets.insert(pageIndex * m_batchSize);
+            }
+            m_pendingPages.clear();
+        }
+
+        if (!m_isOffline && m_conn->status() == SynoConn::API_LOADED) {
+            reconcile();
+        }
+
+        emit isStaleChanged();
+    }
+}
+
+int SynoAlbum::batchSize() const
+{
+    return m_batchSize;
+}
+
+void SynoAlbum::setBatchSize(int size)
+{
+    size = std::max(1, size);
+    if (size != m_batchSize) {
+        m_batchSize = size;
+
+        // the storage is laid out by batch size, loaded pages are dropped and served from cache again
+        if (m_count) {
+            cancelLoading();
+            resetSize(m_count);
+        }
+
+        emit batchSizeChanged();
+    }
+}
+
+bool SynoAlbum::isActive() const
+{
+    return m_isActive;
+}
+
+void SynoAlbum::setIsActive(bool value)
+{
+    if (value != m_isActive) {
+        m_isActive = value;
+
+        if (m_isActive) {
+            prefetchPages();
+        }
+
+        emit isActiveChanged();
+    }
+}
+
+void SynoAlbum::restoreSnapshot(const SynoAlbumData& selfData, int total, const QMap< int, QVector<SynoAlbumData> >& pages)
+{
+    clear();
+
+    m_isSnapshot = true;
+    m_isOffline = true;
+    resetValidation();
+    m_cachedOffsets.clear();
+    m_offlineOffsets.clear();
+
+    if (!selfData.isNull()) {
+        m_selfData.reset(new SynoAlbumData(selfData));
+        emit synoDataChanged();
+    }
+
+    // the records are in place before the view accesses the model
+    beginResetModel();
+
+    m_count = std::max(0, total);
+    m_pages = QVector< QVector<SynoAlbumData> >(pageCount(m_count));
+    m_pageCosts.fill(0, m_pages.size());
+    m_residentCost = 0;
+    m_evictedPages.clear();
+
+    for (auto iter = pages.cbegin(); iter != pages.cend(); ++iter) {
+        const int pageIndex = iter.key();
+        if (pageIndex < 0 || pageIndex >= m_pages.size() || iter->size() != pageSize(pageIndex)) {
+            continue;
+        }
+
+        m_pages[pageIndex] = iter.value();
+
+        setPageCost(pageIndex, recordsCost(m_pages[pageIndex]));
+    }
+
+    endResetModel();
+
+    emit isStaleChanged();
+}
+
+void SynoAlbum::reconcileSnapshot()
+{
+    if (!m_isSnapshot) {
+        return;
+    }
+
+    m_isSnapshot = false;
+    m_isOffline = (m_conn->status() == SynoConn::OFFLINE);
+
+    if (m_isOffline) {
+        // records of the snapshot are shown as cached ones
+        emit isStaleChanged();
+    } else {
+        // records of the snapshot are kept until the listing is received and diffed
+        refresh(true);
+    }
+}
+
+int SynoAlbum::viewIndex() const
+{
+    return m_viewIndex;
+}
+
+void SynoAlbum::setViewIndex(int value)
+{
+    if (value != m_viewIndex) {
+        m_viewIndex = value;
+        emit viewIndexChanged();
+    }
+}
+
+QStringList SynoAlbum::focusedItemIds() const
+{
+    QStringList ids;
+    if (m_focusPage < m_pages.size()) {
+        const QVector<SynoAlbumData>& page = m_pages[m_focusPage];
+        ids.reserve(page.size());
+        for (const SynoAlbumData& record : page) {
+            if (!record.id.isEmpty()) {
+                ids.append(record.id);
+            }
+        }
+    }
+
+    return ids;
+}
+
+qint64 SynoAlbum::residentCost() const
+{
+    return m_residentCost;
+}
+
+SynoAlbum::FetchStatistics SynoAlbum::fetchStatistics()
+{
+    return g_fetchStatistics;
+}
+
+QPair<quint64, quint64> SynoAlbum::evictionStatistics()
+{
+    return qMakePair(g_evictedPageCount, g_reloadedPageCount);
+}
+
+SynoConn* SynoAlbum::conn() const
+{
+    return m_conn;
+}
+
+const SynoAlbumData& SynoAlbum::synoData() const
+{
+    return m_selfData ? *m_selfData : SynoAlbumData::null;
+}
+
+const QString& SynoAlbum::path() const
+{
+    return m_path;
+}
+
+const QByteArray& SynoAlbum::id() const
+{
+    return m_id;
+}
+
+bool SynoAlbum::hasParent() const
+{
+    return m_path.size() > 0;
+}
+
+bool SynoAlbum::isStale() const
+{
+    return m_isOffline || !m_cachedOffsets.isEmpty();
 }
 
 QString SynoAlbum::normalizedPath(const QString& path)
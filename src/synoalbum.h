@@ -22,11 +22,18 @@
 #include <memory>
 
 #include <QAbstractListModel>
+#include <QMap>
 #include <QQmlEngine>
+#include <QQueue>
+#include <QSet>
+#include <QTimer>
+
+#include <functional>
 
 #include "synoalbumdata.h"
 
 class SynoConn;
+class SynoRequest;
 
 class SynoAlbum : public QAbstractListModel
 {
@@ -40,14 +47,40 @@ class SynoAlbum : public QAbstractListModel
     Q_PROPERTY(QByteArray id READ id NOTIFY idChanged)
     Q_PROPERTY(bool hasParent READ hasParent NOTIFY hasParentChanged)
     Q_PROPERTY(int batchSize READ batchSize WRITE setBatchSize NOTIFY batchSizeChanged)
+    Q_PROPERTY(bool isStale READ isStale NOTIFY isStaleChanged)
+    Q_PROPERTY(bool isActive READ isActive WRITE setIsActive NOTIFY isActiveChanged)
+    Q_PROPERTY(int viewIndex READ viewIndex WRITE setViewIndex NOTIFY viewIndexChanged)
 
 public:
     enum SynoAlbumRoles
     {
-        RoleSynoData = Qt::UserRole + 1
+        RoleSynoData = Qt::UserRole + 1,
+        RoleId,
+        RoleType,
+        RoleThumbPreviewSize,
+        RoleThumbSmallSize,
+        RoleThumbLargeSize,
+        RoleThumbPreviewMtime,
+        RoleThumbSmallMtime,
+        RoleThumbLargeMtime,
+        RolePermBrowse,
+        RolePermUpload,
+        RolePermManage,
+        RoleTakenDate
     };
     Q_ENUM(SynoAlbumRoles)
 
+    /*! Counters of fetched album pages, for all albums */
+    struct FetchStatistics
+    {
+        /*! Pages committed to the model */
+        quint64 used = 0;
+        /*! Pages received, but dropped as outdated */
+        quint64 wasted = 0;
+        /*! Requests cancelled before the reply was received */
+        quint64 cancelled = 0;
+    };
+
 public:
     SynoAlbum(SynoConn* conn, const SynoAlbumData& synoData, QObject* parent = nullptr);
     SynoAlbum(SynoConn* conn, const QString& path, QObject* parent = nullptr);
@@ -61,7 +94,26 @@ public:
      * \returns Album data for the index, or empty data
      */
     Q_INVOKABLE SynoAlbumData get(int index) const;
-    SynoAlbumData* getPtr(int index);
+    const SynoAlbumData* getPtr(int index);
+
+    /*! Returns loaded record for the index, or nullptr. Unlike getPtr() it never requests pages */
+    const SynoAlbumData* peek(int index) const;
+
+    /*! Returns true if all items are loaded */
+    bool isLoaded() const;
+
+    /*!
+     * \brief This method sets order and item types of the listing requested from the service.
+     *
+     * Loaded items are dropped if the listing is changed.
+     *
+     * \param sortBy Sort field of the service, or empty for the service default order
+     * \param sortDescending Sort direction
+     * \param itemTypes Item types included in the listing
+     */
+    void setListing(const QByteArray& sortBy, bool sortDescending, const QByteArrayList& itemTypes);
+    /*! Returns true if the listing is in the service default order and includes all item types */
+    bool hasDefaultListing() const;
 
     QHash<int, QByteArray> roleNames() const override;
     int rowCount(const QModelIndex& parent) const override;
@@ -70,11 +122,59 @@ public:
     int batchSize() const;
     void setBatchSize(int size);
 
+    SynoConn* conn() const;
     const SynoAlbumData& synoData() const;
     const QString& path() const;
     const QByteArray& id() const;
     bool hasParent() const;
 
+    /*! Returns true if the album shows cached data which is not confirmed by the service */
+    bool isStale() const;
+
+    /*!
+     * Returns true if the album is displayed. Inactive album fetches one page at a time,
+     * does not prefetch, and sends its requests in background
+     */
+    bool isActive() const;
+    void setIsActive(bool value);
+
+    /*! Returns index of the current item of the view, it is restored when the album is displayed again */
+    int viewIndex() const;
+    void setViewIndex(int value);
+
+    /*! Returns ids of loaded items of the page accessed by the view most recently */
+    QStringList focusedItemIds() const;
+
+    /*! Returns memory cost of loaded items in bytes */
+    qint64 residentCost() const;
+
+    /*!
+     * \brief Releases loaded items except the first page
+     *
+     * Album info and total count of items are kept, released pages are requested again on access.
+     * Nothing is released while the album is being refreshed.
+     */
+    void releasePages();
+
+    /*!
+     * \brief Fills the album with records persisted by a session snapshot
+     *
+     * The album is stale, and nothing is requested until reconcileSnapshot() is called.
+     * Records are laid out by the current batch size, pages of another size are skipped.
+     *
+     * \param selfData Album info, or null record
+     * \param total Total amount of items
+     * \param pages Records of the pages, keyed by page index
+     */
+    void restoreSnapshot(const SynoAlbumData& selfData, int total, const QMap< int, QVector<SynoAlbumData> >& pages);
+    /*! Diffs records of the snapshot against the listing of the service, without resetting the model */
+    void reconcileSnapshot();
+
+    static FetchStatistics fetchStatistics();
+
+    /*! Returns amounts of pages evicted and reloaded after eviction, for all albums */
+    static QPair<quint64, quint64> evictionStatistics();
+
     static QString normalizedPath(const QString& path);
     static QByteArray albumIdByPath(const QString& path);
     static QString pathByAlbumId(const QByteArray& albumId);
@@ -85,23 +185,169 @@ signals:
     void idChanged();
     void hasParentChanged();
     void batchSizeChanged();
+    void isStaleChanged();
+    void isActiveChanged();
+    void viewIndexChanged();
+    void residentCostChanged();
 
 public slots:
     void clear();
     void refresh(bool force);
 
 private:
+    struct ParsedPage;
+
     void load(int offset);
+    void fetch(int offset);
+    void sendPage(int pageIndex);
+    void schedulePages();
+    int pageDistance(int pageIndex) const;
+    void setFocusPage(int pageIndex);
+    void prefetchPages();
+    void finishSeek();
+    bool isNearFocus(int pageIndex) const;
+    bool dropPlaceholderPage(int pageIndex);
     void loadInfo();
+    void setFirstPageSignature(const ParsedPage& page);
+    void revalidate();
+    void resetValidation();
+    void processListReply(int offset, const QMap<int, QByteArray>& replies, bool isFetched, quint64 generation,
+                          const std::function<void(bool, int)>& callback);
+    void parseReply(int offset, const QMap<int, QByteArray>& replies, const QVector<SynoAlbumData>& base,
+                    const std::function<void(std::shared_ptr<ParsedPage>)>& callback);
+    static std::shared_ptr<ParsedPage> parseListReply(int offset, const QMap<int, QByteArray>& replies,
+                                                      const QVector<SynoAlbumData>& base);
+    static void releaseParsedPage(std::shared_ptr<ParsedPage>&& page);
+    void commitParsedPages();
+    bool processInfoReply(const QByteArray& replyBody);
+    QByteArrayList listFormData(int offset) const;
+    QByteArrayList listingFormData() const;
+    QByteArrayList infoFormData() const;
     void resetSize(int size);
+    void startRefresh();
+    void fetchRefreshPage(int offset);
+    void finishRefresh();
+    void cancelRefresh();
+    void cancelLoading();
+    void cancelPageRequests();
+    void cancelInfoRequests();
+    void applyRefresh(int total, const QVector<SynoAlbumData>& fresh);
+    int loadedExtent() const;
+    static QVector<int> rolesForDiff(quint32 diff);
+    void setPageCost(int pageIndex, qint64 cost);
+    void enforceMemoryBudget();
+    void evictPage(int pageIndex);
+    int pageCount(int size) const;
+    int pageSize(int pageIndex) const;
+    void reconcile();
+    void onConnStatusChanged();
 
 private:
     SynoConn *m_conn;
     std::unique_ptr<SynoAlbumData> m_selfData;
-    QVector<SynoAlbumData*> m_descendantData;
+    /*!
+     * Items storage, split into pages of batch size. Each page is a single allocation,
+     * pages which were not requested yet are empty.
+     */
+    QVector< QVector<SynoAlbumData> > m_pages;
+    /*! Memory cost of each loaded page, 0 for pages which are not loaded */
+    QVector<qint64> m_pageCosts;
+    /*! Memory cost of all loaded pages */
+    qint64 m_residentCost;
+    /*! Memory budget of loaded pages, pages far from the focus page are evicted above it; 0 is unlimited */
+    qint64 m_memoryBudget;
+    /*! Pages evicted and not requested since */
+    QSet<int> m_evictedPages;
+    /*! Total amount of items */
+    int m_count;
+    /*! Sort field of the listing, empty for the service default order */
+    QByteArray m_sortBy;
+    bool m_sortDescending;
+    /*! Item types included in the listing */
+    QByteArrayList m_itemTypes;
     QString m_path;
     QByteArray m_id;
     int m_batchSize;
+    /*! Cached replies of the album are confirmed to be up to date */
+    bool m_isCacheValidated;
+    /*! Offsets of the pages served from cache before validation */
+    QSet<int> m_cachedOffsets;
+    /*! Fetched album info waiting for the first page to validate cached replies */
+    QByteArray m_validationInfoReply;
+    /*! Signature of the fetched first page waiting for album info, null if not fetched yet */
+    QByteArray m_firstPageSignature;
+    /*! Amount of fetched first pages being parsed, the validation waits for them */
+    int m_firstPageParseCount;
+    /*! Offsets of the pages fetched since validation, their cached replies are up to date */
+    QSet<int> m_fetchedOffsets;
+    /*! Offsets of the pages requested in offline mode and not found in cache */
+    QSet<int> m_offlineOffsets;
+    /*! Connection is in offline mode, or the album shows a snapshot which is not reconciled yet */
+    bool m_isOffline;
+    /*! Album shows records of a session snapshot */
+    bool m_isSnapshot;
+    /*! Pages parsed by worker threads, waiting to be committed to the model */
+    QQueue< std::shared_ptr<ParsedPage> > m_parsedPages;
+    /*! Timer committing parsed pages in time slices, paced by frame interval */
+    QTimer m_commitTimer;
+    /*! Maximum time of single commit slice, in ms */
+    int m_commitBudgetMs;
+    /*! Number of model content, replies parsed for outdated content are dropped */
+    quint64 m_generation;
+    /*! Page accessed by the view most recently */
+    int m_focusPage;
+    /*! Direction of the view scrolling: 1 forward, -1 backward */
+    int m_scrollDirection;
+    /*! Pages to be fetched, sent in order of distance from the focus page */
+    QList<int> m_pendingPages;
+    /*! Requests of the pages being fetched */
+    QHash< int, std::shared_ptr<SynoRequest> > m_inFlightPages;
+    /*! Maximum amount of pages being fetched at once */
+    int m_maxPagesInFlight;
+    /*! Amount of pages requested ahead of the scroll direction */
+    int m_pagesAhead;
+    /*! Timer requesting pages ahead once the view finished data access */
+    QTimer m_prefetchTimer;
+    /*! The view jumps over the album, pages it passes through are not requested */
+    bool m_isSeeking;
+    /*! Timer detecting the end of seeking */
+    QTimer m_seekTimer;
+    /*! Pages accessed during seeking, requested only if the view stops near them */
+    QSet<int> m_deferredPages;
+    /*! Number of fetch queue, replies to requests sent before clear are not accounted */
+    quint64 m_fetchGeneration;
+    /*! Requests of album info in progress */
+    QHash< SynoRequest*, std::shared_ptr<SynoRequest> > m_infoRequests;
+    /*! Number of fetched album info, cached info read before is dropped */
+    quint64 m_infoGeneration;
+    /*! Album is displayed */
+    bool m_isActive;
+    /*! Index of the current item of the view */
+    int m_viewIndex;
+    /*! Requests of the refresh in progress, keyed by offset */
+    QHash< int, std::shared_ptr<SynoRequest> > m_refreshRequests;
+    /*! Listing pages received by the refresh in progress, keyed by offset */
+    QMap< int, std::shared_ptr<ParsedPage> > m_refreshPages;
+    /*! Amount of listing pages requested by the refresh in progress, 0 if there is no refresh */
+    int m_refreshPageCount;
+    /*! Amount of leading items which are refreshed with keyed diffing */
+    int m_refreshExtent;
+    /*! Maximum amount of items refreshed with keyed diffing, larger albums are reloaded */
+    int m_refreshMaxItems;
+    /*! Number of refresh, replies of the cancelled refresh are dropped */
+    quint64 m_refreshGeneration;
+    /*! Amount of restarts of the refresh because the listing changed between its pages */
+    int m_refreshRetryCount;
+    /*! Maximum amount of refresh restarts, the album is reloaded afterwards */
+    int m_refreshMaxRetries;
+    /*! Delay of the first refresh restart, it doubles with every restart */
+    int m_refreshRetryDelayMs;
+    /*! Timer restarting the refresh */
+    QTimer m_refreshRetryTimer;
+    /*! Records of the refreshed range while the diff is being applied, null otherwise */
+    QVector<SynoAlbumData>* m_refreshRecords;
+    /*! Record returned for rows which are not loaded while the diff is being applied */
+    SynoAlbumData m_placeholder;
 };
 
 #endif // SYNOALBUM_H
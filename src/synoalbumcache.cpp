@@ -17,19 +17,27 @@
  */
 
 #include "synoalbumcache.h"
+#include "synoalbum.h"
 #include "synosettings.h"
 
+// cost of an album without loaded items, in KB
+static constexpr int g_albumBaseCost = 1;
+
 SynoAlbumCache::SynoAlbumCache()
-    : m_hitCount(0)
-    , m_missCount(0)
+    : m_missCount(0)
+    , m_hitCount(0)
+    , m_releaseCount(0)
+    , m_evictionCount(0)
 {
     SynoSettings settings(QStringLiteral("performance"));
-    int maximumCountItems = qBound(0, settings.value(QStringLiteral("ramAlbumCacheItems"), 50).toInt(), std::numeric_limits<int>::max());
+    m_maxCost = qBound(1, settings.value(QStringLiteral("ramAlbumCacheMb"), 64).toInt(), std::numeric_limits<int>::max() / 1024) * 1024;
+    m_maxCount = qBound(1, settings.value(QStringLiteral("ramAlbumCacheItems"), 500).toInt(), std::numeric_limits<int>::max());
 
-    m_cache = CacheType(maximumCountItems);
+    // the budget is enforced by this class, as pinned albums are skipped
+    m_cache = CacheType(std::numeric_limits<int>::max());
 }
 
- SynoAlbumCache::CacheType::mapped_type SynoAlbumCache::object(const QString& path)
+SynoAlbumCache::CacheType::mapped_type SynoAlbumCache::object(const QString& path)
 {
     CacheType::mapped_type value = m_cache.object(path);
     if (value) {
@@ -42,7 +50,8 @@ SynoAlbumCache::SynoAlbumCache()
 
 void SynoAlbumCache::insert(const QString& path, SynoAlbumCache::CacheType::mapped_type album)
 {
-    m_cache.insert(path, album, 1);
+    // the budget is enforced once the cost of the album is known
+    m_cache.insert(path, album, g_albumBaseCost);
 }
 
 void SynoAlbumCache::remove(const QString& path)
@@ -55,11 +64,87 @@ void SynoAlbumCache::clear()
     m_cache.clear();
 }
 
+SynoAlbumCache::CacheType::mapped_type SynoAlbumCache::peek(const QString& path) const
+{
+    return m_cache.peek(path);
+}
+
+void SynoAlbumCache::updateCost(const QString& path)
+{
+    SynoAlbum* album = qobject_cast<SynoAlbum*>(m_cache.peek(path).get());
+    if (!album) {
+        return;
+    }
+
+    const qint64 cost = g_albumBaseCost + album->residentCost() / 1024;
+    m_cache.setCost(path, static_cast<int>(qMin<qint64>(cost, std::numeric_limits<int>::max() / 2)));
+    enforceBudget();
+}
+
+void SynoAlbumCache::setPinned(const QSet<QString>& paths)
+{
+    m_pinned = paths;
+    enforceBudget();
+}
+
+bool SynoAlbumCache::isOverBudget() const
+{
+    return m_cache.totalCost() > m_maxCost || m_cache.count() > m_maxCount;
+}
+
+void SynoAlbumCache::enforceBudget()
+{
+    if (!isOverBudget()) {
+        return;
+    }
+
+    const QList<QString> paths = m_cache.keysByUsage();
+
+    // the least recently used albums release their items first, so they are still displayed at once
+    for (const QString& path : paths) {
+        if (m_cache.totalCost() <= m_maxCost) {
+            break;
+        }
+
+        SynoAlbum* album = qobject_cast<SynoAlbum*>(m_cache.peek(path).get());
+        if (!album || m_pinned.contains(path) || album->isActive()) {
+            continue;
+        }
+
+        const qint64 residentCost = album->residentCost();
+        album->releasePages();
+        if (album->residentCost() < residentCost) {
+            ++m_releaseCount;
+            m_cache.setCost(path, static_cast<int>(g_albumBaseCost + album->residentCost() / 1024));
+        }
+    }
+
+    // then the albums are removed, the ones referenced elsewhere are kept alive by their owners
+    for (const QString& path : paths) {
+        if (!isOverBudget()) {
+            break;
+        }
+
+        SynoAlbum* album = qobject_cast<SynoAlbum*>(m_cache.peek(path).get());
+        if (m_pinned.contains(path) || (album && album->isActive())) {
+            continue;
+        }
+
+        m_cache.remove(path);
+        ++m_evictionCount;
+    }
+}
+
 SynoAlbumCache::CacheType::size_type SynoAlbumCache::count() const
 {
     return m_cache.count();
 }
 
+SynoAlbumCache::CacheType::size_type SynoAlbumCache::totalCost() const
+{
+    return m_cache.totalCost();
+}
+
 quint64 SynoAlbumCache::hitCount() const
 {
     return m_hitCount;
@@ -70,3 +155,12 @@ quint64 SynoAlbumCache::missCount() const
     return m_missCount;
 }
 
+quint64 SynoAlbumCache::releaseCount() const
+{
+    return m_releaseCount;
+}
+
+quint64 SynoAlbumCache::evictionCount() const
+{
+    return m_evictionCount;
+}
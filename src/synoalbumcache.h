@@ -20,9 +20,18 @@
 #define SYNOALBUMCACHE_H
 
 #include <QObject>
+#include <QSet>
 
 #include "cache.h"
 
+/*!
+ * \brief Cache of the albums
+ *
+ * Cost of an album is the memory used by its loaded items. Once the cache exceeds its budget,
+ * the least recently used albums release their items except the first page, and then are
+ * removed entirely. Pinned albums, e.g. the displayed one and the ones the user navigates
+ * back to, are never released.
+ */
 class SynoAlbumCache
 {
     using CacheType = Cache< QString, std::shared_ptr<QObject> >;
@@ -35,17 +44,43 @@ public:
     void remove(const QString& path);
     void clear();
 
+    /*! Returns album without marking it as recently used */
+    CacheType::mapped_type peek(const QString& path) const;
+
+    /*! Updates cost of the album by its loaded items, and enforces the budget */
+    void updateCost(const QString& path);
+
+    /*! Sets paths of the albums which are never released, the budget is enforced for the rest */
+    void setPinned(const QSet<QString>& paths);
+
     /*! Returns amount of albums in cache */
     CacheType::size_type count() const;
+    /*! Returns memory used by albums in cache in KB */
+    CacheType::size_type totalCost() const;
     /*! Returns cache hit counter */
     quint64 hitCount() const;
     /*! Returns cache miss counter */
     quint64 missCount() const;
+    /*! Returns amount of albums which released their items */
+    quint64 releaseCount() const;
+    /*! Returns amount of albums removed from cache */
+    quint64 evictionCount() const;
+
+private:
+    void enforceBudget();
+    bool isOverBudget() const;
 
 private:
     CacheType m_cache;
+    QSet<QString> m_pinned;
+    /*! Memory budget of the albums in KB */
+    int m_maxCost;
+    /*! Maximum amount of albums */
+    int m_maxCount;
     quint64 m_missCount;
     quint64 m_hitCount;
+    quint64 m_releaseCount;
+    quint64 m_evictionCount;
 };
 
 #endif // SYNOALBUMCACHE_H
@@ -18,11 +18,158 @@
 
 #include "synoalbumdata.h"
 
+#include <QHash>
 #include <QJsonObject>
-#include <QMetaProperty>
+#include <QReadWriteLock>
+#include <QVector>
 
 const SynoAlbumData SynoAlbumData::null = SynoAlbumData();
 
+namespace {
+
+struct AtomTable
+{
+    AtomTable() {
+        strings.append(QString());
+        atoms.insert(QString(), SynoAtom(0));
+    }
+
+    QReadWriteLock lock;
+    QHash<QString, SynoAtom> atoms;
+    QVector<QString> strings;
+};
+
+// FNV-1a, as qHash() is seeded per process
+constexpr quint64 g_hashBasis = 14695981039346656037ULL;
+constexpr quint64 g_hashPrime = 1099511628211ULL;
+
+inline quint64 hashBytes(quint64 h, const void* data, size_t size)
+{
+    const uchar* bytes = static_cast<const uchar*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        h = (h ^ bytes[i]) * g_hashPrime;
+    }
+    return h;
+}
+
+inline quint64 hashField(quint64 h, const QString& value)
+{
+    h = hashBytes(h, value.constData(), static_cast<size_t>(value.size()) * sizeof(QChar));
+    // separator, so adjacent strings do not collide on concatenation
+    return (h ^ 0xff) * g_hashPrime;
+}
+
+inline quint64 hashField(quint64 h, const QSize& value)
+{
+    const qint32 dims[2] = {value.width(), value.height()};
+    return hashBytes(h, dims, sizeof(dims));
+}
+
+inline quint64 hashField(quint64 h, int value)
+{
+    const qint32 v = value;
+    return hashBytes(h, &v, sizeof(v));
+}
+
+inline quint64 hashField(quint64 h, qint64 value)
+{
+    return hashBytes(h, &value, sizeof(value));
+}
+
+inline quint64 hashField(quint64 h, quint8 value)
+{
+    return hashBytes(h, &value, sizeof(value));
+}
+
+inline quint64 hashField(quint64 h, SynoAtom value)
+{
+    // atom values depend on interning order, so the string is hashed
+    return hashField(h, SynoAtoms::string(value));
+}
+
+AtomTable& atomTable()
+{
+    static AtomTable table;
+    return table;
+}
+
+// heap memory of the field, also if it is shared with a temporary copy like a parsed page;
+// static strings have no capacity
+inline qint64 heapCost(const QString& value)
+{
+    return static_cast<qint64>(value.capacity()) * sizeof(QChar);
+}
+
+template <typename T>
+inline qint64 heapCost(const T&)
+{
+    return 0;
+}
+
+template <typename T>
+inline void writeField(QDataStream& out, const T& value)
+{
+    out << value;
+}
+
+inline void writeField(QDataStream& out, SynoAtom value)
+{
+    out << SynoAtoms::string(value);
+}
+
+template <typename T>
+inline void readField(QDataStream& in, T& value)
+{
+    in >> value;
+}
+
+inline void readField(QDataStream& in, SynoAtom& value)
+{
+    QString str;
+    in >> str;
+    value = SynoAtoms::atom(str);
+}
+
+} // namespace
+
+SynoAtom SynoAtoms::atom(const QString& str)
+{
+    if (str.isEmpty()) {
+        return SynoAtom(0);
+    }
+
+    AtomTable& table = atomTable();
+    {
+        QReadLocker locker(&table.lock);
+        auto iter = table.atoms.constFind(str);
+        if (iter != table.atoms.constEnd()) {
+            return iter.value();
+        }
+    }
+
+    QWriteLocker locker(&table.lock);
+    auto iter = table.atoms.constFind(str);
+    if (iter != table.atoms.constEnd()) {
+        return iter.value();
+    }
+
+    SynoAtom atom = SynoAtom(static_cast<quint32>(table.strings.size()));
+    table.strings.append(str);
+    table.atoms.insert(str, atom);
+    return atom;
+}
+
+QString SynoAtoms::string(SynoAtom atom)
+{
+    if (atom == SynoAtom(0)) {
+        return QString();
+    }
+
+    AtomTable& table = atomTable();
+    QReadLocker locker(&table.lock);
+    return table.strings.value(static_cast<int>(atom));
+}
+
 static inline
 std::tuple<QSize, int> readThumbInfo(const QJsonObject& albumSizeDataObject) {
     QSize size(albumSizeDataObject[QStringLiteral("resolutionx")].toInt(),
@@ -36,31 +183,99 @@ bool SynoAlbumData::isNull() const
     return (this == &null) || (*this == null);
 }
 
+QStringList SynoAlbumData::thumbnail_status() const
+{
+    return SynoAtoms::string(m_thumbnailStatus).split(',', QString::SkipEmptyParts);
+}
+
+QDateTime SynoAlbumData::takendate() const
+{
+    return m_takenTime ? QDateTime::fromSecsSinceEpoch(m_takenTime, Qt::UTC) : QDateTime();
+}
+
+void SynoAlbumData::setTakenDate(const QString& value)
+{
+    // parsed by hand, as QDateTime::fromString() is slow for every listed item
+    if (value.size() < 19) {
+        return;
+    }
+
+    auto number = [&value](int pos, int len) {
+        int result = 0;
+        for (int i = pos; i < pos + len; ++i) {
+            const int digit = value[i].unicode() - '0';
+            if (digit < 0 || digit > 9) {
+                return -1;
+            }
+            result = result * 10 + digit;
+        }
+        return result;
+    };
+
+    const QDate date(number(0, 4), number(5, 2), number(8, 2));
+    const int hour = number(11, 2);
+    const int minute = number(14, 2);
+    const int second = number(17, 2);
+    if (!date.isValid() || hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0 || second > 59) {
+        return;
+    }
+
+    constexpr qint64 epochJulianDay = 2440588;
+    m_takenTime = (date.toJulianDay() - epochJulianDay) * 86400 + hour * 3600 + minute * 60 + second;
+}
+
+QString SynoAlbumData::joinPath(SynoAtom parent, const QString& name)
+{
+    if (parent == SynoAtom(0)) {
+        return name;
+    }
+
+    return SynoAtoms::string(parent) + QLatin1Char('/') + name;
+}
+
+void SynoAlbumData::splitPath(const QString& path, SynoAtom& parent, QString& name)
+{
+    // items of an album share the parent path
+    int sepIdx = path.lastIndexOf(QLatin1Char('/'));
+    if (sepIdx > 0) {
+        parent = SynoAtoms::atom(path.left(sepIdx));
+        name = path.mid(sepIdx + 1);
+    } else {
+        parent = SynoAtom(0);
+        name = path;
+    }
+}
+
 void SynoAlbumData::readFrom(const QJsonObject& albumDataObject)
 {
     id = albumDataObject[QStringLiteral("id")].toString();
-    type = albumDataObject[QStringLiteral("type")].toString();
-    thumbnail_status = albumDataObject[QStringLiteral("thumbnail_status")].toString().split(',', QString::SkipEmptyParts);
+    setType(albumDataObject[QStringLiteral("type")].toString());
+    setThumbnailStatus(albumDataObject[QStringLiteral("thumbnail_status")].toString());
 
     QJsonObject infoObject = albumDataObject[QStringLiteral("info")].toObject();
-    sharepath = infoObject[QStringLiteral("sharepath")].toString();
+    setSharepath(infoObject[QStringLiteral("sharepath")].toString());
     name = infoObject[QStringLiteral("name")].toString();
     title = infoObject[QStringLiteral("title")].toString();
     description = infoObject[QStringLiteral("description")].toString();
     hits = infoObject[QStringLiteral("hits")].toInt();
-    info_type = infoObject[QStringLiteral("type")].toString();
-    conversion = infoObject[QStringLiteral("conversion")].toBool();
-    allow_comment = infoObject[QStringLiteral("allow_comment")].toBool();
-    allow_embed = infoObject[QStringLiteral("allow_embed")].toBool();
+    setInfoType(infoObject[QStringLiteral("type")].toString());
+    m_takenTime = 0;
+    setTakenDate(infoObject[QStringLiteral("takendate")].toString());
+    setConversion(infoObject[QStringLiteral("conversion")].toBool());
+    setAllowComment(infoObject[QStringLiteral("allow_comment")].toBool());
+    setAllowEmbed(infoObject[QStringLiteral("allow_embed")].toBool());
 
     QJsonObject additionalObject = albumDataObject[QStringLiteral("additional")].toObject();
-    file_location = additionalObject[QStringLiteral("file_location")].toString();
-    path = file_location;
+    setFileLocation(additionalObject[QStringLiteral("file_location")].toString());
+
+    // EXIF value has precedence over the one of item info
+    QJsonObject additionalExifObject = additionalObject[QStringLiteral("photo_exif")].toObject();
+    setTakenDate(additionalExifObject[QStringLiteral("takendate")].toString());
 
     QJsonObject additionalAlbumPermissionObject = additionalObject[QStringLiteral("album_permission")].toObject();
-    perm_browse = additionalAlbumPermissionObject[QStringLiteral("browse")].toBool();
-    perm_upload = additionalAlbumPermissionObject[QStringLiteral("upload")].toBool();
-    perm_manage = additionalAlbumPermissionObject[QStringLiteral("manage")].toBool();
+    setPermBrowse(additionalAlbumPermissionObject[QStringLiteral("browse")].toBool());
+    setPermUpload(additionalAlbumPermissionObject[QStringLiteral("upload")].toBool());
+    setPermManage(additionalAlbumPermissionObject[QStringLiteral("manage")].toBool());
 
     QJsonObject additionalThumbSizeObject = additionalObject[QStringLiteral("thumb_size")].toObject();
     thumb_sig = additionalThumbSizeObject[QStringLiteral("sig")].toString();
@@ -77,14 +292,51 @@ void SynoAlbumData::readFrom(const QJsonObject& albumDataObject)
 
 bool SynoAlbumData::operator==(const SynoAlbumData& o) const
 {
-    for (int i = 0; i < staticMetaObject.propertyCount(); ++i) {
-        QMetaProperty prop = staticMetaObject.property(i);
-        QVariant propValSelf = prop.readOnGadget(this);
-        QVariant propValOther = prop.readOnGadget(&o);
-        if (propValSelf != propValOther) {
-            return false;
-        }
-    }
+    return std::apply([&](auto... members) {
+        return ((this->*members == o.*members) && ...);
+    }, fields());
+}
+
+quint64 SynoAlbumData::contentHash() const
+{
+    return std::apply([&](auto... members) {
+        quint64 h = g_hashBasis;
+        ((h = hashField(h, this->*members)), ...);
+        return h;
+    }, fields());
+}
 
-    return true;
+qint64 SynoAlbumData::memoryCost() const
+{
+    return std::apply([&](auto... members) {
+        return static_cast<qint64>(sizeof(SynoAlbumData)) + (heapCost(this->*members) + ...);
+    }, fields());
+}
+
+template <size_t... I>
+quint32 SynoAlbumData::diffImpl(const SynoAlbumData& o, std::index_sequence<I...>) const
+{
+    constexpr auto members = fields();
+    return ((this->*std::get<I>(members) == o.*std::get<I>(members) ? 0u : (1u << I)) | ... | 0u);
+}
+
+quint32 SynoAlbumData::diff(const SynoAlbumData& o) const
+{
+    return diffImpl(o, std::make_index_sequence<SynoAlbumDataFieldCount>());
+}
+
+QDataStream& operator<<(QDataStream& out, const SynoAlbumData& data)
+{
+    std::apply([&](auto... members) {
+        (writeField(out, data.*members), ...);
+    }, SynoAlbumData::fields());
+    return out;
+}
+
+QDataStream& operator>>(QDataStream& in, SynoAlbumData& data)
+{
+    std::apply([&](auto... members) {
+        (readField(in, data.*members), ...);
+    }, SynoAlbumData::fields());
+    return in;
 }
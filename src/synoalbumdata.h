@@ -19,31 +19,63 @@
 #ifndef SYNOALBUMDATA_H
 #define SYNOALBUMDATA_H
 
+#include <QDataStream>
+#include <QDateTime>
 #include <QObject>
 #include <QSize>
+#include <QStringList>
 
+#include <tuple>
+#include <utility>
+
+/*! Interned string identifier */
+enum class SynoAtom : quint32 {};
+
+/*!
+ * \brief Table of interned strings
+ *
+ * Values repeated across many items, like item types and parent paths,
+ * are stored once and referenced by 32-bit atoms. Atom 0 is an empty string.
+ * Atoms are never released.
+ *
+ * This class is thread-safe.
+ */
+class SynoAtoms
+{
+public:
+    static SynoAtom atom(const QString& str);
+    static QString string(SynoAtom atom);
+};
+
+/*!
+ * \brief Album item record
+ *
+ * Item specific strings are stored as is, while repeated values are interned,
+ * flags are packed, and paths are split into interned parent path and own name.
+ * The compact values are materialized on property access.
+ */
 struct SynoAlbumData
 {
     Q_GADGET
 
     Q_PROPERTY(QString id MEMBER id)
-    Q_PROPERTY(QString type MEMBER type)
-    Q_PROPERTY(QString path MEMBER path)
+    Q_PROPERTY(QString type READ type)
+    Q_PROPERTY(QString path READ path)
 
-    Q_PROPERTY(QString sharepath MEMBER sharepath)
+    Q_PROPERTY(QString sharepath READ sharepath)
     Q_PROPERTY(QString name MEMBER name)
     Q_PROPERTY(QString title MEMBER title)
     Q_PROPERTY(QString description MEMBER description)
     Q_PROPERTY(int hits MEMBER hits)
-    Q_PROPERTY(QString info_type MEMBER info_type)
-    Q_PROPERTY(bool conversion MEMBER conversion)
-    Q_PROPERTY(bool allow_comment MEMBER allow_comment)
-    Q_PROPERTY(bool allow_embed MEMBER allow_embed)
-
-    Q_PROPERTY(bool perm_browse MEMBER perm_browse)
-    Q_PROPERTY(bool perm_upload MEMBER perm_upload)
-    Q_PROPERTY(bool perm_manage MEMBER perm_manage)
-    Q_PROPERTY(QString file_location MEMBER file_location)
+    Q_PROPERTY(QString info_type READ info_type)
+    Q_PROPERTY(bool conversion READ conversion)
+    Q_PROPERTY(bool allow_comment READ allow_comment)
+    Q_PROPERTY(bool allow_embed READ allow_embed)
+
+    Q_PROPERTY(bool perm_browse READ perm_browse)
+    Q_PROPERTY(bool perm_upload READ perm_upload)
+    Q_PROPERTY(bool perm_manage READ perm_manage)
+    Q_PROPERTY(QString file_location READ file_location)
     Q_PROPERTY(QSize thumb_preview_size MEMBER thumb_preview_size)
     Q_PROPERTY(int thumb_preview_mtime MEMBER thumb_preview_mtime)
     Q_PROPERTY(QSize thumb_small_size MEMBER thumb_small_size)
@@ -51,7 +83,8 @@ struct SynoAlbumData
     Q_PROPERTY(QSize thumb_large_size MEMBER thumb_large_size)
     Q_PROPERTY(int thumb_large_mtime MEMBER thumb_large_mtime)
     Q_PROPERTY(QString thumb_sig MEMBER thumb_sig)
-    Q_PROPERTY(QStringList thumbnail_status MEMBER thumbnail_status)
+    Q_PROPERTY(QStringList thumbnail_status READ thumbnail_status)
+    Q_PROPERTY(QDateTime takendate READ takendate)
 
 public:
     Q_INVOKABLE bool isNull() const;
@@ -63,35 +96,139 @@ public:
         return !(*this == o);
     }
 
+    /*! Returns 64-bit content hash, which is stable between application runs */
+    quint64 contentHash() const;
+
+    /*! Returns approximate memory footprint of the record in bytes, including storage of its strings */
+    qint64 memoryCost() const;
+
+    /*! Returns mask of fields which differ, with bits in order of fields() */
+    quint32 diff(const SynoAlbumData& o) const;
+
     static const SynoAlbumData null;
 
+public:
+    QString type() const { return SynoAtoms::string(m_type); }
+    void setType(const QString& value) { m_type = SynoAtoms::atom(value); }
+    QString info_type() const { return SynoAtoms::string(m_infoType); }
+    void setInfoType(const QString& value) { m_infoType = SynoAtoms::atom(value); }
+
+    /*! Path is the same as file location */
+    QString path() const { return file_location(); }
+    QString file_location() const { return joinPath(m_fileLocationParent, m_fileLocationName); }
+    void setFileLocation(const QString& value) { splitPath(value, m_fileLocationParent, m_fileLocationName); }
+    QString sharepath() const { return joinPath(m_sharepathParent, m_sharepathName); }
+    void setSharepath(const QString& value) { splitPath(value, m_sharepathParent, m_sharepathName); }
+
+    QStringList thumbnail_status() const;
+    void setThumbnailStatus(const QString& value) { m_thumbnailStatus = SynoAtoms::atom(value); }
+
+    /*! Capture time, or invalid value if unknown. The wall clock time of the camera is given in UTC. */
+    QDateTime takendate() const;
+    /*! Returns capture time in seconds since epoch, or 0 if unknown */
+    qint64 takenTime() const { return m_takenTime; }
+    /*! Sets capture time from "yyyy-MM-dd hh:mm:ss" value, invalid values are ignored */
+    void setTakenDate(const QString& value);
+
+    bool conversion() const { return flag(Flag_Conversion); }
+    void setConversion(bool value) { setFlag(Flag_Conversion, value); }
+    bool allow_comment() const { return flag(Flag_AllowComment); }
+    void setAllowComment(bool value) { setFlag(Flag_AllowComment, value); }
+    bool allow_embed() const { return flag(Flag_AllowEmbed); }
+    void setAllowEmbed(bool value) { setFlag(Flag_AllowEmbed, value); }
+    bool perm_browse() const { return flag(Flag_PermBrowse); }
+    void setPermBrowse(bool value) { setFlag(Flag_PermBrowse, value); }
+    bool perm_upload() const { return flag(Flag_PermUpload); }
+    void setPermUpload(bool value) { setFlag(Flag_PermUpload, value); }
+    bool perm_manage() const { return flag(Flag_PermManage); }
+    void setPermManage(bool value) { setFlag(Flag_PermManage, value); }
+
+    /*!
+     * \brief Returns pointers to all stored fields
+     *
+     * Equality, hashing and diffing are generated from this list at compile time,
+     * so every new field should be added here.
+     */
+    static constexpr auto fields() {
+        return std::make_tuple(&SynoAlbumData::id,
+                               &SynoAlbumData::name,
+                               &SynoAlbumData::title,
+                               &SynoAlbumData::description,
+                               &SynoAlbumData::thumb_sig,
+                               &SynoAlbumData::thumb_preview_size,
+                               &SynoAlbumData::thumb_small_size,
+                               &SynoAlbumData::thumb_large_size,
+                               &SynoAlbumData::thumb_preview_mtime,
+                               &SynoAlbumData::thumb_small_mtime,
+                               &SynoAlbumData::thumb_large_mtime,
+                               &SynoAlbumData::hits,
+                               &SynoAlbumData::m_fileLocationName,
+                               &SynoAlbumData::m_sharepathName,
+                               &SynoAlbumData::m_fileLocationParent,
+                               &SynoAlbumData::m_sharepathParent,
+                               &SynoAlbumData::m_type,
+                               &SynoAlbumData::m_infoType,
+                               &SynoAlbumData::m_thumbnailStatus,
+                               &SynoAlbumData::m_takenTime,
+                               &SynoAlbumData::m_flags);
+    }
+
+private:
+    enum Flag : quint8 {
+        Flag_Conversion = 1 << 0,
+        Flag_AllowComment = 1 << 1,
+        Flag_AllowEmbed = 1 << 2,
+        Flag_PermBrowse = 1 << 3,
+        Flag_PermUpload = 1 << 4,
+        Flag_PermManage = 1 << 5
+    };
+
+    bool flag(Flag f) const { return m_flags & f; }
+    void setFlag(Flag f, bool value) { m_flags = value ? (m_flags | f) : (m_flags & ~f); }
+
+    static QString joinPath(SynoAtom parent, const QString& name);
+    static void splitPath(const QString& path, SynoAtom& parent, QString& name);
+
+    template <size_t... I>
+    quint32 diffImpl(const SynoAlbumData& o, std::index_sequence<I...>) const;
+
 public:
     QString id;
     QString name;
-    QString path;
-    QString sharepath;
     QString title;
     QString description;
-    int hits;
-    QString info_type;
-    bool conversion;
-    bool allow_comment;
-    bool allow_embed;
-    QString type;
-    bool perm_browse;
-    bool perm_upload;
-    bool perm_manage;
-    QString file_location;
+    QString thumb_sig;
     QSize thumb_preview_size;
-    int thumb_preview_mtime;
     QSize thumb_small_size;
-    int thumb_small_mtime;
     QSize thumb_large_size;
-    int thumb_large_mtime;
-    QString thumb_sig;
-    QStringList thumbnail_status;
+    int thumb_preview_mtime = 0;
+    int thumb_small_mtime = 0;
+    int thumb_large_mtime = 0;
+    int hits = 0;
+
+private:
+    QString m_fileLocationName;
+    QString m_sharepathName;
+    SynoAtom m_fileLocationParent = SynoAtom(0);
+    SynoAtom m_sharepathParent = SynoAtom(0);
+    SynoAtom m_type = SynoAtom(0);
+    SynoAtom m_infoType = SynoAtom(0);
+    SynoAtom m_thumbnailStatus = SynoAtom(0);
+    /*! Capture time from EXIF, in seconds since epoch */
+    qint64 m_takenTime = 0;
+    /*! Packed boolean fields, see Flag */
+    quint8 m_flags = 0;
 };
 
+/*! Amount of fields returned by SynoAlbumData::fields() */
+static constexpr int SynoAlbumDataFieldCount = std::tuple_size<decltype(SynoAlbumData::fields())>::value;
+
+static_assert(SynoAlbumDataFieldCount <= 32, "Diff mask is limited to 32 fields");
+
+/*! Serializes the record, interned strings are written as strings since atoms are per process */
+QDataStream& operator<<(QDataStream& out, const SynoAlbumData& data);
+QDataStream& operator>>(QDataStream& in, SynoAlbumData& data);
+
 Q_DECLARE_METATYPE(SynoAlbumData)
 
 #endif // SYNOALBUMDATA_H
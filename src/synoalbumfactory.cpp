@@ -22,6 +22,12 @@
 
 #include "qmlobjectwrapper.h"
 #include "synoalbumfactory.h"
+#include "synoalbumreplycache.h"
+#include "synoimageprovider.h"
+#include "synolibrarycrawler.h"
+#include "synolibraryindex.h"
+#include "synosearchindex.h"
+#include "synotimeline.h"
 #include "synops.h"
 
 SynoAlbumFactory& SynoAlbumFactory::instance()
@@ -49,7 +55,45 @@ QObject* SynoAlbumFactory::createAlbumForPath(const QString& path)
 
 QObject* SynoAlbumFactory::createAlbumForData(const SynoAlbumData& data)
 {
-    return wrapFromCache(data.path, [&]() -> SynoAlbum* {
+    return wrapFromCache(data.path(), [&]() -> SynoAlbum* {
+        return createRawAlbumForData(data);
+    });
+}
+
+void SynoAlbumFactory::setDisplayedAlbum(SynoAlbum* album)
+{
+    m_prefetcher.setAlbum(album);
+
+    QSet<QString> pinnedPaths;
+    QSet<QString> pinnedThumbs;
+    if (album) {
+        // back navigation goes through the parents of the displayed album
+        QString path = album->path();
+        pinnedPaths.insert(path);
+        while (!path.isEmpty()) {
+            const int sepIdx = path.lastIndexOf(QLatin1Char('/'));
+            path = sepIdx != -1 ? path.left(sepIdx) : QString();
+            pinnedPaths.insert(path);
+
+            if (SynoAlbum* parent = qobject_cast<SynoAlbum*>(m_cache.peek(path).get())) {
+                const QStringList ids = parent->focusedItemIds();
+                for (const QString& id : ids) {
+                    pinnedThumbs.insert(id);
+                }
+            }
+        }
+    }
+
+    m_cache.setPinned(pinnedPaths);
+
+    if (SynoImageProvider* provider = SynoImageProvider::instance()) {
+        provider->pinThumbnails(pinnedThumbs);
+    }
+}
+
+std::shared_ptr<QObject> SynoAlbumFactory::albumForData(const SynoAlbumData& data)
+{
+    return objectFromCache(data.path(), [&]() -> SynoAlbum* {
         return createRawAlbumForData(data);
     });
 }
@@ -57,15 +101,58 @@ QObject* SynoAlbumFactory::createAlbumForData(const SynoAlbumData& data)
 SynoAlbumFactory::SynoAlbumFactory()
     : QObject()
 {
+    m_costTimer.setSingleShot(true);
+    m_costTimer.setInterval(100);
+    connect(&m_costTimer, &QTimer::timeout, this, &SynoAlbumFactory::updateCosts);
+
     QTimer* cacheStatisticTimer = new QTimer(this);
     connect(cacheStatisticTimer, &QTimer::timeout, this, [this]() {
-        qDebug() << tr("Album cache statistics. Count: %1. Hit: %2. Miss: %3.")
-                    .arg(m_cache.count())
-                    .arg(m_cache.hitCount()).arg(m_cache.missCount());
+        qDebug() << tr("Album cache statistics. Count: %1. Cost (KB): %2. Hit: %3. Miss: %4. Released: %5. Evicted: %6.")
+                    .arg(m_cache.count()).arg(m_cache.totalCost())
+                    .arg(m_cache.hitCount()).arg(m_cache.missCount())
+                    .arg(m_cache.releaseCount()).arg(m_cache.evictionCount());
+
+        SynoAlbumReplyCache& replyCache = SynoAlbumReplyCache::instance();
+        qDebug() << tr("Album reply cache statistics. Hit: %1. Miss: %2.")
+                    .arg(replyCache.hitCount()).arg(replyCache.missCount());
+
+        QPair<quint64, quint64> evictionStats = SynoAlbum::evictionStatistics();
+        qDebug() << tr("Album eviction statistics. Evicted pages: %1. Reloaded pages: %2.")
+                    .arg(evictionStats.first).arg(evictionStats.second);
+
+        SynoAlbum::FetchStatistics fetchStats = SynoAlbum::fetchStatistics();
+        qDebug() << tr("Album page fetch statistics. Used: %1. Wasted: %2. Cancelled: %3.")
+                    .arg(fetchStats.used).arg(fetchStats.wasted).arg(fetchStats.cancelled);
+
+        SynoAlbumPrefetcher::Statistics prefetchStats = SynoAlbumPrefetcher::statistics();
+        qDebug() << tr("Album prefetch statistics. Albums: %1. Thumbnails: %2. Opened: %3.")
+                    .arg(prefetchStats.albums).arg(prefetchStats.thumbnails).arg(prefetchStats.used);
+
+        SynoLibraryIndex& libraryIndex = SynoLibraryIndex::instance();
+        SynoLibraryCrawler::Statistics crawlStats = SynoLibraryCrawler::statistics();
+        qDebug() << tr("Library index statistics. Albums: %1. Items: %2. Crawled albums: %3. Crawled items: %4. Failed albums: %5.")
+                    .arg(libraryIndex.albumCount()).arg(libraryIndex.itemCount())
+                    .arg(crawlStats.albums).arg(crawlStats.items).arg(crawlStats.failed);
+
+        SynoSearchIndex& searchIndex = SynoSearchIndex::instance();
+        QPair<quint64, quint64> queryStats = searchIndex.queryStatistics();
+        qDebug() << tr("Search index statistics. Documents: %1. Words: %2. Queries: %3. Average query time: %4 us.")
+                    .arg(searchIndex.documentCount()).arg(searchIndex.termCount())
+                    .arg(queryStats.first).arg(queryStats.first ? queryStats.second / queryStats.first : 0);
+
+        SynoTimeline& timeline = SynoTimeline::instance();
+        qDebug() << tr("Timeline statistics. Dated items: %1. Years: %2. Months: %3. Days: %4.")
+                    .arg(timeline.itemCount()).arg(timeline.bucketCount(SynoTimeline::Year))
+                    .arg(timeline.bucketCount(SynoTimeline::Month)).arg(timeline.bucketCount(SynoTimeline::Day));
     });
     cacheStatisticTimer->start(60000);
 }
 
+void SynoAlbumFactory::removeAlbum(const QString& path)
+{
+    m_cache.remove(path);
+}
+
 SynoAlbum* SynoAlbumFactory::createRawAlbumForPath(const QString& path)
 {
     return new SynoAlbum(SynoPS::instance()->conn(), path);
@@ -77,6 +164,12 @@ SynoAlbum* SynoAlbumFactory::createRawAlbumForData(const SynoAlbumData& data)
 }
 
 QmlObjectWrapper* SynoAlbumFactory::wrapFromCache(const QString& path, std::function<SynoAlbum* ()> ctor)
+{
+    m_prefetcher.markOpened(path);
+    return new QmlObjectWrapper(objectFromCache(path, ctor));
+}
+
+std::shared_ptr<QObject> SynoAlbumFactory::objectFromCache(const QString& path, std::function<SynoAlbum* ()> ctor)
 {
     std::shared_ptr<QObject> o = m_cache.object(path);
     if (!o) {
@@ -84,7 +177,24 @@ QmlObjectWrapper* SynoAlbumFactory::wrapFromCache(const QString& path, std::func
         QQmlEngine::setObjectOwnership(album, QQmlEngine::CppOwnership);
         o.reset(album);
         m_cache.insert(path, o);
+
+        // the cache is updated outside of album processing, as it may release the album
+        connect(album, &SynoAlbum::residentCostChanged, this, [this, path]() {
+            m_costUpdates.insert(path);
+            if (!m_costTimer.isActive()) {
+                m_costTimer.start();
+            }
+        });
     }
 
-    return new QmlObjectWrapper(o);
+    return o;
+}
+
+void SynoAlbumFactory::updateCosts()
+{
+    QSet<QString> paths;
+    std::swap(paths, m_costUpdates);
+    for (const QString& path : std::as_const(paths)) {
+        m_cache.updateCost(path);
+    }
 }
@@ -21,8 +21,12 @@
 
 #include <functional>
 
+#include <QSet>
+#include <QTimer>
+
 #include "synoalbum.h"
 #include "synoalbumcache.h"
+#include "synoalbumprefetcher.h"
 
 class QJSEngine;
 class QQmlEngine;
@@ -58,6 +62,23 @@ public:
      */
     Q_INVOKABLE QObject* createAlbumForData(const SynoAlbumData& data);
 
+    /*!
+     * \brief This method sets the displayed album
+     *
+     * Child albums of the displayed album are prefetched while idle. The displayed album
+     * and its parents are pinned in cache, along with the thumbnails last seen in the parents,
+     * so back navigation restores them at once.
+     *
+     * \param album Displayed album, or nullptr
+     */
+    Q_INVOKABLE void setDisplayedAlbum(SynoAlbum* album);
+
+    /*! Returns album for the specified data from cache, the album is created if missing */
+    std::shared_ptr<QObject> albumForData(const SynoAlbumData& data);
+
+    /*! Removes album for the specified path from cache, the album is kept alive by its wrappers */
+    void removeAlbum(const QString& path);
+
 protected:
     SynoAlbumFactory();
 
@@ -65,9 +86,17 @@ protected:
     SynoAlbum* createRawAlbumForData(const SynoAlbumData& data);
 
     QmlObjectWrapper* wrapFromCache(const QString& path, std::function<SynoAlbum*()> ctor);
+    std::shared_ptr<QObject> objectFromCache(const QString& path, std::function<SynoAlbum*()> ctor);
+
+    void updateCosts();
 
 protected:
     SynoAlbumCache m_cache;
+    SynoAlbumPrefetcher m_prefetcher;
+    /*! Paths of the albums with changed memory cost */
+    QSet<QString> m_costUpdates;
+    /*! Timer coalescing cost updates of the albums */
+    QTimer m_costTimer;
 };
 
 #endif // SYNOALBUMFACTORY_H
@@ -0,0 +1,93 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synoalbumpager.h"
+#include "synosettings.h"
+
+#include <cmath>
+
+// weight of a new sample in moving averages
+static constexpr double SampleWeight = 0.125;
+// amount of samples required for estimation
+static constexpr int MinSampleCount = 4;
+
+SynoAlbumPager& SynoAlbumPager::instance()
+{
+    static SynoAlbumPager i;
+    return i;
+}
+
+SynoAlbumPager::SynoAlbumPager()
+    : m_sampleCount(0)
+    , m_rttMs(-1.0)
+    , m_byteMs(0.0)
+    , m_itemSize(0.0)
+{
+    SynoSettings settings(QStringLiteral("performance"));
+    m_minBatchSize = qBound(1, settings.value(QStringLiteral("albumBatchSizeMin"), 25).toInt(), 100000);
+    m_maxBatchSize = qBound(m_minBatchSize, settings.value(QStringLiteral("albumBatchSizeMax"), 400).toInt(), 100000);
+}
+
+void SynoAlbumPager::addSample(qint64 elapsedMs, int replySize, int itemCount)
+{
+    if (elapsedMs < 0 || replySize <= 0 || itemCount <= 0) {
+        return;
+    }
+
+    const double elapsed = static_cast<double>(elapsedMs);
+
+    // round trip time follows the fastest requests, and slowly rises if the network degrades
+    if (m_rttMs < 0 || elapsed < m_rttMs) {
+        m_rttMs = elapsed;
+    } else {
+        m_rttMs += (elapsed - m_rttMs) * SampleWeight * SampleWeight;
+    }
+
+    const double byteMs = std::max(0.0, elapsed - m_rttMs) / replySize;
+    const double itemSize = static_cast<double>(replySize) / itemCount;
+    if (!m_sampleCount) {
+        m_byteMs = byteMs;
+        m_itemSize = itemSize;
+    } else {
+        m_byteMs += (byteMs - m_byteMs) * SampleWeight;
+        m_itemSize += (itemSize - m_itemSize) * SampleWeight;
+    }
+
+    ++m_sampleCount;
+}
+
+int SynoAlbumPager::batchSize(int baseSize) const
+{
+    if (m_sampleCount < MinSampleCount || m_rttMs <= 0) {
+        return baseSize;
+    }
+
+    // transfer of the page takes one round trip
+    const double itemMs = std::max(m_byteMs * m_itemSize, 1e-3);
+    const double target = qBound<double>(m_minBatchSize, m_rttMs / itemMs, m_maxBatchSize);
+
+    // the nearest power of two multiple of base size
+    const double size = std::ldexp(baseSize, static_cast<int>(std::lround(std::log2(target / baseSize))));
+
+    return static_cast<int>(qBound<double>(m_minBatchSize, size, m_maxBatchSize));
+}
+
+double SynoAlbumPager::rttMs() const
+{
+    return m_rttMs;
+}
@@ -0,0 +1,78 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNOALBUMPAGER_H
+#define SYNOALBUMPAGER_H
+
+#include <QtGlobal>
+
+/*!
+ * \brief Estimation of album page size from measured listing requests
+ *
+ * Each fetched page gives a sample of request time and reply size. The minimal
+ * request time approximates round trip time, the rest of it is transfer time.
+ * Pages are sized so that the transfer takes about one round trip: short pages
+ * are dominated by latency, long ones delay the first visible items.
+ *
+ * Suggested sizes are quantized to powers of two of the base batch size, so
+ * album replies stay cached under the same request parameters.
+ */
+class SynoAlbumPager
+{
+    Q_DISABLE_COPY(SynoAlbumPager)
+
+public:
+    static SynoAlbumPager& instance();
+
+    /*!
+     * \brief This method adds a sample of a fetched page.
+     *
+     * \param elapsedMs Time from sending the request till the reply is received
+     * \param replySize Size of the reply body in bytes
+     * \param itemCount Amount of items in the reply
+     */
+    void addSample(qint64 elapsedMs, int replySize, int itemCount);
+
+    /*!
+     * \brief This method returns page size suitable for measured connection.
+     *
+     * \param baseSize Page size used until enough samples are collected
+     */
+    int batchSize(int baseSize) const;
+
+    /*! Returns estimated round trip time in ms, or negative value if unknown */
+    double rttMs() const;
+
+private:
+    SynoAlbumPager();
+
+private:
+    /*! Amount of samples collected */
+    int m_sampleCount;
+    /*! Estimated round trip time, in ms */
+    double m_rttMs;
+    /*! Estimated transfer time of a byte, in ms */
+    double m_byteMs;
+    /*! Estimated reply size of one item, in bytes */
+    double m_itemSize;
+    /*! Limits of suggested page size */
+    int m_minBatchSize;
+    int m_maxBatchSize;
+};
+
+#endif // SYNOALBUMPAGER_H
@@ -0,0 +1,178 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synoalbumprefetcher.h"
+#include "synoalbum.h"
+#include "synoalbumfactory.h"
+#include "synoauth.h"
+#include "synoconn.h"
+#include "synoimageprovider.h"
+#include "synops.h"
+#include "synosettings.h"
+
+// prefetch counters of all prefetchers
+static SynoAlbumPrefetcher::Statistics g_statistics;
+
+static inline bool isAlbum(const SynoAlbumData& item)
+{
+    return item.type() == QLatin1String("album");
+}
+
+SynoAlbumPrefetcher::SynoAlbumPrefetcher(QObject* parent)
+    : QObject(parent)
+{
+    SynoSettings settings(QStringLiteral("performance"));
+    m_isEnabled = settings.value(QStringLiteral("albumPrefetchEnabled"), true).toBool();
+    m_maxChildren = qBound(0, settings.value(QStringLiteral("albumPrefetchChildren"), 4).toInt(), 64);
+    m_thumbsPerChild = qBound(0, settings.value(QStringLiteral("albumPrefetchThumbs"), 6).toInt(), 256);
+    m_idleTimeMs = qBound(0, settings.value(QStringLiteral("albumPrefetchIdleMs"), 500).toInt(), 60000);
+
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &SynoAlbumPrefetcher::prefetch);
+}
+
+SynoAlbumPrefetcher::~SynoAlbumPrefetcher()
+{
+    setAlbum(nullptr);
+}
+
+void SynoAlbumPrefetcher::setAlbum(SynoAlbum* album)
+{
+    if (album == m_album) {
+        return;
+    }
+
+    if (m_album) {
+        disconnect(m_album, nullptr, this, nullptr);
+    }
+
+    m_timer.stop();
+    releaseChildren();
+    m_album = album;
+
+    if (m_album && m_isEnabled && m_maxChildren > 0) {
+        // child albums appear on the first page, which might be loaded or refreshed later
+        connect(m_album, &QAbstractItemModel::rowsInserted, this, &SynoAlbumPrefetcher::schedule);
+        connect(m_album, &QAbstractItemModel::dataChanged, this, &SynoAlbumPrefetcher::schedule);
+        connect(m_album, &QAbstractItemModel::modelReset, this, &SynoAlbumPrefetcher::schedule);
+        schedule();
+    }
+}
+
+void SynoAlbumPrefetcher::markOpened(const QString& path)
+{
+    if (m_children.contains(path)) {
+        ++g_statistics.used;
+    }
+}
+
+SynoAlbumPrefetcher::Statistics SynoAlbumPrefetcher::statistics()
+{
+    return g_statistics;
+}
+
+void SynoAlbumPrefetcher::schedule()
+{
+    if (m_children.size() < m_maxChildren && !m_timer.isActive()) {
+        m_timer.start(m_idleTimeMs);
+    }
+}
+
+void SynoAlbumPrefetcher::prefetch()
+{
+    if (!m_album) {
+        return;
+    }
+
+    SynoConn* conn = SynoPS::instance()->conn();
+    if (conn->status() != SynoConn::API_LOADED || conn->auth()->status() != SynoAuth::AUTHORIZED) {
+        // the displayed album is reloaded on reconnection, and the prefetch is scheduled again
+        return;
+    }
+
+    // the displayed album loads its pages and thumbnails first
+    const qint64 idleTimeMs = conn->foregroundIdleTime();
+    if (idleTimeMs < m_idleTimeMs) {
+        m_timer.start(static_cast<int>(m_idleTimeMs - idleTimeMs));
+        return;
+    }
+
+    // only the first page is scanned, further pages are not requested for the prefetch
+    const int rowCount = qMin(m_album->rowCount(QModelIndex()), m_album->batchSize());
+    for (int i = 0; i < rowCount && m_children.size() < m_maxChildren; ++i) {
+        const SynoAlbumData* data = m_album->peek(i);
+        if (!data || !isAlbum(*data) || m_children.contains(data->path())) {
+            continue;
+        }
+
+        std::shared_ptr<QObject> o = SynoAlbumFactory::instance().albumForData(*data);
+        SynoAlbum* child = static_cast<SynoAlbum*>(o.get());
+        m_children.insert(data->path(), o);
+        ++g_statistics.albums;
+
+        // the album is not displayed, so it fetches a single page in background
+        child->setIsActive(false);
+        child->refresh(false);
+
+        if (m_thumbsPerChild > 0) {
+            connect(child, &QAbstractItemModel::rowsInserted, this, [this, child]() { warmUp(child); });
+            connect(child, &QAbstractItemModel::dataChanged, this, [this, child]() { warmUp(child); });
+            connect(child, &QAbstractItemModel::modelReset, this, [this, child]() { warmUp(child); });
+            warmUp(child);
+        }
+    }
+}
+
+void SynoAlbumPrefetcher::warmUp(SynoAlbum* child)
+{
+    SynoImageProvider* provider = SynoImageProvider::instance();
+    if (!provider || m_warmedChildren.contains(child->path())) {
+        return;
+    }
+
+    // the first row is warmed up once it is loaded completely
+    const int count = qMin(child->rowCount(QModelIndex()), m_thumbsPerChild);
+    if (count == 0) {
+        return;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (!child->peek(i)) {
+            return;
+        }
+    }
+
+    for (int i = 0; i < count; ++i) {
+        provider->warmUp(child->peek(i)->id.toLatin1());
+    }
+
+    g_statistics.thumbnails += count;
+    m_warmedChildren.insert(child->path());
+    disconnect(child, nullptr, this, nullptr);
+}
+
+void SynoAlbumPrefetcher::releaseChildren()
+{
+    for (const std::shared_ptr<QObject>& o : std::as_const(m_children)) {
+        disconnect(o.get(), nullptr, this, nullptr);
+    }
+
+    // the albums remain in album cache
+    m_children.clear();
+    m_warmedChildren.clear();
+}
@@ -0,0 +1,95 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNOALBUMPREFETCHER_H
+#define SYNOALBUMPREFETCHER_H
+
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QString>
+#include <QTimer>
+
+#include <memory>
+
+class SynoAlbum;
+
+/*!
+ * \brief Prefetcher of the child albums of the displayed album
+ *
+ * Once the connection was not used by the views for a while, the first child albums
+ * found on the first page of the displayed album are created in album cache,
+ * their first page is loaded, and the thumbnails of their first row are warmed up.
+ * Everything is requested in background, so opening of a child album does not start cold.
+ *
+ * Prefetched albums are kept alive until another album is displayed.
+ */
+class SynoAlbumPrefetcher : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(SynoAlbumPrefetcher)
+
+public:
+    /*! Counters of all prefetchers */
+    struct Statistics
+    {
+        /*! Child albums prefetched */
+        quint64 albums = 0;
+        /*! Thumbnails warmed up */
+        quint64 thumbnails = 0;
+        /*! Prefetched albums opened afterwards */
+        quint64 used = 0;
+    };
+
+public:
+    explicit SynoAlbumPrefetcher(QObject* parent = nullptr);
+    ~SynoAlbumPrefetcher();
+
+    /*! Sets the displayed album, children of the previous one are released */
+    void setAlbum(SynoAlbum* album);
+
+    /*! Accounts opening of the album, which might be a prefetched one */
+    void markOpened(const QString& path);
+
+    static Statistics statistics();
+
+private:
+    void schedule();
+    void prefetch();
+    void warmUp(SynoAlbum* child);
+    void releaseChildren();
+
+private:
+    QPointer<SynoAlbum> m_album;
+    /*! Prefetched child albums, keyed by path */
+    QHash< QString, std::shared_ptr<QObject> > m_children;
+    /*! Paths of the child albums with warmed up thumbnails */
+    QSet<QString> m_warmedChildren;
+    /*! Timer delaying the prefetch until the connection is idle */
+    QTimer m_timer;
+    bool m_isEnabled;
+    /*! Maximum amount of prefetched child albums */
+    int m_maxChildren;
+    /*! Amount of thumbnails warmed up for each child album */
+    int m_thumbsPerChild;
+    /*! Time without foreground requests before the prefetch is started, in ms */
+    int m_idleTimeMs;
+};
+
+#endif // SYNOALBUMPREFETCHER_H
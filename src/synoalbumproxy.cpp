@@ -0,0 +1,615 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synoalbumproxy.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr int ItemTypeCount = 3;
+
+int itemTypeBit(const QString& type)
+{
+    if (type == QLatin1String("album")) {
+        return 0;
+    } else if (type == QLatin1String("photo")) {
+        return 1;
+    } else if (type == QLatin1String("video")) {
+        return 2;
+    }
+    return -1;
+}
+
+void insertBits(QBitArray& bits, int pos, int count)
+{
+    const int size = bits.size();
+    bits.resize(size + count);
+    for (int i = size - 1; i >= pos; --i) {
+        bits.setBit(i + count, bits.testBit(i));
+    }
+    for (int i = pos; i < pos + count; ++i) {
+        bits.clearBit(i);
+    }
+}
+
+void removeBits(QBitArray& bits, int pos, int count)
+{
+    const int size = bits.size();
+    for (int i = pos + count; i < size; ++i) {
+        bits.setBit(i - count, bits.testBit(i));
+    }
+    bits.resize(size - count);
+}
+
+// moves rows [first, last] before destRow, as QAbstractItemModel::beginMoveRows() defines it
+template <typename T>
+void moveRows(QVector<T>& rows, int first, int last, int destRow)
+{
+    if (destRow > last) {
+        std::rotate(rows.begin() + first, rows.begin() + last + 1, rows.begin() + destRow);
+    } else {
+        std::rotate(rows.begin() + destRow, rows.begin() + first, rows.begin() + last + 1);
+    }
+}
+
+void moveBits(QBitArray& bits, int first, int last, int destRow)
+{
+    QVector<bool> rows(bits.size());
+    for (int i = 0; i < bits.size(); ++i) {
+        rows[i] = bits.testBit(i);
+    }
+
+    moveRows(rows, first, last, destRow);
+
+    for (int i = 0; i < bits.size(); ++i) {
+        bits.setBit(i, rows[i]);
+    }
+}
+
+} // namespace
+
+SynoAlbumProxy::SynoAlbumProxy(QObject* parent)
+    : QAbstractProxyModel(parent)
+    , m_sortKey(SortDefault)
+    , m_sortDescending(false)
+    , m_itemTypes(ItemAll)
+    , m_isLocal(false)
+    , m_listingAlbum(nullptr)
+{
+    m_collator.setNumericMode(true);
+    m_collator.setCaseSensitivity(Qt::CaseInsensitive);
+}
+
+SynoAlbumData SynoAlbumProxy::get(int row) const
+{
+    QModelIndex sourceIndex = mapToSource(index(row, 0));
+    return sourceIndex.isValid() ? m_source->get(sourceIndex.row()) : SynoAlbumData::null;
+}
+
+SynoAlbum* SynoAlbumProxy::album() const
+{
+    return m_album;
+}
+
+void SynoAlbumProxy::setAlbum(SynoAlbum* album)
+{
+    if (album == m_album) {
+        return;
+    }
+
+    beginResetModel();
+
+    m_album = album;
+    setSource(album);
+
+    const bool wasLocal = m_isLocal;
+    m_isLocal = false;
+    m_proxyToSource.clear();
+    m_sourceToProxy.clear();
+
+    endResetModel();
+
+    // the listing album belongs to the previous album
+    if (m_listingAlbum) {
+        m_listingAlbum->deleteLater();
+        m_listingAlbum = nullptr;
+    }
+
+    emit albumChanged();
+    if (wasLocal) {
+        emit isLocalChanged();
+    }
+
+    apply();
+}
+
+SynoAlbumProxy::SortKey SynoAlbumProxy::sortKey() const
+{
+    return m_sortKey;
+}
+
+void SynoAlbumProxy::setSortKey(SortKey key)
+{
+    if (key != m_sortKey) {
+        m_sortKey = key;
+        apply();
+        emit sortKeyChanged();
+    }
+}
+
+bool SynoAlbumProxy::sortDescending() const
+{
+    return m_sortDescending;
+}
+
+void SynoAlbumProxy::setSortDescending(bool value)
+{
+    if (value != m_sortDescending) {
+        m_sortDescending = value;
+        apply();
+        emit sortDescendingChanged();
+    }
+}
+
+int SynoAlbumProxy::itemTypes() const
+{
+    return m_itemTypes;
+}
+
+void SynoAlbumProxy::setItemTypes(int types)
+{
+    types &= ItemAll;
+    if (types != m_itemTypes) {
+        m_itemTypes = types;
+        apply();
+        emit itemTypesChanged();
+    }
+}
+
+bool SynoAlbumProxy::isLocal() const
+{
+    return m_isLocal;
+}
+
+QModelIndex SynoAlbumProxy::index(int row, int column, const QModelIndex& parent) const
+{
+    if (parent.isValid() || column != 0 || row < 0 || row >= rowCount()) {
+        return QModelIndex();
+    }
+
+    return createIndex(row, column);
+}
+
+QModelIndex SynoAlbumProxy::parent(const QModelIndex& child) const
+{
+    Q_UNUSED(child)
+    return QModelIndex();
+}
+
+int SynoAlbumProxy::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid() || !m_source) {
+        return 0;
+    }
+
+    return m_isLocal ? m_proxyToSource.size() : m_source->rowCount(QModelIndex());
+}
+
+int SynoAlbumProxy::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : 1;
+}
+
+QModelIndex SynoAlbumProxy::mapToSource(const QModelIndex& proxyIndex) const
+{
+    if (!proxyIndex.isValid() || !m_source) {
+        return QModelIndex();
+    }
+
+    const int sourceRow = m_isLocal ? m_proxyToSource.value(proxyIndex.row(), -1) : proxyIndex.row();
+    return m_source->index(sourceRow, 0);
+}
+
+QModelIndex SynoAlbumProxy::mapFromSource(const QModelIndex& sourceIndex) const
+{
+    if (!sourceIndex.isValid() || !m_source) {
+        return QModelIndex();
+    }
+
+    const int proxyRow = m_isLocal ? m_sourceToProxy.value(sourceIndex.row(), -1) : sourceIndex.row();
+    return index(proxyRow, 0);
+}
+
+QHash<int, QByteArray> SynoAlbumProxy::roleNames() const
+{
+    return m_source ? m_source->roleNames() : QAbstractProxyModel::roleNames();
+}
+
+void SynoAlbumProxy::apply()
+{
+    // local indexes are complete only for loaded album in the service default order, no item types give no rows at all
+    const bool isLocal = m_album && (!m_itemTypes
+        || (m_sortKey != SortDate && m_album->hasDefaultListing() && m_album->isLoaded()));
+
+    // the album is shared, another listing is requested by the album of the proxy
+    SynoAlbum* source = m_album;
+    if (m_album && !isLocal && (!serviceSortBy().isEmpty() || m_itemTypes != ItemAll)) {
+        if (!m_listingAlbum) {
+            m_listingAlbum = new SynoAlbum(m_album->conn(), m_album->path(), this);
+        }
+
+        // the listing album is reloaded in requested order if it differs, the proxy follows its reset
+        m_listingAlbum->setListing(serviceSortBy(), m_sortDescending, serviceItemTypes());
+        source = m_listingAlbum;
+    }
+
+    const bool wasLocal = m_isLocal;
+
+    beginResetModel();
+    if (source != m_source) {
+        setSource(source);
+    }
+    m_isLocal = isLocal;
+    if (m_isLocal) {
+        setMapping(buildMapping());
+    } else {
+        m_proxyToSource.clear();
+        m_sourceToProxy.clear();
+    }
+    endResetModel();
+
+    if (m_listingAlbum && source != m_listingAlbum) {
+        // the listing album is loaded again if another listing is requested
+        m_listingAlbum->deleteLater();
+        m_listingAlbum = nullptr;
+    }
+
+    if (wasLocal != m_isLocal) {
+        emit isLocalChanged();
+    }
+}
+
+void SynoAlbumProxy::setSource(SynoAlbum* source)
+{
+    // it is called within model reset
+    if (m_source) {
+        disconnect(m_source, nullptr, this, nullptr);
+    }
+
+    m_source = source;
+    setSourceModel(source);
+
+    const int count = m_source ? m_source->rowCount(QModelIndex()) : 0;
+    m_nameKeys = QVector< std::optional<QCollatorSortKey> >(count);
+    for (QBitArray& bits : m_typeBits) {
+        bits = QBitArray(count);
+    }
+    if (count) {
+        updateKeys(0, count - 1);
+    }
+
+    if (m_source) {
+        connect(m_source, &QAbstractItemModel::modelAboutToBeReset, this, &SynoAlbumProxy::onSourceAboutToBeReset);
+        connect(m_source, &QAbstractItemModel::modelReset, this, &SynoAlbumProxy::onSourceReset);
+        connect(m_source, &QAbstractItemModel::rowsAboutToBeInserted, this, &SynoAlbumProxy::onSourceRowsAboutToBeInserted);
+        connect(m_source, &QAbstractItemModel::rowsInserted, this, &SynoAlbumProxy::onSourceRowsInserted);
+        connect(m_source, &QAbstractItemModel::rowsAboutToBeRemoved, this, &SynoAlbumProxy::onSourceRowsAboutToBeRemoved);
+        connect(m_source, &QAbstractItemModel::rowsRemoved, this, &SynoAlbumProxy::onSourceRowsRemoved);
+        connect(m_source, &QAbstractItemModel::rowsAboutToBeMoved, this, &SynoAlbumProxy::onSourceRowsAboutToBeMoved);
+        connect(m_source, &QAbstractItemModel::rowsMoved, this, &SynoAlbumProxy::onSourceRowsMoved);
+        connect(m_source, &QAbstractItemModel::dataChanged, this, &SynoAlbumProxy::onSourceDataChanged);
+    }
+}
+
+void SynoAlbumProxy::updateKeys(int first, int last)
+{
+    for (int row = first; row <= last; ++row) {
+        const SynoAlbumData* record = m_source->peek(row);
+        if (!record) {
+            // evicted rows keep their keys
+            continue;
+        }
+
+        m_nameKeys[row] = m_collator.sortKey(record->name);
+
+        const int typeBit = itemTypeBit(record->type());
+        for (int i = 0; i < ItemTypeCount; ++i) {
+            m_typeBits[i].setBit(row, i == typeBit);
+        }
+    }
+}
+
+bool SynoAlbumProxy::isRowIncluded(int sourceRow) const
+{
+    for (int i = 0; i < ItemTypeCount; ++i) {
+        if ((m_itemTypes & (1 << i)) && m_typeBits[i].testBit(sourceRow)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QVector<int> SynoAlbumProxy::buildMapping() const
+{
+    QVector<int> proxyToSource;
+    proxyToSource.reserve(m_nameKeys.size());
+
+    if (m_itemTypes == ItemAll) {
+        for (int row = 0; row < m_nameKeys.size(); ++row) {
+            proxyToSource.append(row);
+        }
+    } else {
+        // filter is the union of item type bitsets
+        QBitArray included(m_nameKeys.size());
+        for (int i = 0; i < ItemTypeCount; ++i) {
+            if (m_itemTypes & (1 << i)) {
+                included |= m_typeBits[i];
+            }
+        }
+
+        for (int row = 0; row < included.size(); ++row) {
+            if (included.testBit(row)) {
+                proxyToSource.append(row);
+            }
+        }
+    }
+
+    if (m_sortKey == SortName) {
+        std::stable_sort(proxyToSource.begin(), proxyToSource.end(), [this](int a, int b) {
+            const std::optional<QCollatorSortKey>& keyA = m_nameKeys[a];
+            const std::optional<QCollatorSortKey>& keyB = m_nameKeys[b];
+            if (!keyA || !keyB) {
+                // rows without keys are placed last
+                return keyA.has_value() && !keyB.has_value();
+            }
+            return keyA->compare(*keyB) < 0;
+        });
+    }
+
+    if (m_sortDescending && m_sortKey != SortDefault) {
+        std::reverse(proxyToSource.begin(), proxyToSource.end());
+    }
+
+    return proxyToSource;
+}
+
+void SynoAlbumProxy::setMapping(QVector<int>&& proxyToSource)
+{
+    m_proxyToSource = std::move(proxyToSource);
+
+    m_sourceToProxy.fill(-1, m_nameKeys.size());
+    for (int proxyRow = 0; proxyRow < m_proxyToSource.size(); ++proxyRow) {
+        m_sourceToProxy[m_proxyToSource[proxyRow]] = proxyRow;
+    }
+}
+
+QByteArray SynoAlbumProxy::serviceSortBy() const
+{
+    switch (m_sortKey) {
+    case SortName:
+        return QByteArrayLiteral("filename");
+    case SortDate:
+        return QByteArrayLiteral("takendate");
+    default:
+        break;
+    }
+
+    return QByteArray();
+}
+
+QByteArrayList SynoAlbumProxy::serviceItemTypes() const
+{
+    QByteArrayList itemTypes;
+    if (m_itemTypes & ItemAlbum) {
+        itemTypes << QByteArrayLiteral("album");
+    }
+    if (m_itemTypes & ItemPhoto) {
+        itemTypes << QByteArrayLiteral("photo");
+    }
+    if (m_itemTypes & ItemVideo) {
+        itemTypes << QByteArrayLiteral("video");
+    }
+    return itemTypes;
+}
+
+void SynoAlbumProxy::onSourceAboutToBeReset()
+{
+    beginResetModel();
+}
+
+void SynoAlbumProxy::onSourceReset()
+{
+    const int count = m_source->rowCount(QModelIndex());
+    m_nameKeys = QVector< std::optional<QCollatorSortKey> >(count);
+    for (QBitArray& bits : m_typeBits) {
+        bits = QBitArray(count);
+    }
+    if (count) {
+        updateKeys(0, count - 1);
+    }
+
+    const bool wasLocal = m_isLocal;
+    m_isLocal = false;
+    m_proxyToSource.clear();
+    m_sourceToProxy.clear();
+
+    endResetModel();
+
+    if (wasLocal) {
+        // the order and filter are requested from the service until the album is loaded again
+        emit isLocalChanged();
+        QMetaObject::invokeMethod(this, &SynoAlbumProxy::apply, Qt::QueuedConnection);
+    }
+}
+
+void SynoAlbumProxy::onSourceRowsAboutToBeInserted(const QModelIndex& parent, int first, int last)
+{
+    Q_UNUSED(parent)
+
+    if (m_isLocal) {
+        beginResetModel();
+    } else {
+        beginInsertRows(QModelIndex(), first, last);
+    }
+}
+
+void SynoAlbumProxy::onSourceRowsInserted(const QModelIndex& parent, int first, int last)
+{
+    Q_UNUSED(parent)
+
+    const int count = last - first + 1;
+    m_nameKeys.insert(first, count, std::optional<QCollatorSortKey>());
+    for (QBitArray& bits : m_typeBits) {
+        insertBits(bits, first, count);
+    }
+    updateKeys(first, last);
+
+    if (m_isLocal) {
+        if (m_source->isLoaded()) {
+            setMapping(buildMapping());
+            endResetModel();
+        } else {
+            // rows which are not loaded can not be ordered locally
+            m_isLocal = false;
+            m_proxyToSource.clear();
+            m_sourceToProxy.clear();
+            endResetModel();
+
+            emit isLocalChanged();
+            QMetaObject::invokeMethod(this, &SynoAlbumProxy::apply, Qt::QueuedConnection);
+        }
+    } else {
+        endInsertRows();
+    }
+}
+
+void SynoAlbumProxy::onSourceRowsAboutToBeRemoved(const QModelIndex& parent, int first, int last)
+{
+    Q_UNUSED(parent)
+
+    if (m_isLocal) {
+        beginResetModel();
+    } else {
+        beginRemoveRows(QModelIndex(), first, last);
+    }
+}
+
+void SynoAlbumProxy::onSourceRowsRemoved(const QModelIndex& parent, int first, int last)
+{
+    Q_UNUSED(parent)
+
+    const int count = last - first + 1;
+    m_nameKeys.remove(first, count);
+    for (QBitArray& bits : m_typeBits) {
+        removeBits(bits, first, count);
+    }
+
+    if (m_isLocal) {
+        setMapping(buildMapping());
+        endResetModel();
+    } else {
+        endRemoveRows();
+    }
+}
+
+void SynoAlbumProxy::onSourceRowsAboutToBeMoved(const QModelIndex& parent, int first, int last,
+                                                const QModelIndex& destParent, int destRow)
+{
+    Q_UNUSED(parent)
+    Q_UNUSED(destParent)
+
+    if (m_isLocal) {
+        beginResetModel();
+    } else {
+        beginMoveRows(QModelIndex(), first, last, QModelIndex(), destRow);
+    }
+}
+
+void SynoAlbumProxy::onSourceRowsMoved(const QModelIndex& parent, int first, int last,
+                                       const QModelIndex& destParent, int destRow)
+{
+    Q_UNUSED(parent)
+    Q_UNUSED(destParent)
+
+    moveRows(m_nameKeys, first, last, destRow);
+    for (QBitArray& bits : m_typeBits) {
+        moveBits(bits, first, last, destRow);
+    }
+
+    if (m_isLocal) {
+        setMapping(buildMapping());
+        endResetModel();
+    } else {
+        endMoveRows();
+    }
+}
+
+void SynoAlbumProxy::onSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight,
+                                         const QVector<int>& roles)
+{
+    const int first = topLeft.row();
+    const int last = bottomRight.row();
+    updateKeys(first, last);
+
+    if (!m_isLocal) {
+        emit dataChanged(index(first, 0), index(last, 0), roles);
+        return;
+    }
+
+    const bool isOrderChanged = roles.isEmpty() || roles.contains(Qt::DisplayRole) || roles.contains(SynoAlbum::RoleType);
+    if (isOrderChanged) {
+        QVector<int> proxyToSource = buildMapping();
+        if (proxyToSource.size() != m_proxyToSource.size()) {
+            beginResetModel();
+            setMapping(std::move(proxyToSource));
+            endResetModel();
+            return;
+        }
+
+        if (proxyToSource != m_proxyToSource) {
+            emit layoutAboutToBeChanged();
+
+            const QModelIndexList fromIndexes = persistentIndexList();
+            QVector<int> sourceRows;
+            sourceRows.reserve(fromIndexes.size());
+            for (const QModelIndex& fromIndex : fromIndexes) {
+                sourceRows.append(m_proxyToSource.value(fromIndex.row(), -1));
+            }
+
+            setMapping(std::move(proxyToSource));
+
+            QModelIndexList toIndexes;
+            toIndexes.reserve(fromIndexes.size());
+            for (int sourceRow : std::as_const(sourceRows)) {
+                toIndexes.append(index(m_sourceToProxy.value(sourceRow, -1), 0));
+            }
+            changePersistentIndexList(fromIndexes, toIndexes);
+
+            emit layoutChanged();
+        }
+    }
+
+    // the changed rows may be scattered in proxy order
+    for (int sourceRow = first; sourceRow <= last; ++sourceRow) {
+        const int proxyRow = m_sourceToProxy.value(sourceRow, -1);
+        if (proxyRow >= 0) {
+            emit dataChanged(index(proxyRow, 0), index(proxyRow, 0), roles);
+        }
+    }
+}
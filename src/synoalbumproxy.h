@@ -0,0 +1,159 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNOALBUMPROXY_H
+#define SYNOALBUMPROXY_H
+
+#include <QAbstractProxyModel>
+#include <QBitArray>
+#include <QCollator>
+#include <QPointer>
+#include <QQmlEngine>
+
+#include <optional>
+
+#include "synoalbum.h"
+
+/*!
+ * \brief Sorting and filtering layer over SynoAlbum
+ *
+ * Collation keys of names and item type bitsets are maintained per album row
+ * as pages arrive. Once the album is loaded completely in the service default
+ * order, sorting and filtering are applied locally from these indexes.
+ * Otherwise the order and item types are requested from the service by an album
+ * of the proxy, and its rows are passed through as is. The album set to the proxy
+ * is shared with other views, so its listing is never changed.
+ */
+class SynoAlbumProxy : public QAbstractProxyModel
+{
+    Q_OBJECT
+
+    QML_ELEMENT
+
+    Q_PROPERTY(SynoAlbum* album READ album WRITE setAlbum NOTIFY albumChanged)
+    Q_PROPERTY(SortKey sortKey READ sortKey WRITE setSortKey NOTIFY sortKeyChanged)
+    Q_PROPERTY(bool sortDescending READ sortDescending WRITE setSortDescending NOTIFY sortDescendingChanged)
+    Q_PROPERTY(int itemTypes READ itemTypes WRITE setItemTypes NOTIFY itemTypesChanged)
+    Q_PROPERTY(bool isLocal READ isLocal NOTIFY isLocalChanged)
+
+public:
+    enum SortKey
+    {
+        SortDefault = 0,
+        SortName,
+        /*! Capture date, sorted by the service only */
+        SortDate
+    };
+    Q_ENUM(SortKey)
+
+    enum ItemType
+    {
+        ItemAlbum = 0x1,
+        ItemPhoto = 0x2,
+        ItemVideo = 0x4,
+        ItemAll = ItemAlbum | ItemPhoto | ItemVideo
+    };
+    Q_ENUM(ItemType)
+
+public:
+    explicit SynoAlbumProxy(QObject* parent = nullptr);
+
+    /*!
+     * \brief This method returns album data for the specified row of the proxy.
+     *
+     * \param row Row of the proxy
+     *
+     * \returns Album data for the row, or empty data
+     */
+    Q_INVOKABLE SynoAlbumData get(int row) const;
+
+    SynoAlbum* album() const;
+    void setAlbum(SynoAlbum* album);
+
+    SortKey sortKey() const;
+    void setSortKey(SortKey key);
+
+    bool sortDescending() const;
+    void setSortDescending(bool value);
+
+    /*! Returns mask of ItemType values included in the proxy */
+    int itemTypes() const;
+    void setItemTypes(int types);
+
+    /*! Returns true if sorting and filtering are applied locally, rather than by the service */
+    bool isLocal() const;
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex& child) const override;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QModelIndex mapToSource(const QModelIndex& proxyIndex) const override;
+    QModelIndex mapFromSource(const QModelIndex& sourceIndex) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+signals:
+    void albumChanged();
+    void sortKeyChanged();
+    void sortDescendingChanged();
+    void itemTypesChanged();
+    void isLocalChanged();
+
+private:
+    void apply();
+    void setSource(SynoAlbum* source);
+    void updateKeys(int first, int last);
+    bool isRowIncluded(int sourceRow) const;
+    QVector<int> buildMapping() const;
+    void setMapping(QVector<int>&& proxyToSource);
+    QByteArray serviceSortBy() const;
+    QByteArrayList serviceItemTypes() const;
+
+    void onSourceAboutToBeReset();
+    void onSourceReset();
+    void onSourceRowsAboutToBeInserted(const QModelIndex& parent, int first, int last);
+    void onSourceRowsInserted(const QModelIndex& parent, int first, int last);
+    void onSourceRowsAboutToBeRemoved(const QModelIndex& parent, int first, int last);
+    void onSourceRowsRemoved(const QModelIndex& parent, int first, int last);
+    void onSourceRowsAboutToBeMoved(const QModelIndex& parent, int first, int last,
+                                    const QModelIndex& destParent, int destRow);
+    void onSourceRowsMoved(const QModelIndex& parent, int first, int last,
+                           const QModelIndex& destParent, int destRow);
+    void onSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles);
+
+private:
+    QPointer<SynoAlbum> m_album;
+    /*! Album the rows are taken from, either the album or the listing album */
+    QPointer<SynoAlbum> m_source;
+    /*! Album of the proxy for the listing other than the default one, owned by the proxy */
+    SynoAlbum* m_listingAlbum;
+    SortKey m_sortKey;
+    bool m_sortDescending;
+    int m_itemTypes;
+    bool m_isLocal;
+    QCollator m_collator;
+    /*! Collation keys of item names per album row, empty for rows which were never loaded */
+    QVector< std::optional<QCollatorSortKey> > m_nameKeys;
+    /*! Bitsets of album rows per item type, in order of ItemType bits */
+    QBitArray m_typeBits[3];
+    /*! Album rows in proxy order, used in local mode */
+    QVector<int> m_proxyToSource;
+    /*! Proxy rows of album rows, -1 for filtered out rows; used in local mode */
+    QVector<int> m_sourceToProxy;
+};
+
+#endif // SYNOALBUMPROXY_H
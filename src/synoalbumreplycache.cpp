@@ -0,0 +1,327 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synoalbumreplycache.h"
+#include "synoauth.h"
+#include "synoconn.h"
+#include "synosettings.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDirIterator>
+#include <QFile>
+#include <QPointer>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QVector>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+static inline QString hashedName(const QByteArray& data)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex());
+}
+
+static inline QByteArray readFile(const QString& filePath)
+{
+    QFile file(filePath);
+    if (file.open(QIODevice::ReadOnly)) {
+        return file.readAll();
+    }
+
+    return QByteArray();
+}
+
+static inline void writeFile(const QString& filePath, const QByteArray& data)
+{
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qWarning() << __FUNCTION__ << QObject::tr("Cannot write album cache file: %1. %2")
+                      .arg(filePath).arg(file.errorString());
+    }
+}
+
+SynoAlbumReplyCache& SynoAlbumReplyCache::instance()
+{
+    static SynoAlbumReplyCache i;
+    return i;
+}
+
+SynoAlbumReplyCache::SynoAlbumReplyCache()
+    : m_size(0)
+    , m_missCount(0)
+    , m_hitCount(0)
+{
+    m_rootPath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/albums");
+    QDir().mkpath(m_rootPath);
+
+    SynoSettings settings(QStringLiteral("performance"));
+    qint64 maximumSizeMb = qBound(0, settings.value(QStringLiteral("diskAlbumCacheMb"), 100).toInt(), std::numeric_limits<int>::max());
+    m_maxSize = maximumSizeMb * 1024 * 1024;
+
+    m_ioPool.setMaxThreadCount(1);
+    QtConcurrent::run(&m_ioPool, [this]() {
+        trim();
+    });
+}
+
+void SynoAlbumReplyCache::object(const SynoConn* conn, const QByteArray& albumId, const QByteArrayList& formData,
+                                 QObject* context, const std::function<void(const QByteArray&)>& callback)
+{
+    const QString filePath = albumDirPath(conn, albumId) + '/' + hashedName(formData.join('&'));
+    QPointer<QObject> contextPtr(context);
+    QtConcurrent::run(&m_ioPool, [this, filePath, contextPtr, callback]() {
+        QByteArray replyBody = readFile(filePath);
+        if (!contextPtr) {
+            return;
+        }
+
+        // the result is delivered to the context thread, it is dropped with the context
+        QMetaObject::invokeMethod(contextPtr.data(), [this, replyBody, callback]() {
+            if (!replyBody.isEmpty()) {
+                ++m_hitCount;
+                callback(replyBody);
+            } else {
+                ++m_missCount;
+                callback(QByteArray());
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void SynoAlbumReplyCache::insert(const SynoConn* conn, const QByteArray& albumId, const QByteArrayList& formData,
+                                 const QByteArray& replyBody)
+{
+    const QString dirPath = albumDirPath(conn, albumId);
+    const QString filePath = dirPath + '/' + hashedName(formData.join('&'));
+    QtConcurrent::run(&m_ioPool, [this, dirPath, filePath, replyBody]() {
+        if (!QDir().mkpath(dirPath)) {
+            return;
+        }
+
+        writeFile(filePath, replyBody);
+
+        // replaced files are counted again, so the cache is trimmed early rather than late
+        m_size += replyBody.size();
+        if (m_size > m_maxSize) {
+            trim();
+        }
+    });
+}
+
+void SynoAlbumReplyCache::range(const SynoConn* conn, const QByteArray& albumId, const QByteArrayList& formData, int offset, int count,
+                                QObject* context, const std::function<void(const QMap<int, QByteArray>&)>& callback)
+{
+    const QString dirPath = albumDirPath(conn, albumId);
+    const QString baseName = hashedName(formData.join('&'));
+    QPointer<QObject> contextPtr(context);
+    QtConcurrent::run(&m_ioPool, [this, dirPath, baseName, offset, count, contextPtr, callback]() {
+        const QVector<ReplyRange> ranges = replyRanges(dirPath, baseName);
+
+        // the reply reaching farthest is taken for the first item not covered yet
+        QMap<int, QByteArray> replies;
+        int position = offset;
+        while (position < offset + count) {
+            const ReplyRange* next = nullptr;
+            for (const ReplyRange& range : ranges) {
+                if (range.offset <= position && position < range.offset + range.count
+                    && (!next || range.offset + range.count > next->offset + next->count)) {
+                    next = &range;
+                }
+            }
+
+            QByteArray replyBody = next ? readFile(next->filePath) : QByteArray();
+            if (replyBody.isEmpty()) {
+                break;
+            }
+
+            replies.insert(next->offset, replyBody);
+            position = next->offset + next->count;
+        }
+
+        if (!contextPtr) {
+            return;
+        }
+
+        QMetaObject::invokeMethod(contextPtr.data(), [this, replies, callback]() {
+            if (!replies.isEmpty()) {
+                ++m_hitCount;
+            } else {
+                ++m_missCount;
+            }
+            callback(replies);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void SynoAlbumReplyCache::insertRange(const SynoConn* conn, const QByteArray& albumId, const QByteArrayList& formData, int offset, int count,
+                                      const QByteArray& replyBody)
+{
+    if (count <= 0) {
+        return;
+    }
+
+    const QString dirPath = albumDirPath(conn, albumId);
+    const QString baseName = hashedName(formData.join('&'));
+    QtConcurrent::run(&m_ioPool, [this, dirPath, baseName, offset, count, replyBody]() {
+        if (!QDir().mkpath(dirPath)) {
+            return;
+        }
+
+        // replies of the items contained in this one are superseded
+        for (const ReplyRange& range : replyRanges(dirPath, baseName)) {
+            if (offset <= range.offset && range.offset + range.count <= offset + count) {
+                QFile::remove(range.filePath);
+            }
+        }
+
+        writeFile(dirPath + '/' + QStringLiteral("%1_%2_%3").arg(baseName).arg(offset).arg(count), replyBody);
+
+        m_size += replyBody.size();
+        if (m_size > m_maxSize) {
+            trim();
+        }
+    });
+}
+
+void SynoAlbumReplyCache::validate(const SynoConn* conn, const QByteArray& albumId, const QByteArray& validator)
+{
+    const QString dirPath = albumDirPath(conn, albumId);
+    QtConcurrent::run(&m_ioPool, [this, dirPath, validator]() {
+        const QString filePath = dirPath + QStringLiteral("/validator");
+        const QByteArray previousValidator = readFile(filePath);
+        if (previousValidator == validator) {
+            return;
+        }
+
+        if (!previousValidator.isEmpty()) {
+            // album is changed, its replies are outdated
+            QDir(dirPath).removeRecursively();
+        }
+
+        if (QDir().mkpath(dirPath)) {
+            writeFile(filePath, validator);
+        }
+    });
+}
+
+void SynoAlbumReplyCache::remove(const SynoConn* conn, const QByteArray& albumId)
+{
+    const QString dirPath = albumDirPath(conn, albumId);
+    QtConcurrent::run(&m_ioPool, [dirPath]() {
+        QDir(dirPath).removeRecursively();
+    });
+}
+
+void SynoAlbumReplyCache::clear()
+{
+    QtConcurrent::run(&m_ioPool, [this]() {
+        QDir(m_rootPath).removeRecursively();
+        QDir().mkpath(m_rootPath);
+        m_size = 0;
+    });
+}
+
+quint64 SynoAlbumReplyCache::hitCount() const
+{
+    return m_hitCount;
+}
+
+quint64 SynoAlbumReplyCache::missCount() const
+{
+    return m_missCount;
+}
+
+QVector<SynoAlbumReplyCache::ReplyRange> SynoAlbumReplyCache::replyRanges(const QString& dirPath, const QString& baseName)
+{
+    // file name of listing reply is the hash of its form data followed by the range of its items
+    QVector<ReplyRange> ranges;
+    QDirIterator iter(dirPath, { baseName + QStringLiteral("_*") }, QDir::Files);
+    while (iter.hasNext()) {
+        const QString filePath = iter.next();
+        const QStringList parts = iter.fileName().split(QLatin1Char('_'));
+
+        bool isOffsetValid = false;
+        bool isCountValid = false;
+        ReplyRange range{ filePath, parts.value(1).toInt(&isOffsetValid), parts.value(2).toInt(&isCountValid) };
+        if (parts.size() == 3 && isOffsetValid && isCountValid && range.offset >= 0 && range.count > 0) {
+            ranges.append(range);
+        }
+    }
+
+    return ranges;
+}
+
+QString SynoAlbumReplyCache::albumDirPath(const SynoConn* conn, const QByteArray& albumId) const
+{
+    QByteArray scope = conn->synoUrl().toEncoded() + '\n' + conn->auth()->username().toUtf8();
+    return m_rootPath + '/' + hashedName(scope) + '/' + hashedName(albumId);
+}
+
+void SynoAlbumReplyCache::trim()
+{
+    struct AlbumDirInfo
+    {
+        QString path;
+        QDateTime lastModified;
+        qint64 size;
+    };
+
+    QVector<AlbumDirInfo> albumDirs;
+    qint64 totalSize = 0;
+
+    QDirIterator scopeIter(m_rootPath, QDir::Dirs | QDir::NoDotAndDotDot);
+    while (scopeIter.hasNext()) {
+        QDirIterator albumIter(scopeIter.next(), QDir::Dirs | QDir::NoDotAndDotDot);
+        while (albumIter.hasNext()) {
+            AlbumDirInfo info{albumIter.next(), albumIter.fileInfo().lastModified(), 0};
+
+            QDirIterator fileIter(info.path, QDir::Files);
+            while (fileIter.hasNext()) {
+                fileIter.next();
+                info.size += fileIter.fileInfo().size();
+            }
+
+            totalSize += info.size;
+            albumDirs.append(info);
+        }
+    }
+
+    m_size = totalSize;
+    if (totalSize <= m_maxSize) {
+        return;
+    }
+
+    // remove least recently modified albums first
+    std::sort(albumDirs.begin(), albumDirs.end(), [](const AlbumDirInfo& a, const AlbumDirInfo& b) {
+        return a.lastModified < b.lastModified;
+    });
+
+    for (const AlbumDirInfo& info : std::as_const(albumDirs)) {
+        if (totalSize <= m_maxSize) {
+            break;
+        }
+
+        QDir(info.path).removeRecursively();
+        totalSize -= info.size;
+    }
+
+    m_size = totalSize;
+}
@@ -0,0 +1,120 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNOALBUMREPLYCACHE_H
+#define SYNOALBUMREPLYCACHE_H
+
+#include <QByteArray>
+#include <QByteArrayList>
+#include <QDir>
+#include <QMap>
+#include <QThreadPool>
+#include <QVector>
+
+#include <functional>
+
+class SynoConn;
+
+/*!
+ * \brief Disk cache for replies of SYNO.PhotoStation.Album API
+ *
+ * Replies are stored per album, keyed by the form data of the request
+ * (method, additional fields). Replies of listings are keyed by the range
+ * of items they contain too, so pages of any size are served from replies
+ * of another page size. Each album has a validator which is used to decide
+ * whether its cached replies are still up to date.
+ *
+ * Entries are scoped by service URL and user name.
+ *
+ * Files are read and written on a worker thread, in the order of the calls.
+ * The cache is trimmed to its maximum size once inserted replies exceed it.
+ *
+ * This class should be used from GUI thread only.
+ */
+class SynoAlbumReplyCache
+{
+    Q_DISABLE_COPY(SynoAlbumReplyCache)
+
+public:
+    /*!
+     * \brief This method returns instance of album reply cache
+     */
+    static SynoAlbumReplyCache& instance();
+
+    /*!
+     * \brief Reads cached reply body
+     *
+     * The callback receives the body, or null byte array if not found. It is invoked
+     * in the thread of the context object, and is not invoked if the context is destroyed.
+     */
+    void object(const SynoConn* conn, const QByteArray& albumId, const QByteArrayList& formData,
+                QObject* context, const std::function<void(const QByteArray&)>& callback);
+    void insert(const SynoConn* conn, const QByteArray& albumId, const QByteArrayList& formData, const QByteArray& replyBody);
+
+    /*!
+     * \brief Reads cached listing replies covering the items from the offset
+     *
+     * The callback receives reply bodies by offset of their first item, the first one contains
+     * the item at the offset and each next one continues the previous one. The replies cover
+     * count items at most, or less if the rest is not cached. It is invoked as for object().
+     */
+    void range(const SynoConn* conn, const QByteArray& albumId, const QByteArrayList& formData, int offset, int count,
+               QObject* context, const std::function<void(const QMap<int, QByteArray>&)>& callback);
+    /*! Stores listing reply containing count items from the offset, the replies it covers are removed */
+    void insertRange(const SynoConn* conn, const QByteArray& albumId, const QByteArrayList& formData, int offset, int count,
+                     const QByteArray& replyBody);
+
+    /*! Sets validator of the album, cached replies are removed if another validator was set before */
+    void validate(const SynoConn* conn, const QByteArray& albumId, const QByteArray& validator);
+
+    /*! Removes all cached replies of the album */
+    void remove(const SynoConn* conn, const QByteArray& albumId);
+    void clear();
+
+    /*! Returns cache hit counter */
+    quint64 hitCount() const;
+    /*! Returns cache miss counter */
+    quint64 missCount() const;
+
+private:
+    SynoAlbumReplyCache();
+
+    struct ReplyRange
+    {
+        QString filePath;
+        int offset;
+        int count;
+    };
+
+    QString albumDirPath(const SynoConn* conn, const QByteArray& albumId) const;
+    static QVector<ReplyRange> replyRanges(const QString& dirPath, const QString& baseName);
+    void trim();
+
+private:
+    /*! Absolute path of the cache, it is not changed after construction */
+    QString m_rootPath;
+    qint64 m_maxSize;
+    /*! Approximate size of cached files, it is accessed by the I/O thread only */
+    qint64 m_size;
+    /*! Single thread, so files are accessed in the order of the calls */
+    QThreadPool m_ioPool;
+    quint64 m_missCount;
+    quint64 m_hitCount;
+};
+
+#endif // SYNOALBUMREPLYCACHE_H
@@ -0,0 +1,755 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synoalbumreplyparser.h"
+#include "synoreplyjson.h"
+
+#include <QHash>
+#include <QLatin1String>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+/*!
+ * \brief Pull reader of JSON text
+ *
+ * The reader does not allocate memory, except for decoded string values.
+ * Values of unexpected types are skipped, leaving the output untouched.
+ */
+class SynoJsonReader
+{
+public:
+    SynoJsonReader(const QByteArray& text)
+        : m_begin(text.constData())
+        , m_ptr(m_begin)
+        , m_end(m_begin + text.size())
+    {}
+
+    bool hasError() const { return m_errorOffset >= 0; }
+    int errorOffset() const { return m_errorOffset; }
+
+    bool atEnd()
+    {
+        skipWhitespace();
+        return m_ptr == m_end;
+    }
+
+    bool isNull()
+    {
+        skipWhitespace();
+        return m_ptr != m_end && *m_ptr == 'n';
+    }
+
+    /*! Enters the object, or skips the value if it is not an object */
+    bool beginObject()
+    {
+        skipWhitespace();
+        if (m_ptr != m_end && *m_ptr == '{') {
+            ++m_ptr;
+            return true;
+        }
+
+        skipValue();
+        return false;
+    }
+
+    /*! Reads the next key of the object, returns false when the object is finished */
+    bool nextKey(QLatin1String& key, bool first)
+    {
+        skipWhitespace();
+        if (m_ptr == m_end) {
+            setError();
+            return false;
+        }
+
+        if (*m_ptr == '}') {
+            ++m_ptr;
+            return false;
+        }
+
+        if (!first) {
+            if (*m_ptr != ',') {
+                setError();
+                return false;
+            }
+            ++m_ptr;
+            skipWhitespace();
+        }
+
+        const char* keyBegin = nullptr;
+        const char* keyEnd = nullptr;
+        bool hasEscapes = false;
+        if (!scanString(keyBegin, keyEnd, hasEscapes)) {
+            return false;
+        }
+
+        if (hasEscapes) {
+            m_keyBuffer = decodeString(keyBegin, keyEnd).toUtf8();
+            key = QLatin1String(m_keyBuffer.constData(), m_keyBuffer.size());
+        } else {
+            key = QLatin1String(keyBegin, static_cast<int>(keyEnd - keyBegin));
+        }
+
+        skipWhitespace();
+        if (m_ptr == m_end || *m_ptr != ':') {
+            setError();
+            return false;
+        }
+        ++m_ptr;
+
+        return true;
+    }
+
+    /*! Enters the array, or skips the value if it is not an array */
+    bool beginArray()
+    {
+        skipWhitespace();
+        if (m_ptr != m_end && *m_ptr == '[') {
+            ++m_ptr;
+            return true;
+        }
+
+        skipValue();
+        return false;
+    }
+
+    /*! Moves to the next element of the array, returns false when the array is finished */
+    bool nextElement(bool first)
+    {
+        skipWhitespace();
+        if (m_ptr == m_end) {
+            setError();
+            return false;
+        }
+
+        if (*m_ptr == ']') {
+            ++m_ptr;
+            return false;
+        }
+
+        if (!first) {
+            if (*m_ptr != ',') {
+                setError();
+                return false;
+            }
+            ++m_ptr;
+        }
+
+        return true;
+    }
+
+    void readString(QString& out)
+    {
+        skipWhitespace();
+        if (m_ptr == m_end || *m_ptr != '"') {
+            skipValue();
+            return;
+        }
+
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        bool hasEscapes = false;
+        if (scanString(begin, end, hasEscapes)) {
+            out = hasEscapes ? decodeString(begin, end)
+                             : QString::fromUtf8(begin, static_cast<int>(end - begin));
+        }
+    }
+
+    void readInt(int& out)
+    {
+        skipWhitespace();
+        if (m_ptr == m_end || (*m_ptr != '-' && (*m_ptr < '0' || *m_ptr > '9'))) {
+            skipValue();
+            return;
+        }
+
+        const char* begin = m_ptr;
+        bool isInteger = true;
+        qint64 value = 0;
+        bool isNegative = (*m_ptr == '-');
+        if (isNegative) {
+            ++m_ptr;
+        }
+
+        for (; m_ptr != m_end && *m_ptr >= '0' && *m_ptr <= '9'; ++m_ptr) {
+            if (isInteger) {
+                value = value * 10 + (*m_ptr - '0');
+                isInteger = (value <= std::numeric_limits<int>::max());
+            }
+        }
+
+        // fraction and exponent parts
+        for (; m_ptr != m_end && isNumberChar(*m_ptr); ++m_ptr) {
+            isInteger = false;
+        }
+
+        if (isInteger) {
+            out = static_cast<int>(isNegative ? -value : value);
+        } else {
+            // same conversion as QJsonValue::toInt() does
+            double dValue = QByteArray::fromRawData(begin, static_cast<int>(m_ptr - begin)).toDouble();
+            if (std::fabs(dValue) < std::numeric_limits<int>::max() && dValue == static_cast<int>(dValue)) {
+                out = static_cast<int>(dValue);
+            }
+        }
+    }
+
+    /*! Reads boolean value, values of other types are read as false */
+    bool readBool()
+    {
+        bool value = false;
+        readBool(value);
+        return value;
+    }
+
+    /*! Reads string value without decoding of repeated values */
+    QString readAtom()
+    {
+        skipWhitespace();
+        if (m_ptr == m_end || *m_ptr != '"') {
+            skipValue();
+            return QString();
+        }
+
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        bool hasEscapes = false;
+        if (!scanString(begin, end, hasEscapes)) {
+            return QString();
+        }
+
+        if (hasEscapes) {
+            return decodeString(begin, end);
+        }
+
+        // the cache is keyed by raw bytes, so the repeated value is decoded once
+        QByteArray raw = QByteArray::fromRawData(begin, static_cast<int>(end - begin));
+        auto iter = m_atomCache.constFind(raw);
+        if (iter == m_atomCache.constEnd()) {
+            iter = m_atomCache.insert(QByteArray(begin, static_cast<int>(end - begin)),
+                                      QString::fromUtf8(begin, static_cast<int>(end - begin)));
+        }
+
+        return iter.value();
+    }
+
+    void readBool(bool& out)
+    {
+        skipWhitespace();
+        if (matchLiteral("true")) {
+            out = true;
+        } else if (matchLiteral("false")) {
+            out = false;
+        } else {
+            skipValue();
+        }
+    }
+
+    void skipValue()
+    {
+        skipWhitespace();
+        if (m_ptr == m_end) {
+            setError();
+            return;
+        }
+
+        switch (*m_ptr) {
+        case '"': {
+            const char* begin = nullptr;
+            const char* end = nullptr;
+            bool hasEscapes = false;
+            scanString(begin, end, hasEscapes);
+            break;
+        }
+        case '{':
+        case '[':
+            skipContainer();
+            break;
+        case 't':
+        case 'f':
+        case 'n':
+            if (!matchLiteral("true") && !matchLiteral("false") && !matchLiteral("null")) {
+                setError();
+            }
+            break;
+        default:
+            if (*m_ptr == '-' || (*m_ptr >= '0' && *m_ptr <= '9')) {
+                for (; m_ptr != m_end && isNumberChar(*m_ptr); ++m_ptr) {}
+            } else {
+                setError();
+            }
+            break;
+        }
+    }
+
+private:
+    void skipWhitespace()
+    {
+        while (m_ptr != m_end && (*m_ptr == ' ' || *m_ptr == '\n' || *m_ptr == '\r' || *m_ptr == '\t')) {
+            ++m_ptr;
+        }
+    }
+
+    static bool isNumberChar(char c)
+    {
+        return (c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-';
+    }
+
+    bool setError()
+    {
+        if (m_errorOffset < 0) {
+            m_errorOffset = static_cast<int>(m_ptr - m_begin);
+        }
+        // stop parsing
+        m_ptr = m_end;
+        return false;
+    }
+
+    bool matchLiteral(const char* literal)
+    {
+        size_t len = std::strlen(literal);
+        if (static_cast<size_t>(m_end - m_ptr) >= len && !std::memcmp(m_ptr, literal, len)) {
+            m_ptr += len;
+            return true;
+        }
+
+        return false;
+    }
+
+    /*! Moves over the string value, the content is returned without quotes */
+    bool scanString(const char*& begin, const char*& end, bool& hasEscapes)
+    {
+        if (m_ptr == m_end || *m_ptr != '"') {
+            return setError();
+        }
+
+        begin = ++m_ptr;
+        for (; m_ptr != m_end; ++m_ptr) {
+            if (*m_ptr == '"') {
+                end = m_ptr++;
+                return true;
+            }
+
+            if (*m_ptr == '\\') {
+                hasEscapes = true;
+                if (++m_ptr == m_end) {
+                    break;
+                }
+            }
+        }
+
+        return setError();
+    }
+
+    void skipContainer()
+    {
+        int depth = 0;
+        while (m_ptr != m_end) {
+            switch (*m_ptr) {
+            case '"': {
+                const char* begin = nullptr;
+                const char* end = nullptr;
+                bool hasEscapes = false;
+                if (!scanString(begin, end, hasEscapes)) {
+                    return;
+                }
+                continue;
+            }
+            case '{':
+            case '[':
+                ++depth;
+                break;
+            case '}':
+            case ']':
+                if (--depth == 0) {
+                    ++m_ptr;
+                    return;
+                }
+                break;
+            default:
+                break;
+            }
+            ++m_ptr;
+        }
+
+        setError();
+    }
+
+    static int hexValue(char c)
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    static int readHex4(const char*& ptr, const char* end)
+    {
+        if (end - ptr < 4) {
+            return -1;
+        }
+
+        int value = 0;
+        for (int i = 0; i < 4; ++i) {
+            int digit = hexValue(*ptr++);
+            if (digit < 0) {
+                return -1;
+            }
+            value = (value << 4) | digit;
+        }
+
+        return value;
+    }
+
+    static QString decodeString(const char* begin, const char* end)
+    {
+        QString result;
+        result.reserve(static_cast<int>(end - begin));
+
+        const char* chunk = begin;
+        const char* ptr = begin;
+        while (ptr != end) {
+            if (*ptr != '\\') {
+                ++ptr;
+                continue;
+            }
+
+            result.append(QString::fromUtf8(chunk, static_cast<int>(ptr - chunk)));
+            if (++ptr == end) {
+                break;
+            }
+
+            char escaped = *ptr++;
+            switch (escaped) {
+            case 'b': result.append(QLatin1Char('\b')); break;
+            case 'f': result.append(QLatin1Char('\f')); break;
+            case 'n': result.append(QLatin1Char('\n')); break;
+            case 'r': result.append(QLatin1Char('\r')); break;
+            case 't': result.append(QLatin1Char('\t')); break;
+            case 'u': {
+                int codeUnit = readHex4(ptr, end);
+                if (codeUnit >= 0) {
+                    // surrogate pairs are combined by QString itself
+                    result.append(QChar(static_cast<ushort>(codeUnit)));
+                }
+                break;
+            }
+            default:
+                // '"', '\\', '/'
+                result.append(QLatin1Char(escaped));
+                break;
+            }
+
+            chunk = ptr;
+        }
+
+        result.append(QString::fromUtf8(chunk, static_cast<int>(ptr - chunk)));
+        return result;
+    }
+
+private:
+    const char* m_begin;
+    const char* m_ptr;
+    const char* m_end;
+    int m_errorOffset = -1;
+    QByteArray m_keyBuffer;
+    /*! Decoded values of enum-like fields */
+    QHash<QByteArray, QString> m_atomCache;
+};
+
+bool SynoAlbumReplyParser::parse(const QByteArray& replyBody)
+{
+    m_errorString.clear();
+    m_total = 0;
+    m_items.clear();
+
+    SynoJsonReader reader(replyBody);
+
+    bool success = false;
+    bool hasError = false;
+    int errorCode = -1;
+    bool hasErrorCode = false;
+
+    if (reader.beginObject()) {
+        QLatin1String key;
+        for (bool first = true; reader.nextKey(key, first); first = false) {
+            if (key == QLatin1String("success")) {
+                reader.readBool(success);
+            } else if (key == QLatin1String("data")) {
+                readData(reader);
+            } else if (key == QLatin1String("error") && !reader.isNull()) {
+                hasError = true;
+                if (reader.beginObject()) {
+                    QLatin1String errorKey;
+                    for (bool errorFirst = true; reader.nextKey(errorKey, errorFirst); errorFirst = false) {
+                        if (errorKey == QLatin1String("code")) {
+                            hasErrorCode = true;
+                            reader.readInt(errorCode);
+                        } else {
+                            reader.skipValue();
+                        }
+                    }
+                }
+            } else {
+                reader.skipValue();
+            }
+        }
+    }
+
+    if (!reader.hasError() && !reader.atEnd()) {
+        m_errorString = SynoReplyJSON::tr("Cannot parse JSON: %1")
+                        .arg(SynoReplyJSON::tr("garbage at the end of the document"));
+    } else if (reader.hasError()) {
+        m_errorString = SynoReplyJSON::tr("Cannot parse JSON: %1")
+                        .arg(SynoReplyJSON::tr("malformed value at offset %1").arg(reader.errorOffset()));
+    } else if (hasError) {
+        m_errorString = hasErrorCode ? SynoReplyJSON::errorStringForCode(errorCode)
+                                     : SynoReplyJSON::tr("SYNO error: UNKNOWN");
+    } else if (!success) {
+        m_errorString = SynoReplyJSON::tr("SYNO success: FALSE");
+    }
+
+    if (!m_errorString.isEmpty()) {
+        m_total = 0;
+        m_items.clear();
+        return false;
+    }
+
+    return true;
+}
+
+const QString& SynoAlbumReplyParser::errorString() const
+{
+    return m_errorString;
+}
+
+int SynoAlbumReplyParser::total() const
+{
+    return m_total;
+}
+
+QVector<SynoAlbumData>& SynoAlbumReplyParser::items()
+{
+    return m_items;
+}
+
+void SynoAlbumReplyParser::readData(SynoJsonReader& reader)
+{
+    if (!reader.beginObject()) {
+        return;
+    }
+
+    QLatin1String key;
+    for (bool first = true; reader.nextKey(key, first); first = false) {
+        if (key == QLatin1String("total")) {
+            reader.readInt(m_total);
+        } else if (key == QLatin1String("items")) {
+            if (reader.beginArray()) {
+                for (bool itemFirst = true; reader.nextElement(itemFirst); itemFirst = false) {
+                    // records are value-initialized, as missing fields are not written
+                    m_items.resize(m_items.size() + 1);
+                    readItem(reader, m_items.last());
+                }
+            }
+        } else {
+            reader.skipValue();
+        }
+    }
+}
+
+void SynoAlbumReplyParser::readItem(SynoJsonReader& reader, SynoAlbumData& item)
+{
+    // sizes of missing thumbnails are empty, rather than invalid
+    item.thumb_preview_size = QSize(0, 0);
+    item.thumb_small_size = QSize(0, 0);
+    item.thumb_large_size = QSize(0, 0);
+
+    if (!reader.beginObject()) {
+        return;
+    }
+
+    QLatin1String key;
+    for (bool first = true; reader.nextKey(key, first); first = false) {
+        if (key == QLatin1String("id")) {
+            reader.readString(item.id);
+        } else if (key == QLatin1String("type")) {
+            item.setType(reader.readAtom());
+        } else if (key == QLatin1String("thumbnail_status")) {
+            item.setThumbnailStatus(reader.readAtom());
+        } else if (key == QLatin1String("info")) {
+            readInfo(reader, item);
+        } else if (key == QLatin1String("additional")) {
+            readAdditional(reader, item);
+        } else {
+            reader.skipValue();
+        }
+    }
+}
+
+void SynoAlbumReplyParser::readInfo(SynoJsonReader& reader, SynoAlbumData& item)
+{
+    if (!reader.beginObject()) {
+        return;
+    }
+
+    QLatin1String key;
+    for (bool first = true; reader.nextKey(key, first); first = false) {
+        if (key == QLatin1String("sharepath")) {
+            QString sharepath;
+            reader.readString(sharepath);
+            item.setSharepath(sharepath);
+        } else if (key == QLatin1String("name")) {
+            reader.readString(item.name);
+        } else if (key == QLatin1String("title")) {
+            reader.readString(item.title);
+        } else if (key == QLatin1String("description")) {
+            reader.readString(item.description);
+        } else if (key == QLatin1String("hits")) {
+            reader.readInt(item.hits);
+        } else if (key == QLatin1String("type")) {
+            item.setInfoType(reader.readAtom());
+        } else if (key == QLatin1String("conversion")) {
+            item.setConversion(reader.readBool());
+        } else if (key == QLatin1String("allow_comment")) {
+            item.setAllowComment(reader.readBool());
+        } else if (key == QLatin1String("allow_embed")) {
+            item.setAllowEmbed(reader.readBool());
+        } else if (key == QLatin1String("takendate")) {
+            // EXIF value has precedence, it could be read already
+            if (!item.takenTime()) {
+                QString takenDate;
+                reader.readString(takenDate);
+                item.setTakenDate(takenDate);
+            } else {
+                reader.skipValue();
+            }
+        } else {
+            reader.skipValue();
+        }
+    }
+}
+
+void SynoAlbumReplyParser::readAdditional(SynoJsonReader& reader, SynoAlbumData& item)
+{
+    if (!reader.beginObject()) {
+        return;
+    }
+
+    QLatin1String key;
+    for (bool first = true; reader.nextKey(key, first); first = false) {
+        if (key == QLatin1String("file_location")) {
+            QString fileLocation;
+            reader.readString(fileLocation);
+            item.setFileLocation(fileLocation);
+        } else if (key == QLatin1String("album_permission")) {
+            readPermission(reader, item);
+        } else if (key == QLatin1String("thumb_size")) {
+            readThumbSize(reader, item);
+        } else if (key == QLatin1String("photo_exif")) {
+            readExif(reader, item);
+        } else {
+            reader.skipValue();
+        }
+    }
+}
+
+void SynoAlbumReplyParser::readPermission(SynoJsonReader& reader, SynoAlbumData& item)
+{
+    if (!reader.beginObject()) {
+        return;
+    }
+
+    QLatin1String key;
+    for (bool first = true; reader.nextKey(key, first); first = false) {
+        if (key == QLatin1String("browse")) {
+            item.setPermBrowse(reader.readBool());
+        } else if (key == QLatin1String("upload")) {
+            item.setPermUpload(reader.readBool());
+        } else if (key == QLatin1String("manage")) {
+            item.setPermManage(reader.readBool());
+        } else {
+            reader.skipValue();
+        }
+    }
+}
+
+void SynoAlbumReplyParser::readExif(SynoJsonReader& reader, SynoAlbumData& item)
+{
+    if (!reader.beginObject()) {
+        return;
+    }
+
+    QLatin1String key;
+    for (bool first = true; reader.nextKey(key, first); first = false) {
+        if (key == QLatin1String("takendate")) {
+            QString takenDate;
+            reader.readString(takenDate);
+            item.setTakenDate(takenDate);
+        } else {
+            reader.skipValue();
+        }
+    }
+}
+
+void SynoAlbumReplyParser::readThumbSize(SynoJsonReader& reader, SynoAlbumData& item)
+{
+    if (!reader.beginObject()) {
+        return;
+    }
+
+    QLatin1String key;
+    for (bool first = true; reader.nextKey(key, first); first = false) {
+        if (key == QLatin1String("sig")) {
+            reader.readString(item.thumb_sig);
+        } else if (key == QLatin1String("preview")) {
+            readThumbInfo(reader, item.thumb_preview_size, item.thumb_preview_mtime);
+        } else if (key == QLatin1String("small")) {
+            readThumbInfo(reader, item.thumb_small_size, item.thumb_small_mtime);
+        } else if (key == QLatin1String("large")) {
+            readThumbInfo(reader, item.thumb_large_size, item.thumb_large_mtime);
+        } else {
+            reader.skipValue();
+        }
+    }
+}
+
+void SynoAlbumReplyParser::readThumbInfo(SynoJsonReader& reader, QSize& size, int& mtime)
+{
+    if (!reader.beginObject()) {
+        return;
+    }
+
+    int width = 0;
+    int height = 0;
+
+    QLatin1String key;
+    for (bool first = true; reader.nextKey(key, first); first = false) {
+        if (key == QLatin1String("resolutionx")) {
+            reader.readInt(width);
+        } else if (key == QLatin1String("resolutiony")) {
+            reader.readInt(height);
+        } else if (key == QLatin1String("mtime")) {
+            reader.readInt(mtime);
+        } else {
+            reader.skipValue();
+        }
+    }
+
+    size = QSize(width, height);
+}
@@ -0,0 +1,71 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNOALBUMREPLYPARSER_H
+#define SYNOALBUMREPLYPARSER_H
+
+#include "synoalbumdata.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+class SynoJsonReader;
+
+/*!
+ * \brief Streaming parser of SYNO.PhotoStation.Album replies
+ *
+ * The reply is parsed in a single pass, and the items are written directly
+ * into album records, without building JSON document. Unknown keys are skipped.
+ * Status and error reporting is compatible with SynoReplyJSON.
+ *
+ * Both list and getinfo replies are supported.
+ */
+class SynoAlbumReplyParser
+{
+    Q_DISABLE_COPY(SynoAlbumReplyParser)
+
+public:
+    SynoAlbumReplyParser() {}
+
+    /*! Parses the reply, returns false on error */
+    bool parse(const QByteArray& replyBody);
+
+    const QString& errorString() const;
+    /*! Returns total amount of items in the album */
+    int total() const;
+    /*! Returns parsed items, they could be moved out */
+    QVector<SynoAlbumData>& items();
+
+private:
+    void readData(SynoJsonReader& reader);
+    void readItem(SynoJsonReader& reader, SynoAlbumData& item);
+    void readInfo(SynoJsonReader& reader, SynoAlbumData& item);
+    void readAdditional(SynoJsonReader& reader, SynoAlbumData& item);
+    void readPermission(SynoJsonReader& reader, SynoAlbumData& item);
+    void readExif(SynoJsonReader& reader, SynoAlbumData& item);
+    void readThumbSize(SynoJsonReader& reader, SynoAlbumData& item);
+    void readThumbInfo(SynoJsonReader& reader, QSize& size, int& mtime);
+
+private:
+    QString m_errorString;
+    int m_total = 0;
+    QVector<SynoAlbumData> m_items;
+};
+
+#endif // SYNOALBUMREPLYPARSER_H
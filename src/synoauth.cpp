@@ -173,6 +173,47 @@ void SynoAuth::setKeepCookies(bool value)
     }
 }
 
+bool SynoAuth::resumeCachedSession()
+{
+    SynoSettings settings(QStringLiteral("connection"));
+    const QString username = settings.value(QStringLiteral("sessionUsername")).toString();
+    const QString url = settings.value(QStringLiteral("sessionUrl")).toString();
+    if (username.isEmpty() || url != m_conn->synoUrl().toString() || !isCookieAvailable()) {
+        return false;
+    }
+
+    // token is obtained on verification of the session
+    m_synoToken.clear();
+    SetUsername(username);
+    setStatus(SynoAuth::AUTHORIZED);
+
+    return true;
+}
+
+void SynoAuth::verifySession(std::function<void(bool)> callback)
+{
+    QByteArrayList formData;
+    formData << QByteArrayLiteral("method=checkauth");
+    formData << QByteArrayLiteral("version=1");
+
+    std::shared_ptr<SynoRequest> req = m_conn->createRequest(QByteArrayLiteral("SYNO.PhotoStation.Auth"), formData);
+    req->send(this, [this, req, callback]() {
+        if (!req->errorString().isEmpty()) {
+            // service is not reachable, the session is kept
+            callback(false);
+            return;
+        }
+
+        if (processAuthorizeReply(req.get())) {
+            qInfo() << tr("Session verification successful");
+        } else {
+            qInfo() << tr("Session is rejected, credentials should be submitted");
+        }
+
+        callback(true);
+    });
+}
+
 void SynoAuth::reloadCookies(QJSValue callback)
 {
     cookieJar()->loadFromStorage(this, [callback]() {
@@ -191,6 +232,10 @@ void SynoAuth::closeSession(bool clearCookies)
         SynoCookieJar* jar = cookieJar();
         jar->clear();
         jar->saveToStorage();
+
+        SynoSettings settings(QStringLiteral("connection"));
+        settings.setValue(QStringLiteral("sessionUsername"), QVariant());
+        settings.setValue(QStringLiteral("sessionUrl"), QVariant());
         emit isCookieAvailableChanged();
     }
 }
@@ -325,11 +370,19 @@ bool SynoAuth::processAuthorizeReply(const SynoRequest* req)
     }
 
     SynoCookieJar* jar = cookieJar();
+    SynoSettings settings(QStringLiteral("connection"));
     if (m_keepCookies) {
         jar->saveToStorage();
+
+        // the session is resumed in offline mode, if the service is not reachable at launch
+        settings.setValue(QStringLiteral("sessionUsername"), m_username);
+        settings.setValue(QStringLiteral("sessionUrl"), m_conn->synoUrl().toString());
     } else {
         // preserve cookies for active session, but remove from persistent storage
         jar->deleteFromStorage();
+
+        settings.setValue(QStringLiteral("sessionUsername"), QVariant());
+        settings.setValue(QStringLiteral("sessionUrl"), QVariant());
     }
 
     setStatus(SynoAuth::AUTHORIZED);
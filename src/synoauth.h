@@ -24,6 +24,8 @@
 #include <QObject>
 #include <QQmlEngine>
 
+#include <functional>
+
 class QNetworkAccessManager;
 
 class SynoConn;
@@ -91,6 +93,26 @@ public:
      */
     Q_INVOKABLE bool isCookieAvailableForUrl(const QUrl& url) const;
 
+    /*!
+     *  \brief This method restores the persisted session without contacting the service
+     *
+     *  The session is restored when cookies and the user of the last session are kept
+     *  for current URL. It is used for offline mode, the session is not verified.
+     *
+     *  \returns TRUE if the session is restored
+     */
+    bool resumeCachedSession();
+
+    /*!
+     *  \brief This method verifies the session with the service
+     *
+     *  \param callback Callback to be executed on completion. Expected signature: void(bool isReachable)
+     *
+     *  The session is authorized again on success, or closed if the service rejects it.
+     *  The session is kept if the service is not reachable.
+     */
+    void verifySession(std::function<void(bool)> callback);
+
 public slots:
     void authorizeWithCredentials(const QString& username, const QString& password);
     void authorizeWithCookie();
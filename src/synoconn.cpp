@@ -17,17 +17,23 @@
  */
 
 #include "synoconn_p.h"
+#include "synocontenttype.h"
 #include "synoerror.h"
 #include "synoreplyjson.h"
+#include "synosettings.h"
 #include "synotraits.h"
 
 #include <QDebug>
+#include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonParseError>
 #include <QThread>
 #include <QUrlQuery>
 
+#include <cstring>
+#include <limits>
+
 SynoConn::SynoConn(QObject* parent)
     : QObject(*(new SynoConnPrivate()), parent)
 {
@@ -35,8 +41,42 @@ SynoConn::SynoConn(QObject* parent)
 
     d->apiDir = QByteArrayLiteral("webapi");
     d->status = SynoConn::NONE;
+    d->isEncrypted = false;
     d->auth = new SynoAuth(&d->networkManager, this);
     d->sslConfig = new SynoSslConfig(&d->networkManager, this);
+
+    SynoSettings settings(QStringLiteral("connection"));
+    d->reconnectTimer.setInterval(qBound(1000, settings.value(QStringLiteral("reconnectIntervalMs"), 30000).toInt(), std::numeric_limits<int>::max()));
+    connect(&d->reconnectTimer, &QTimer::timeout, this, [d]() {
+        d->sendReconnectRequest();
+    });
+
+    SynoSettings performanceSettings(QStringLiteral("performance"));
+    d->batchMaxSize = qBound(1, performanceSettings.value(QStringLiteral("compoundRequestMaxSize"), 8).toInt(), std::numeric_limits<int>::max());
+    d->handlePoolMaxSize = qBound(0, performanceSettings.value(QStringLiteral("requestHandlePoolSize"), 64).toInt(), 4096);
+
+    d->batchTimer.setSingleShot(true);
+    d->batchTimer.setInterval(0);
+    connect(&d->batchTimer, &QTimer::timeout, this, [d]() {
+        d->flushBatchQueue();
+    });
+
+    d->sessionWaitTimer.setSingleShot(true);
+    d->sessionWaitTimer.setInterval(qBound(0, performanceSettings.value(QStringLiteral("sslSessionWaitMs"), 1000).toInt(), 60000));
+    connect(&d->sessionWaitTimer, &QTimer::timeout, this, [d]() {
+        // the session ticket is not loaded in time, full handshake is performed
+        d->sendApiMapRequest();
+    });
+
+    connect(d->sslConfig, &SynoSslConfig::sessionLoaded, this, [d]() {
+        // request templates should carry the loaded session ticket
+        d->endpoints.clear();
+
+        if (d->sessionWaitTimer.isActive()) {
+            d->sessionWaitTimer.stop();
+            d->sendApiMapRequest();
+        }
+    });
 }
 
 SynoConn::~SynoConn()
@@ -44,6 +84,14 @@ SynoConn::~SynoConn()
     disconnectFromSyno();
 }
 
+SynoConnPrivate::~SynoConnPrivate()
+{
+    // handles owned by callers are expected to be released before the connection
+    for (SynoRequestHandle* handle : handlePool) {
+        delete handle;
+    }
+}
+
 void SynoConn::connectToSyno(const QUrl& synoUrl)
 {
     Q_D(SynoConn);
@@ -54,14 +102,16 @@ void SynoConn::connectToSyno(const QUrl& synoUrl)
 
     if (d->synoUrl != synoUrl) {
         d->synoUrl = synoUrl;
+        d->isEncrypted = (synoUrl.scheme() == QStringLiteral("https"));
 
         // reload SSL config
         d->sslConfig->loadExceptionsFromStorage();
+        d->sslConfig->loadSessionFromStorage();
 
         emit synoUrlChanged();
     }
 
-    if (synoUrl.scheme() == QStringLiteral("https")) {
+    if (d->isEncrypted) {
         if (d->sslConfig->isSslAvailable()) {
             d->sslConfig->connectToHostEncrypted(synoUrl.host(), static_cast<quint16>(synoUrl.port(443)));
         } else {
@@ -72,6 +122,13 @@ void SynoConn::connectToSyno(const QUrl& synoUrl)
         d->networkManager.connectToHost(synoUrl.host(), static_cast<quint16>(synoUrl.port(80)));
     }
 
+    if (d->isEncrypted && d->sslConfig->isSessionLoading()) {
+        // the first request resumes the persisted TLS session, so it waits for the ticket briefly
+        d->setStatus(SynoConn::ATTEMPT_API);
+        d->sessionWaitTimer.start();
+        return;
+    }
+
     d->sendApiMapRequest();
 }
 
@@ -79,6 +136,8 @@ void SynoConn::disconnectFromSyno()
 {
     Q_D(SynoConn);
 
+    d->reconnectTimer.stop();
+    d->sessionWaitTimer.stop();
     cancelAllRequests();
     d->networkManager.clearConnectionCache();
     d->networkManager.clearAccessCache();
@@ -113,52 +172,93 @@ void SynoConn::sendRequest(SynoRequest* request)
 
     Q_ASSERT(request);
 
-    QString path = d->pathForAPI(request->api());
-    Q_ASSERT(!path.isEmpty());
-    if (path.isNull()) {
-        request->setErrorString(tr("Unknown API: %1").arg(QString::fromUtf8(request->api())));
-        return;
+    if (!request->isBackground()) {
+        d->foregroundTimer.start();
     }
 
-    QUrl url(d->synoUrl);
-    url.setPath(path);
+    if (request->isBatchable()) {
+        if (!d->batchQueue.contains(request)) {
+            d->batchQueue.append(request);
+            d->batchTimer.start();
+        }
+    } else {
+        d->sendSingleRequest(request);
+    }
+}
 
-    QUrlQuery urlQuery;
+void SynoConnPrivate::sendSingleRequest(SynoRequest* request)
+{
+    Q_Q(SynoConn);
+
+    const SynoEndpoint* endpoint = endpointForAPI(request->api());
+    Q_ASSERT(endpoint);
+    if (!endpoint) {
+        request->setErrorString(QObject::tr("Unknown API: %1").arg(QString::fromUtf8(request->api())));
+        return;
+    }
 
-    const QByteArray& token = d->auth->synoToken();
+    QByteArray body = prepareRequest(request, *endpoint);
 
-    if (!token.isEmpty()) {
-        request->request().setRawHeader(QByteArrayLiteral("X-SYNO-TOKEN"), token);
-        urlQuery.addQueryItem(QByteArrayLiteral("SynoToken"), token);
+    // invalidate old connection
+    if (QNetworkReply* reply = request->reply()) {
+        QObject::disconnect(reply, nullptr, q, nullptr);
     }
 
-    url.setQuery(urlQuery);
-    request->request().setUrl(url);
-    request->request().setHeader(QNetworkRequest::ContentTypeHeader, QByteArrayLiteral("application/x-www-form-urlencoded"));
+    QNetworkReply* reply = networkManager.post(request->request(), body);
 
-    QByteArray body;
-    body.reserve(512);
-    body += QByteArrayLiteral("api=") + request->api();
+    // connection status follows the reply before the request callback is invoked, e.g. it is offline already
+    pendingRequests.insert(request);
+    QObject::connect(reply, &QNetworkReply::finished, q, std::bind(&SynoConnPrivate::onReplyFinished, this, request));
 
-    if (!token.isEmpty()) {
-        body += QByteArrayLiteral("&SynoToken=") + token;
+    request->setReply(reply);
+}
+
+QByteArray SynoConnPrivate::prepareRequest(SynoRequest* request, const SynoEndpoint& endpoint) const
+{
+    // template is merged into the request, the attributes and headers set by the caller are preserved
+    QNetworkRequest& networkRequest = request->request();
+    networkRequest.setUrl(endpoint.request.url());
+
+    // session token follows the session, also when the request is sent again; empty value removes the header
+    networkRequest.setRawHeader(QByteArrayLiteral("X-SYNO-TOKEN"), endpoint.token);
+
+    for (const QPair<QByteArray, QByteArray>& header : endpoint.headers) {
+        if (!networkRequest.hasRawHeader(header.first)) {
+            networkRequest.setRawHeader(header.first, header.second);
+        }
     }
 
-    for (const QByteArray& formField : std::as_const(request->formData())) {
-        body += '&';
-        body += formField;
+    if (isEncrypted) {
+        networkRequest.setSslConfiguration(endpoint.request.sslConfiguration());
     }
 
-    // invalidate old connection
-    if (QNetworkReply* reply = request->reply()) {
-        QObject::disconnect(reply, nullptr, this, nullptr);
+    if (request->isBackground()) {
+        networkRequest.setPriority(QNetworkRequest::LowPriority);
     }
 
-    QNetworkReply* reply = d->networkManager.post(request->request(), body);
-    request->setReply(reply);
+    return buildRequestBody(endpoint, request->formData());
+}
+
+QByteArray SynoConnPrivate::buildRequestBody(const SynoEndpoint& endpoint, const QByteArrayList& formData) const
+{
+    // body is allocated once with the exact size
+    int bodySize = endpoint.bodyPrefix.size();
+    for (const QByteArray& formField : formData) {
+        bodySize += 1 + formField.size();
+    }
 
-    d->pendingRequests.insert(request);
-    connect(reply, &QNetworkReply::finished, this, std::bind(&SynoConnPrivate::onReplyFinished, d, request));
+    QByteArray body(bodySize, Qt::Uninitialized);
+    char* bodyPtr = body.data();
+    memcpy(bodyPtr, endpoint.bodyPrefix.constData(), static_cast<size_t>(endpoint.bodyPrefix.size()));
+    bodyPtr += endpoint.bodyPrefix.size();
+
+    for (const QByteArray& formField : formData) {
+        *bodyPtr++ = '&';
+        memcpy(bodyPtr, formField.constData(), static_cast<size_t>(formField.size()));
+        bodyPtr += formField.size();
+    }
+
+    return body;
 }
 
 void SynoConn::cancelRequest(SynoRequest* request)
@@ -167,7 +267,9 @@ void SynoConn::cancelRequest(SynoRequest* request)
 
     Q_ASSERT(request);
 
-    if (QNetworkReply* reply = request->reply()) {
+    if (d->batchQueue.removeAll(request) || d->batchedRequests.remove(request)) {
+        // the reply of compound request would not be delivered to this request
+    } else if (QNetworkReply* reply = request->reply()) {
         d->pendingRequests.remove(request);
         reply->abort();
     } else {
@@ -179,6 +281,17 @@ void SynoConn::cancelAllRequests()
 {
     Q_D(SynoConn);
 
+    QVector< QPointer<SynoRequest> > queuedRequests;
+    std::swap(queuedRequests, d->batchQueue);
+    d->batchTimer.stop();
+
+    for (const QPointer<SynoRequest>& req : std::as_const(queuedRequests)) {
+        if (req) {
+            req->complete(QByteArray(), tr("Request cancelled"));
+        }
+    }
+
+    // batched requests are failed on cancellation of their compound requests
     QSet< SynoRequest* > requests;
     std::swap(requests, d->pendingRequests);
 
@@ -187,6 +300,14 @@ void SynoConn::cancelAllRequests()
             reply->abort();
         }
     }
+
+    // aborted handles are completed with error, or recycled if cancelled
+    const QSet< SynoRequestHandle* > handles(d->pendingHandles);
+    for (SynoRequestHandle* handle : handles) {
+        if (d->pendingHandles.contains(handle) && handle->m_reply) {
+            handle->m_reply->abort();
+        }
+    }
 }
 
 SynoConn::SynoConnStatus SynoConn::status() const
@@ -251,6 +372,60 @@ SynoAuth* SynoConn::auth() const
     return d->auth;
 }
 
+const SynoEndpoint* SynoConnPrivate::endpointForAPI(const QByteArray& api)
+{
+    const QByteArray& token = auth->synoToken();
+    if (token != endpointsToken) {
+        endpoints.clear();
+        endpointsToken = token;
+    }
+
+    auto iter = endpoints.constFind(api);
+    if (iter != endpoints.constEnd()) {
+        return &iter.value();
+    }
+
+    QString path = pathForAPI(api);
+    if (path.isEmpty()) {
+        return nullptr;
+    }
+
+    QUrl url(synoUrl);
+    url.setPath(path);
+
+    SynoEndpoint endpoint;
+    endpoint.bodyPrefix.reserve(256);
+    endpoint.bodyPrefix += QByteArrayLiteral("api=") + api;
+
+    if (!token.isEmpty()) {
+        QUrlQuery urlQuery;
+        urlQuery.addQueryItem(QStringLiteral("SynoToken"), QString::fromLatin1(token));
+        url.setQuery(urlQuery);
+
+        endpoint.request.setRawHeader(QByteArrayLiteral("X-SYNO-TOKEN"), token);
+        endpoint.token = token;
+        endpoint.bodyPrefix += QByteArrayLiteral("&SynoToken=") + token;
+    }
+
+    endpoint.request.setUrl(url);
+    endpoint.request.setHeader(QNetworkRequest::ContentTypeHeader, QByteArrayLiteral("application/x-www-form-urlencoded"));
+
+    if (isEncrypted) {
+        sslConfig->applySslConfiguration(endpoint.request);
+    }
+
+    endpoint.bodyPrefix.squeeze();
+
+    const QList<QByteArray> headers = endpoint.request.rawHeaderList();
+    for (const QByteArray& header : headers) {
+        if (header != QByteArrayLiteral("X-SYNO-TOKEN")) {
+            endpoint.headers.append(qMakePair(header, endpoint.request.rawHeader(header)));
+        }
+    }
+
+    return &endpoints.insert(api, endpoint).value();
+}
+
 QString SynoConnPrivate::pathForAPI(const QByteArray& api) const
 {
     QString apiPath = apiMap.value(api);
@@ -276,31 +451,63 @@ void SynoConnPrivate::sendApiMapRequest()
     setStatus(SynoConn::ATTEMPT_API);
 
     apiMap.clear();
+    endpoints.clear();
     apiMap[QByteArrayLiteral("SYNO.API.Info")] = QStringLiteral("query.php");
     emit q->apiListChanged();
 
-    QByteArrayList formData;
-    formData << QByteArrayLiteral("query=all");
-    formData << QByteArrayLiteral("method=query");
-    formData << QByteArrayLiteral("version=1");
-    formData << QByteArrayLiteral("ps_username=");
-
-    std::shared_ptr<SynoRequest> req = q->createRequest(QByteArrayLiteral("SYNO.API.Info"), formData);
+    std::shared_ptr<SynoRequest> req = q->createRequest(QByteArrayLiteral("SYNO.API.Info"), apiMapFormData());
     req->send(q, [this, req]() {
         if (processApiMapReply(req.get())) {
             setStatus(SynoConn::API_LOADED);
+        } else if (req->reply() && isUnreachableError(req->reply()->error()) && auth->resumeCachedSession()) {
+            // the service is asleep or unreachable, locally cached data of the last session is browsed
+            setOffline();
         } else {
             setStatus(SynoConn::NONE);
         }
     });
 }
 
+QByteArrayList SynoConnPrivate::apiMapFormData()
+{
+    QByteArrayList formData;
+    formData << QByteArrayLiteral("query=all");
+    formData << QByteArrayLiteral("method=query");
+    formData << QByteArrayLiteral("version=1");
+    formData << QByteArrayLiteral("ps_username=");
+    return formData;
+}
+
+bool SynoConnPrivate::isUnreachableError(QNetworkReply::NetworkError error)
+{
+    switch (error) {
+    // fatal network layer errors:
+    case QNetworkReply::ConnectionRefusedError:
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::HostNotFoundError:
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::SslHandshakeFailedError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::BackgroundRequestNotAllowedError:
+    case QNetworkReply::UnknownNetworkError:
+    // fatal proxy errors:
+    case QNetworkReply::ProxyConnectionRefusedError:
+    case QNetworkReply::ProxyConnectionClosedError:
+    case QNetworkReply::ProxyNotFoundError:
+    case QNetworkReply::ProxyTimeoutError:
+    case QNetworkReply::ProxyAuthenticationRequiredError:
+    case QNetworkReply::UnknownProxyError:
+        return true;
+    default:
+        return false;
+    }
+}
+
 bool SynoConnPrivate::processApiMapReply(const SynoRequest* req)
 {
     Q_Q(SynoConn);
 
     auto failure = [this](const QString& reason) {
-        setStatus(SynoConn::NONE);
         setErrorString(QObject::tr("Cannot populate API map. %1").arg(reason));
     };
 
@@ -332,6 +539,7 @@ bool SynoConnPrivate::processApiMapReply(const SynoRequest* req)
         }
     }
 
+    endpoints.clear();
     emit q->apiListChanged();
 
     return true;
@@ -350,35 +558,397 @@ void SynoConnPrivate::setStatus(SynoConn::SynoConnStatus neuStatus)
 
 void SynoConnPrivate::onReplyFinished(SynoRequest* request)
 {
-    Q_Q(SynoConn);
-
     pendingRequests.remove(request);
+    processReplyError(request->reply());
+}
 
-    QNetworkReply* reply = request->reply();
-
-    if (reply->error() != QNetworkReply::NoError) {
-        switch (reply->error()) {
-        // fatal network layer errors:
-        case QNetworkReply::ConnectionRefusedError:
-        case QNetworkReply::RemoteHostClosedError:
-        case QNetworkReply::HostNotFoundError:
-        case QNetworkReply::TimeoutError:
-        case QNetworkReply::SslHandshakeFailedError:
-        case QNetworkReply::NetworkSessionFailedError:
-        case QNetworkReply::BackgroundRequestNotAllowedError:
-        case QNetworkReply::UnknownNetworkError:
-        // fatal proxy errors:
-        case QNetworkReply::ProxyConnectionRefusedError:
-        case QNetworkReply::ProxyConnectionClosedError:
-        case QNetworkReply::ProxyNotFoundError:
-        case QNetworkReply::ProxyTimeoutError:
-        case QNetworkReply::ProxyAuthenticationRequiredError:
-        case QNetworkReply::UnknownProxyError:
+void SynoConnPrivate::processReplyError(QNetworkReply* reply)
+{
+    Q_Q(SynoConn);
+
+    if (reply->error() == QNetworkReply::NoError) {
+        if (isEncrypted && sslConfig->updateSessionTicket(reply)) {
+            // request templates should carry the new session ticket
+            endpoints.clear();
+        }
+    } else if (isUnreachableError(reply->error())) {
+        if (status == SynoConn::OFFLINE) {
+            // reconnection attempt failed, or request has been sent in offline mode
+        } else if (status == SynoConn::API_LOADED && auth->status() == SynoAuth::AUTHORIZED) {
+            setErrorString(QObject::tr("Network fatal error: %1. Switching to offline mode.").arg(reply->error()));
+            setOffline();
+        } else {
             setErrorString(QObject::tr("Network fatal error: %1").arg(reply->error()));
             q->disconnectFromSyno();
-            break;
-        default:
-            break;
         }
     }
 }
+
+void SynoConnPrivate::setOffline()
+{
+    Q_Q(SynoConn);
+
+    // session is preserved, as the service is expected to come back;
+    // the status is set first, so callbacks of the cancelled requests see the connection offline
+    setStatus(SynoConn::OFFLINE);
+    q->cancelAllRequests();
+    networkManager.clearConnectionCache();
+    reconnectTimer.start();
+}
+
+void SynoConnPrivate::sendReconnectRequest()
+{
+    Q_Q(SynoConn);
+
+    if (!apiMap.contains(QByteArrayLiteral("SYNO.PhotoStation.Auth"))) {
+        // the session was resumed offline at launch, API map is loaded first
+        std::shared_ptr<SynoRequest> req = q->createRequest(QByteArrayLiteral("SYNO.API.Info"), apiMapFormData());
+        req->send(q, [this, req]() {
+            if (status == SynoConn::OFFLINE && req->errorString().isEmpty() && processApiMapReply(req.get())) {
+                sendVerifySessionRequest();
+            }
+        });
+        return;
+    }
+
+    sendVerifySessionRequest();
+}
+
+void SynoConnPrivate::sendVerifySessionRequest()
+{
+    Q_Q(SynoConn);
+
+    // the service is online once it accepts the session, as API queries are answered without one
+    auth->verifySession([this, q](bool isReachable) {
+        if (status != SynoConn::OFFLINE || !isReachable) {
+            return;
+        }
+
+        if (auth->status() == SynoAuth::AUTHORIZED) {
+            reconnectTimer.stop();
+            setErrorString(QString());
+            setStatus(SynoConn::API_LOADED);
+        } else {
+            // session is expired, credentials should be submitted
+            q->disconnectFromSyno();
+        }
+    });
+}
+
+void SynoConnPrivate::flushBatchQueue()
+{
+    QVector< QPointer<SynoRequest> > requests;
+    std::swap(requests, batchQueue);
+    requests.removeAll(nullptr);
+
+    if (requests.size() > 1 && apiMap.contains(QByteArrayLiteral("SYNO.Entry.Request"))) {
+        for (int i = 0; i < requests.size(); i += batchMaxSize) {
+            sendCompoundRequest(requests.mid(i, batchMaxSize));
+        }
+    } else {
+        // compound requests are not available, pipeline the requests over established connections
+        for (const QPointer<SynoRequest>& req : std::as_const(requests)) {
+            req->request().setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, true);
+            sendSingleRequest(req);
+        }
+    }
+}
+
+void SynoConnPrivate::sendCompoundRequest(const QVector< QPointer<SynoRequest> >& requests)
+{
+    Q_Q(SynoConn);
+
+    if (requests.size() == 1) {
+        sendSingleRequest(requests.first());
+        return;
+    }
+
+    QJsonArray compound;
+    for (const QPointer<SynoRequest>& req : requests) {
+        QJsonObject entry;
+        entry[QStringLiteral("api")] = QString::fromUtf8(req->api());
+
+        for (const QByteArray& formField : std::as_const(req->formData())) {
+            int sepIdx = formField.indexOf('=');
+            QString key = QString::fromUtf8(formField.left(sepIdx));
+            QString value = sepIdx < 0 ? QString() : QString::fromUtf8(formField.mid(sepIdx + 1));
+
+            if (key == QStringLiteral("version")) {
+                entry[key] = value.toInt();
+            } else {
+                entry[key] = value;
+            }
+        }
+
+        compound.append(entry);
+        batchedRequests.insert(req);
+    }
+
+    QByteArrayList formData;
+    formData << QByteArrayLiteral("method=request");
+    formData << QByteArrayLiteral("version=1");
+    formData << QByteArrayLiteral("stop_when_error=false");
+    formData << QByteArrayLiteral("compound=") + QUrl::toPercentEncoding(QString::fromUtf8(QJsonDocument(compound).toJson(QJsonDocument::Compact)));
+
+    std::shared_ptr<SynoRequest> compoundReq = q->createRequest(QByteArrayLiteral("SYNO.Entry.Request"), formData);
+    // the parts were accounted on queueing, the compound request is prioritized as its most urgent part
+    compoundReq->setIsBackground(std::all_of(requests.cbegin(), requests.cend(), [](const QPointer<SynoRequest>& req) {
+        return req->isBackground();
+    }));
+    compoundReq->send(q, [this, compoundReq, requests]() {
+        processCompoundReply(compoundReq.get(), requests);
+    });
+}
+
+void SynoConnPrivate::processCompoundReply(const SynoRequest* compoundRequest, const QVector< QPointer<SynoRequest> >& requests)
+{
+    // requests cancelled in the meantime are skipped
+    QVector<SynoRequest*> activeRequests;
+    activeRequests.reserve(requests.size());
+    for (const QPointer<SynoRequest>& req : requests) {
+        if (req && batchedRequests.remove(req)) {
+            activeRequests.append(req);
+        }
+    }
+
+    if (!compoundRequest->errorString().isEmpty()) {
+        for (SynoRequest* req : std::as_const(activeRequests)) {
+            req->complete(QByteArray(), compoundRequest->errorString());
+        }
+        return;
+    }
+
+    SynoReplyJSON replyJSON(compoundRequest);
+    QJsonArray results = replyJSON.dataObject()[QStringLiteral("result")].toArray();
+
+    if (!replyJSON.errorString().isEmpty() || results.size() != requests.size()) {
+        // compound request is rejected by the service, fallback to separate requests
+        qWarning() << __FUNCTION__ << QObject::tr("Compound request failed. %1").arg(replyJSON.errorString());
+        apiMap.remove(QByteArrayLiteral("SYNO.Entry.Request"));
+        endpoints.remove(QByteArrayLiteral("SYNO.Entry.Request"));
+
+        for (SynoRequest* req : std::as_const(activeRequests)) {
+            sendSingleRequest(req);
+        }
+        return;
+    }
+
+    for (int i = 0; i < requests.size(); ++i) {
+        if (!activeRequests.contains(requests[i])) {
+            continue;
+        }
+
+        // each result is presented as a reply of standalone request
+        QJsonObject result = results[i].toObject();
+        result.remove(QStringLiteral("api"));
+        result.remove(QStringLiteral("method"));
+        result.remove(QStringLiteral("version"));
+
+        requests[i]->complete(QJsonDocument(result).toJson(QJsonDocument::Compact), QString());
+    }
+}
+
+SynoRequestHandle* SynoConn::acquireRequestHandle(const QByteArray& api)
+{
+    Q_D(SynoConn);
+
+    SynoRequestHandle* handle = nullptr;
+    {
+        QMutexLocker locker(&d->handlePoolMutex);
+        if (!d->handlePool.empty()) {
+            handle = d->handlePool.back();
+            d->handlePool.pop_back();
+        }
+    }
+
+    if (!handle) {
+        handle = new SynoRequestHandle();
+        ++d->handleAllocCount;
+    }
+
+    ++d->handleAcquireCount;
+    handle->reset(api, ++d->handleGeneration);
+    return handle;
+}
+
+void SynoConn::sendRequestHandle(SynoRequestHandle* handle)
+{
+    Q_D(SynoConn);
+
+    Q_ASSERT(handle);
+    Q_ASSERT(handle->m_state == SynoRequestHandle::State_Idle);
+
+    handle->m_state = SynoRequestHandle::State_InFlight;
+
+    if (QThread::currentThread() == thread()) {
+        d->sendRequestHandle(handle);
+    } else {
+        QMetaObject::invokeMethod(this, [d, handle]() {
+            d->sendRequestHandle(handle);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void SynoConn::releaseRequestHandle(SynoRequestHandle* handle)
+{
+    Q_D(SynoConn);
+
+    Q_ASSERT(handle);
+
+    int state = SynoRequestHandle::State_InFlight;
+    if (handle->m_state.compare_exchange_strong(state, SynoRequestHandle::State_Cancelled)) {
+        // connection owns the handle now, and recycles it once the request is aborted
+        const quint64 generation = handle->m_generation;
+        if (QThread::currentThread() == thread()) {
+            d->abortRequestHandle(handle, generation);
+        } else {
+            QMetaObject::invokeMethod(this, [d, handle, generation]() {
+                d->abortRequestHandle(handle, generation);
+            }, Qt::QueuedConnection);
+        }
+        return;
+    }
+
+    state = SynoRequestHandle::State_Dispatching;
+    if (handle->m_state.compare_exchange_strong(state, SynoRequestHandle::State_Released)) {
+        // the dispatcher recycles the handle once the callback returns
+        if (QThread::currentThread() != thread()) {
+            // objects referred by the callback could be destroyed after this call
+            QMutexLocker locker(&d->dispatchMutex);
+        }
+        return;
+    }
+
+    d->recycleRequestHandle(handle);
+}
+
+QPair<quint64, quint64> SynoConn::requestHandleStatistics() const
+{
+    Q_D(const SynoConn);
+
+    return qMakePair(d->handleAcquireCount.load(), d->handleAllocCount.load());
+}
+
+qint64 SynoConn::foregroundIdleTime() const
+{
+    Q_D(const SynoConn);
+
+    return d->foregroundTimer.isValid() ? d->foregroundTimer.elapsed() : std::numeric_limits<qint64>::max();
+}
+
+void SynoConnPrivate::sendRequestHandle(SynoRequestHandle* handle)
+{
+    Q_Q(SynoConn);
+
+    if (handle->m_state == SynoRequestHandle::State_Cancelled) {
+        // cancelled before being sent
+        recycleRequestHandle(handle);
+        return;
+    }
+
+    const SynoEndpoint* endpoint = endpointForAPI(handle->m_api);
+    Q_ASSERT(endpoint);
+    if (!endpoint) {
+        handle->m_errorString = QObject::tr("Unknown API: %1").arg(QString::fromUtf8(handle->m_api));
+        onRequestHandleFinished(handle);
+        return;
+    }
+
+#ifdef QT_DEBUG
+    qDebug() << QStringLiteral("RQ:API: ") << handle->m_api;
+    qDebug() << QStringLiteral("RQ:FormData: ") << handle->m_formData;
+#endif
+
+    QNetworkRequest networkRequest(endpoint->request);
+    if (handle->m_background) {
+        // images are warmed up after the ones requested by the views
+        networkRequest.setPriority(QNetworkRequest::LowPriority);
+    } else {
+        // handles serve images of the views
+        foregroundTimer.start();
+    }
+
+    handle->m_reply = networkManager.post(networkRequest, buildRequestBody(*endpoint, handle->m_formData));
+    pendingHandles.insert(handle);
+    QObject::connect(handle->m_reply, &QNetworkReply::finished, q, std::bind(&SynoConnPrivate::onRequestHandleFinished, this, handle));
+}
+
+void SynoConnPrivate::abortRequestHandle(SynoRequestHandle* handle, quint64 generation)
+{
+    // the handle could be recycled and reused already
+    if (pendingHandles.contains(handle) && handle->m_generation == generation) {
+        handle->m_reply->abort();
+    }
+}
+
+void SynoConnPrivate::onRequestHandleFinished(SynoRequestHandle* handle)
+{
+    QNetworkReply* reply = handle->m_reply;
+    handle->m_reply = nullptr;
+    pendingHandles.remove(handle);
+
+    if (reply) {
+        reply->deleteLater();
+
+        if (QNetworkReply::NoError != reply->error()) {
+            if (QNetworkReply::TemporaryNetworkFailureError == reply->error()
+                    && handle->m_state == SynoRequestHandle::State_InFlight) {
+                // send request again
+                sendRequestHandle(handle);
+                return;
+            }
+            handle->m_errorString = QObject::tr("Network error: %1").arg(reply->errorString());
+        } else if (!reply->size()) {
+            handle->m_errorString = QObject::tr("Unknown network error");
+        } else {
+            handle->m_replyBody = reply->readAll();
+            reply->close();
+
+            SynoContentTypeInfo info = SynoContentTypeClassifier::instance().classify(reply->header(QNetworkRequest::ContentTypeHeader).toByteArray());
+            handle->m_contentType = info.type;
+            handle->m_contentImageFormat = info.imageFormat;
+        }
+    }
+
+    // the mutex is held during dispatching, so the handle released by other thread waits for the callback
+    QMutexLocker locker(&dispatchMutex);
+    int state = SynoRequestHandle::State_InFlight;
+    if (handle->m_state.compare_exchange_strong(state, SynoRequestHandle::State_Dispatching)) {
+        if (handle->m_callback) {
+            handle->m_callback(handle);
+        }
+        locker.unlock();
+
+        // the handle could be released by the callback, or by other thread in the meantime
+        state = SynoRequestHandle::State_Dispatching;
+        if (!handle->m_state.compare_exchange_strong(state, SynoRequestHandle::State_Completed)) {
+            Q_ASSERT(state == SynoRequestHandle::State_Released);
+            recycleRequestHandle(handle);
+        }
+    } else {
+        locker.unlock();
+        Q_ASSERT(state == SynoRequestHandle::State_Cancelled);
+        recycleRequestHandle(handle);
+    }
+
+    if (reply) {
+        processReplyError(reply);
+    }
+}
+
+void SynoConnPrivate::recycleRequestHandle(SynoRequestHandle* handle)
+{
+    // release the buffers, but keep the capacity of form data
+    handle->m_callback = SynoRequestHandle::Callback();
+    handle->m_replyBody.clear();
+
+    {
+        QMutexLocker locker(&handlePoolMutex);
+        if (handlePool.size() < static_cast<size_t>(handlePoolMaxSize)) {
+            handlePool.push_back(handle);
+            return;
+        }
+    }
+
+    delete handle;
+}
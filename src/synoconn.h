@@ -22,12 +22,14 @@
 #include <memory>
 
 #include <QObject>
+#include <QPair>
 #include <QQmlEngine>
 #include <QUrl>
 
 class SynoAuth;
 class SynoConnPrivate;
 class SynoRequest;
+class SynoRequestHandle;
 class SynoSslConfig;
 
 class SynoConn : public QObject
@@ -56,7 +58,9 @@ public:
         /*! Attempting API loading */
         ATTEMPT_API,
         /*! API is loaded */
-        API_LOADED
+        API_LOADED,
+        /*! Service became unreachable, locally cached data is used until reconnection */
+        OFFLINE
     };
     Q_ENUM(SynoConnStatus)
 
@@ -96,6 +100,45 @@ public:
     Q_INVOKABLE std::shared_ptr<SynoRequest> createRequest(const QByteArray& api,
                                                            const QByteArrayList& formData);
 
+    /*!
+     *  \brief Obtains a pooled request handle for specified API
+     *
+     *  The handle should be returned with releaseRequestHandle() exactly once.
+     *  This method is intended to be used from C++.
+     *
+     *  This method is thread-safe.
+     */
+    SynoRequestHandle* acquireRequestHandle(const QByteArray& api);
+
+    /*!
+     *  \brief Sends the request of the handle
+     *
+     *  The callback of the handle is invoked in the thread of this object.
+     *
+     *  This method is thread-safe.
+     */
+    void sendRequestHandle(SynoRequestHandle* handle);
+
+    /*!
+     *  \brief Returns the handle to the pool, cancelling the request if it is in flight
+     *
+     *  It is guaranteed the callback would not be invoked after this call.
+     *  The handle could be released from its callback, it is recycled once the callback returns.
+     *
+     *  This method is thread-safe.
+     */
+    void releaseRequestHandle(SynoRequestHandle* handle);
+
+    /*! Returns amount of handles acquired, and amount of handles allocated */
+    QPair<quint64, quint64> requestHandleStatistics() const;
+
+    /*!
+     *  \brief Returns time in milliseconds since last foreground request was sent
+     *
+     *  Background requests are not counted.
+     */
+    qint64 foregroundIdleTime() const;
+
 signals:
     void synoUrlChanged();
     void errorStringChanged();
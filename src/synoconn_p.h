@@ -21,20 +21,49 @@
 
 #include <memory>
 
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
 #include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
 #include <QObject>
+#include <QPair>
 #include <QPointer>
 #include <QQmlEngine>
 #include <QSet>
+#include <QTimer>
 #include <QUrl>
+#include <QVector>
 
 #include "synoauth.h"
 #include "synoconn.h"
 #include "synorequest.h"
+#include "synorequesthandle.h"
 #include "synosslconfig.h"
 
 #include <QtCore/private/qobject_p.h>
 
+#include <atomic>
+#include <vector>
+
+
+/*!
+ * \brief Precompiled request template of API
+ *
+ * It is resolved once per session, and reused for all requests of the API.
+ */
+struct SynoEndpoint
+{
+    /*! Network request with resolved URL, headers and SSL configuration */
+    QNetworkRequest request;
+    /*! Form body prefix with API name and session token */
+    QByteArray bodyPrefix;
+    /*! Session token header value, empty without session */
+    QByteArray token;
+    /*! Raw headers of the request but the session token, listed once so requests do not walk the template */
+    QVector< QPair<QByteArray, QByteArray> > headers;
+};
 
 class SynoConnPrivate : public QObjectPrivate
 {
@@ -42,13 +71,34 @@ class SynoConnPrivate : public QObjectPrivate
 
 public:
     SynoConnPrivate() {}
+    ~SynoConnPrivate();
 
     void setErrorString(const QString& err);
     QString pathForAPI(const QByteArray& api) const;
+    const SynoEndpoint* endpointForAPI(const QByteArray& api);
     void sendApiMapRequest();
+    static QByteArrayList apiMapFormData();
+    static bool isUnreachableError(QNetworkReply::NetworkError error);
     bool processApiMapReply(const SynoRequest* req);
     void setStatus(SynoConn::SynoConnStatus status);
     void onReplyFinished(SynoRequest* request);
+    void setOffline();
+    void sendReconnectRequest();
+    void sendVerifySessionRequest();
+
+    QByteArray buildRequestBody(const SynoEndpoint& endpoint, const QByteArrayList& formData) const;
+    void processReplyError(QNetworkReply* reply);
+
+    QByteArray prepareRequest(SynoRequest* request, const SynoEndpoint& endpoint) const;
+    void sendSingleRequest(SynoRequest* request);
+    void flushBatchQueue();
+    void sendCompoundRequest(const QVector< QPointer<SynoRequest> >& requests);
+    void processCompoundReply(const SynoRequest* compoundRequest, const QVector< QPointer<SynoRequest> >& requests);
+
+    void sendRequestHandle(SynoRequestHandle* handle);
+    void abortRequestHandle(SynoRequestHandle* handle, quint64 generation);
+    void onRequestHandleFinished(SynoRequestHandle* handle);
+    void recycleRequestHandle(SynoRequestHandle* handle);
 
 public:
     QString errorString;
@@ -61,12 +111,46 @@ public:
     QMap<QByteArray, QString> apiMap;
     /*! Path to API directory */
     QString apiDir;
+    /*! Hash of API query to request template */
+    QHash<QByteArray, SynoEndpoint> endpoints;
+    /*! Session token the request templates are built with */
+    QByteArray endpointsToken;
+    /*! Connection uses TLS */
+    bool isEncrypted;
     /*! Connection status */
     SynoConn::SynoConnStatus status;
     /*! Authorization handler */
     SynoAuth* auth;
     /*! SSL config */
     SynoSslConfig* sslConfig;
+    /*! Timer of reconnection attempts in offline mode */
+    QTimer reconnectTimer;
+    /*! Timer limiting the wait for persisted TLS session before the first request */
+    QTimer sessionWaitTimer;
+    /*! Requests awaiting to be coalesced into compound requests */
+    QVector< QPointer<SynoRequest> > batchQueue;
+    /*! Requests sent as parts of compound requests */
+    QSet< SynoRequest* > batchedRequests;
+    /*! Timer flushing batch queue on next event loop iteration */
+    QTimer batchTimer;
+    /*! Maximum amount of requests in compound request */
+    int batchMaxSize;
+    /*! Set of active request handles */
+    QSet< SynoRequestHandle* > pendingHandles;
+    /*! Pool of free request handles, guarded by handlePoolMutex */
+    std::vector<SynoRequestHandle*> handlePool;
+    QMutex handlePoolMutex;
+    /*! Held while a handle callback is invoked, other threads wait on it for the callback to return */
+    QMutex dispatchMutex;
+    /*! Maximum amount of free handles kept in the pool */
+    int handlePoolMaxSize;
+    /*! Source of handle generation numbers */
+    std::atomic<quint64> handleGeneration{0};
+    /*! Amount of handles acquired and allocated */
+    std::atomic<quint64> handleAcquireCount{0};
+    std::atomic<quint64> handleAllocCount{0};
+    /*! Time since last request which is not a background one */
+    QElapsedTimer foregroundTimer;
 };
 
 #endif // SYNOCONN_P_H
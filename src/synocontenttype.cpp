@@ -0,0 +1,96 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synocontenttype.h"
+
+#include <QImageReader>
+#include <QMimeDatabase>
+
+SynoContentTypeClassifier& SynoContentTypeClassifier::instance()
+{
+    static SynoContentTypeClassifier i;
+    return i;
+}
+
+SynoContentTypeClassifier::SynoContentTypeClassifier()
+{
+    const QByteArray utf8Encoding(QByteArrayLiteral("utf-8"));
+    m_infos.insert(QByteArrayLiteral("image/jpeg"), SynoContentTypeInfo{SynoRequest::IMAGE_JPEG, QByteArray(), QByteArrayLiteral("jpg")});
+    // "image" is not a MIME type, so only JPEG images are classified, the others are decoded by format
+    m_infos.insert(QByteArrayLiteral("image/png"), SynoContentTypeInfo{SynoRequest::UNKNOWN, QByteArray(), QByteArrayLiteral("png")});
+    m_infos.insert(QByteArrayLiteral("text/plain"), SynoContentTypeInfo{SynoRequest::TEXT, QByteArray(), QByteArray()});
+    m_infos.insert(QByteArrayLiteral("text/plain; charset=utf-8"), SynoContentTypeInfo{SynoRequest::TEXT, utf8Encoding, QByteArray()});
+    m_infos.insert(QByteArrayLiteral("text/plain; charset=UTF-8"), SynoContentTypeInfo{SynoRequest::TEXT, QByteArrayLiteral("UTF-8"), QByteArray()});
+}
+
+SynoContentTypeInfo SynoContentTypeClassifier::classify(const QByteArray& contentTypeRaw)
+{
+    {
+        QReadLocker locker(&m_lock);
+        auto iter = m_infos.constFind(contentTypeRaw);
+        if (iter != m_infos.constEnd()) {
+            return iter.value();
+        }
+    }
+
+    SynoContentTypeInfo info = resolve(contentTypeRaw);
+
+    QWriteLocker locker(&m_lock);
+    // protection against unbounded growth on malformed headers
+    if (m_infos.size() < 64) {
+        m_infos.insert(contentTypeRaw, info);
+    }
+
+    return info;
+}
+
+SynoContentTypeInfo SynoContentTypeClassifier::resolve(const QByteArray& contentTypeRaw)
+{
+    SynoContentTypeInfo info;
+
+    QList<QByteArray> contentTypeList(contentTypeRaw.split(';'));
+    QByteArray contentType = contentTypeList.value(0).trimmed();
+
+    if (contentTypeList.size() > 1) {
+        QByteArray contentEncoding = contentTypeList[1].trimmed();
+        QByteArray charsetPrefix(QByteArrayLiteral("charset="));
+        if (contentEncoding.startsWith(charsetPrefix)) {
+            info.encoding = contentEncoding.mid(charsetPrefix.size());
+        }
+    }
+
+    QMimeDatabase mimeDb;
+    QMimeType mimeType = mimeDb.mimeTypeForName(QString::fromLatin1(contentType));
+    if (mimeType.inherits(QStringLiteral("text/plain"))) {
+        info.type = SynoRequest::TEXT;
+    } else if (mimeType.inherits(QStringLiteral("image/jpeg"))) {
+        info.type = SynoRequest::IMAGE_JPEG;
+        info.imageFormat = QByteArrayLiteral("jpg");
+    } else if (mimeType.inherits(QStringLiteral("image"))) {
+        info.type = SynoRequest::IMAGE_OTHER;
+    }
+
+    if (info.type != SynoRequest::TEXT && info.imageFormat.isEmpty()) {
+        QList<QByteArray> imageFormats = QImageReader::imageFormatsForMimeType(contentType);
+        if (!imageFormats.isEmpty()) {
+            info.imageFormat = imageFormats.first();
+        }
+    }
+
+    return info;
+}
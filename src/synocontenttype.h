@@ -0,0 +1,65 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNOCONTENTTYPE_H
+#define SYNOCONTENTTYPE_H
+
+#include "synorequest.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QReadWriteLock>
+
+/*! Classification of a reply content type */
+struct SynoContentTypeInfo
+{
+    SynoRequest::ContentType type = SynoRequest::UNKNOWN;
+    /*! Charset of text content */
+    QByteArray encoding;
+    /*! Image format suitable for QImageReader */
+    QByteArray imageFormat;
+};
+
+/*!
+ * \brief Interned classification of raw Content-Type header values
+ *
+ * The service replies with a handful of distinct values, so each of them
+ * is resolved with MIME database once and then found with one hash lookup.
+ *
+ * This class is thread-safe.
+ */
+class SynoContentTypeClassifier
+{
+    Q_DISABLE_COPY(SynoContentTypeClassifier)
+
+public:
+    static SynoContentTypeClassifier& instance();
+
+    SynoContentTypeInfo classify(const QByteArray& contentTypeRaw);
+
+private:
+    SynoContentTypeClassifier();
+
+    static SynoContentTypeInfo resolve(const QByteArray& contentTypeRaw);
+
+private:
+    QReadWriteLock m_lock;
+    QHash<QByteArray, SynoContentTypeInfo> m_infos;
+};
+
+#endif // SYNOCONTENTTYPE_H
@@ -34,6 +34,9 @@ SynoImageCacheValue SynoImageCache::object(const QString& url, const QByteArray&
 {
     SynoImageCacheKey key{url, sizeId};
     SynoImageCacheValue value = m_cache.object(key);
+    if (value.imageData.isEmpty()) {
+        value = m_pinned.value(key);
+    }
 
     if (!value.imageData.isEmpty()) {
         ++m_hitCount;
@@ -48,17 +51,74 @@ void SynoImageCache::insert(const QString& url, const QByteArray& sizeId, const
 {
     SynoImageCacheKey key{url, sizeId};
     m_cache.insert(key, image, image.imageData.size() + image.imageFormat.size());
+
+    if (m_pinnedKeys.contains(key)) {
+        m_pinned.insert(key, image);
+    }
 }
 
 void SynoImageCache::remove(const QString& url, const QByteArray& sizeId)
 {
     SynoImageCacheKey key{url, sizeId};
     m_cache.remove(key);
+    m_pinned.remove(key);
 }
 
 void SynoImageCache::clear()
 {
     m_cache.clear();
+    m_pinned.clear();
+}
+
+bool SynoImageCache::contains(const QString& url, const QByteArray& sizeId) const
+{
+    SynoImageCacheKey key{url, sizeId};
+    return m_cache.contains(key) || m_pinned.contains(key);
+}
+
+SynoImageCacheValue SynoImageCache::peek(const QString& url, const QByteArray& sizeId) const
+{
+    SynoImageCacheKey key{url, sizeId};
+    SynoImageCacheValue value = m_cache.peek(key);
+    if (value.imageData.isEmpty()) {
+        value = m_pinned.value(key);
+    }
+    return value;
+}
+
+void SynoImageCache::setPinned(const QSet<QString>& urls, const QByteArray& sizeId)
+{
+    QSet<SynoImageCacheKey> pinnedKeys;
+    pinnedKeys.reserve(urls.size());
+    for (const QString& url : urls) {
+        pinnedKeys.insert(SynoImageCacheKey{url, sizeId});
+    }
+
+    // images of other sizes remain pinned
+    for (auto iter = m_pinnedKeys.cbegin(); iter != m_pinnedKeys.cend(); ++iter) {
+        if (iter->synoSize != sizeId) {
+            pinnedKeys.insert(*iter);
+        }
+    }
+
+    for (auto iter = m_pinned.begin(); iter != m_pinned.end(); ) {
+        if (!pinnedKeys.contains(iter.key())) {
+            iter = m_pinned.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+
+    for (const SynoImageCacheKey& key : std::as_const(pinnedKeys)) {
+        if (!m_pinned.contains(key)) {
+            SynoImageCacheValue value = m_cache.peek(key);
+            if (!value.imageData.isEmpty()) {
+                m_pinned.insert(key, value);
+            }
+        }
+    }
+
+    std::swap(pinnedKeys, m_pinnedKeys);
 }
 
 SynoImageCache::CacheType::size_type SynoImageCache::count() const
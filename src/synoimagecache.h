@@ -21,7 +21,9 @@
 
 #include "cache.h"
 
+#include <QHash>
 #include <QImage>
+#include <QSet>
 #include <QString>
 #include <QSize>
 
@@ -58,6 +60,22 @@ public:
     void remove(const QString& url, const QByteArray& sizeId);
     void clear();
 
+    /*! Returns true if the image is in cache. Unlike object() it does not affect hit counters */
+    bool contains(const QString& url, const QByteArray& sizeId) const;
+    /*! Returns the image, or empty value. Unlike object() it does not affect hit counters nor usage order */
+    SynoImageCacheValue peek(const QString& url, const QByteArray& sizeId) const;
+
+    /*!
+     * \brief Keeps the images in memory regardless of cache limits
+     *
+     * Images which are not cached yet are kept once inserted. Images pinned before
+     * and missing in the list are unpinned, and are evicted as usual.
+     *
+     * \param urls Urls of the images
+     * \param sizeId Size of the images
+     */
+    void setPinned(const QSet<QString>& urls, const QByteArray& sizeId);
+
     /*! Returns amount of images in cache */
     CacheType::size_type count() const;
     /*! Returns amount of used memory by images in cache in bytes */
@@ -69,6 +87,10 @@ public:
 
 private:
     CacheType m_cache;
+    /*! Keys of pinned images */
+    QSet<SynoImageCacheKey> m_pinnedKeys;
+    /*! Pinned images, the data is shared with the cache while they are in it */
+    QHash<SynoImageCacheKey, SynoImageCacheValue> m_pinned;
     quint64 m_missCount;
     quint64 m_hitCount;
 };
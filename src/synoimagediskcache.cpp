@@ -0,0 +1,142 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synoimagediskcache.h"
+#include "synosettings.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDirIterator>
+#include <QFile>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QVector>
+
+#include <algorithm>
+
+static inline QString hashedName(const QByteArray& data)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex());
+}
+
+SynoImageDiskCache::SynoImageDiskCache()
+{
+    m_rootDir.setPath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    m_rootDir.mkpath(QStringLiteral("thumbs"));
+    m_rootDir.cd(QStringLiteral("thumbs"));
+
+    SynoSettings settings(QStringLiteral("performance"));
+    qint64 maximumSizeMb = qBound(0, settings.value(QStringLiteral("diskImageCacheMb"), 500).toInt(), std::numeric_limits<int>::max());
+
+    trim(maximumSizeMb * 1024 * 1024);
+}
+
+void SynoImageDiskCache::setScope(const QByteArray& scope)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_scopeDirPath = m_rootDir.absoluteFilePath(hashedName(scope));
+    m_rootDir.mkpath(m_scopeDirPath);
+}
+
+SynoImageCacheValue SynoImageDiskCache::object(const QString& id, const QByteArray& sizeId) const
+{
+    QFile file(filePath(id, sizeId));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return SynoImageCacheValue();
+    }
+
+    // the file contains image format on the first line, and image data after
+    QByteArray imageFormat = file.readLine().trimmed();
+    QByteArray imageData = file.readAll();
+    if (imageFormat.isEmpty() || imageData.isEmpty()) {
+        return SynoImageCacheValue();
+    }
+
+    return SynoImageCacheValue{imageFormat, imageData};
+}
+
+void SynoImageDiskCache::insert(const QString& id, const QByteArray& sizeId, const SynoImageCacheValue& image)
+{
+    QString path = filePath(id, sizeId);
+    if (path.isEmpty()) {
+        return;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)
+        || file.write(image.imageFormat + '\n') < 0
+        || file.write(image.imageData) != image.imageData.size()
+        || !file.commit()) {
+        qWarning() << __FUNCTION__ << QObject::tr("Cannot write image cache file: %1. %2")
+                      .arg(path).arg(file.errorString());
+    }
+}
+
+void SynoImageDiskCache::remove(const QString& id, const QByteArray& sizeId)
+{
+    QString path = filePath(id, sizeId);
+    if (!path.isEmpty()) {
+        QFile::remove(path);
+    }
+}
+
+QString SynoImageDiskCache::filePath(const QString& id, const QByteArray& sizeId) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_scopeDirPath.isEmpty()) {
+        return QString();
+    }
+
+    return m_scopeDirPath + '/' + hashedName(id.toUtf8()) + '.' + QString::fromLatin1(sizeId);
+}
+
+void SynoImageDiskCache::trim(qint64 maxSize)
+{
+    QVector<QFileInfo> files;
+    qint64 totalSize = 0;
+
+    QDirIterator iter(m_rootDir.absolutePath(), QDir::Files, QDirIterator::Subdirectories);
+    while (iter.hasNext()) {
+        iter.next();
+        totalSize += iter.fileInfo().size();
+        files.append(iter.fileInfo());
+    }
+
+    if (totalSize <= maxSize) {
+        return;
+    }
+
+    // remove least recently modified images first
+    std::sort(files.begin(), files.end(), [](const QFileInfo& a, const QFileInfo& b) {
+        return a.lastModified() < b.lastModified();
+    });
+
+    for (const QFileInfo& info : std::as_const(files)) {
+        if (totalSize <= maxSize) {
+            break;
+        }
+
+        if (QFile::remove(info.absoluteFilePath())) {
+            totalSize -= info.size();
+        }
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNOIMAGEDISKCACHE_H
+#define SYNOIMAGEDISKCACHE_H
+
+#include "synoimagecache.h"
+
+#include <QDir>
+#include <QMutex>
+
+/*!
+ * \brief Persistent storage of image thumbnails
+ *
+ * Entries are scoped by the value set with setScope(), e.g. service URL and user name.
+ *
+ * This class is thread-safe.
+ */
+class SynoImageDiskCache
+{
+    Q_DISABLE_COPY(SynoImageDiskCache)
+
+public:
+    SynoImageDiskCache();
+
+    void setScope(const QByteArray& scope);
+
+    SynoImageCacheValue object(const QString& id, const QByteArray& sizeId) const;
+    void insert(const QString& id, const QByteArray& sizeId, const SynoImageCacheValue& image);
+    void remove(const QString& id, const QByteArray& sizeId);
+
+private:
+    QString filePath(const QString& id, const QByteArray& sizeId) const;
+    void trim(qint64 maxSize);
+
+private:
+    mutable QMutex m_mutex;
+    QDir m_rootDir;
+    QString m_scopeDirPath;
+};
+
+#endif // SYNOIMAGEDISKCACHE_H
@@ -19,9 +19,11 @@
 #include "synoimageprovider.h"
 #include "synoimageprovider_p.h"
 #include "colorhandler.h"
+#include "synoauth.h"
 #include "synoconn.h"
 #include "synops.h"
 #include "synoreplyjson.h"
+#include "synosettings.h"
 #include "synosize.h"
 
 #include <QBuffer>
@@ -35,6 +37,11 @@
 static QByteArray g_synoSizeSmall = QByteArrayLiteral("small");
 static QByteArray g_synoSizeLarge = QByteArrayLiteral("large");
 
+// maximum amount of thumbnails waiting to be warmed up
+static constexpr int g_maxWarmUpQueue = 256;
+
+static SynoImageProvider* g_instance = nullptr;
+
 
 SynoImageProvider::SynoImageProvider(SynoConn* conn)
     : QObject(*(new SynoImageProviderPrivate()), nullptr)
@@ -48,9 +55,26 @@ SynoImageProvider::SynoImageProvider(SynoConn* conn)
 
     d->conn = conn;
 
+    auto updateConnState = [this]() {
+        Q_D(SynoImageProvider);
+        d->isOffline = (d->conn->status() == SynoConn::OFFLINE);
+        d->imageDiskCache.setScope(d->conn->synoUrl().toEncoded() + '\n' + d->conn->auth()->username().toUtf8());
+    };
+
+    connect(conn, &SynoConn::statusChanged, this, updateConnState);
+    connect(conn->auth(), &SynoAuth::usernameChanged, this, updateConnState);
+    updateConnState();
+
     d->threadWorker.setObjectName(QStringLiteral("SynoImageProviderThread"));
     d->threadWorker.start();
 
+    SynoSettings settings(QStringLiteral("performance"));
+    d->maxWarmUpRequests = qBound(0, settings.value(QStringLiteral("thumbWarmUpRequests"), 2).toInt(), 16);
+    d->warmUpPool.setMaxThreadCount(1);
+
+    Q_ASSERT(!g_instance);
+    g_instance = this;
+
     QTimer* cacheStatisticTimer = new QTimer(this);
     connect(cacheStatisticTimer, &QTimer::timeout, this, [this]() {
         SynoImageProviderPrivate::CacheLocker cacheLocker(d_func());
@@ -58,6 +82,10 @@ SynoImageProvider::SynoImageProvider(SynoConn* conn)
         qDebug() << tr("Image cache statistics. Count: %1. Cost (KB): %2. Hit: %3. Miss: %4.")
                     .arg(cache.count()).arg(cache.totalCost() / 1024)
                     .arg(cache.hitCount()).arg(cache.missCount());
+
+        QPair<quint64, quint64> handleStats = d_func()->conn->requestHandleStatistics();
+        qDebug() << tr("Request handle statistics. Acquired: %1. Allocated: %2.")
+                    .arg(handleStats.first).arg(handleStats.second);
     });
     cacheStatisticTimer->start(60000);
 }
@@ -66,10 +94,25 @@ SynoImageProvider::~SynoImageProvider()
 {
     Q_D(SynoImageProvider);
 
+    g_instance = nullptr;
+
+    // callbacks are never invoked after the handles are released
+    d->warmUpQueue.clear();
+    for (SynoRequestHandle* handle : std::as_const(d->warmUpHandles)) {
+        d->conn->releaseRequestHandle(handle);
+    }
+    d->warmUpHandles.clear();
+    d->warmUpPool.waitForDone();
+
     d->threadWorker.quit();
     d->threadWorker.wait();
 }
 
+SynoImageProvider* SynoImageProvider::instance()
+{
+    return g_instance;
+}
+
 void SynoImageProvider::invalidateInCache(const QString& id)
 {
     Q_D(SynoImageProvider);
@@ -77,6 +120,116 @@ void SynoImageProvider::invalidateInCache(const QString& id)
     SynoImageProviderPrivate::CacheLocker cacheLocker(d);
     cacheLocker.cache().remove(id, g_synoSizeSmall);
     cacheLocker.cache().remove(id, g_synoSizeLarge);
+    d->imageDiskCache.remove(id, g_synoSizeSmall);
+    d->imageDiskCache.remove(id, g_synoSizeLarge);
+}
+
+void SynoImageProvider::warmUp(const QByteArray& id)
+{
+    Q_D(SynoImageProvider);
+
+    Q_ASSERT(QThread::currentThread() == thread());
+
+    if (d->isOffline || d->maxWarmUpRequests == 0 || d->warmUpHandles.contains(id) || d->warmUpQueue.contains(id)) {
+        return;
+    }
+
+    {
+        SynoImageProviderPrivate::CacheLocker cacheLocker(d);
+        if (cacheLocker.cache().contains(QString::fromLatin1(id), g_synoSizeSmall)) {
+            return;
+        }
+    }
+
+    // the latest requests are closer to what the user is going to see
+    if (d->warmUpQueue.size() >= g_maxWarmUpQueue) {
+        d->warmUpQueue.dequeue();
+    }
+    d->warmUpQueue.enqueue(id);
+    d->sendWarmUpRequests();
+}
+
+void SynoImageProvider::pinThumbnails(const QSet<QString>& ids)
+{
+    Q_D(SynoImageProvider);
+
+    SynoImageProviderPrivate::CacheLocker cacheLocker(d);
+    cacheLocker.cache().setPinned(ids, g_synoSizeSmall);
+}
+
+SynoImageCacheValue SynoImageProvider::cachedThumbnail(const QString& id)
+{
+    Q_D(SynoImageProvider);
+
+    SynoImageProviderPrivate::CacheLocker cacheLocker(d);
+    return cacheLocker.cache().peek(id, g_synoSizeSmall);
+}
+
+void SynoImageProvider::insertThumbnail(const QString& id, const SynoImageCacheValue& image)
+{
+    Q_D(SynoImageProvider);
+
+    SynoImageProviderPrivate::CacheLocker cacheLocker(d);
+    cacheLocker.cache().insert(id, g_synoSizeSmall, image);
+}
+
+void SynoImageProviderPrivate::sendWarmUpRequests()
+{
+    Q_Q(SynoImageProvider);
+
+    if (isOffline) {
+        warmUpQueue.clear();
+        return;
+    }
+
+    while (!warmUpQueue.isEmpty() && warmUpHandles.size() < maxWarmUpRequests) {
+        const QByteArray id = warmUpQueue.dequeue();
+
+        SynoRequestHandle* handle = conn->acquireRequestHandle(QByteArrayLiteral("SYNO.PhotoStation.Thumb"));
+        handle->setIsBackground(true);
+
+        QByteArrayList& formData = handle->formData();
+        formData << QByteArrayLiteral("method=get");
+        formData << QByteArrayLiteral("version=1");
+        formData << QByteArrayLiteral("size=") + g_synoSizeSmall;
+        formData << QByteArrayLiteral("id=") + id;
+
+        handle->setCallback([q, id](SynoRequestHandle*) {
+            // the callback is invoked in connection thread, and is never invoked after the handle is released
+            QMetaObject::invokeMethod(q, [q, id]() {
+                q->d_func()->onWarmUpFinished(id);
+            }, Qt::QueuedConnection);
+        });
+
+        warmUpHandles.insert(id, handle);
+        conn->sendRequestHandle(handle);
+    }
+}
+
+void SynoImageProviderPrivate::onWarmUpFinished(const QByteArray& id)
+{
+    SynoRequestHandle* handle = warmUpHandles.take(id);
+    if (!handle) {
+        return;
+    }
+
+    QtConcurrent::run(&warmUpPool, [this, handle, id]() {
+        // the image is decoded when displayed, its format is resolved on reply content type classification
+        if (handle->errorString().isEmpty() && !handle->contentImageFormat().isEmpty()) {
+            SynoImageCacheValue imageCacheVal{handle->contentImageFormat(), handle->replyBody()};
+            const QString key = QString::fromLatin1(id);
+            {
+                CacheLocker cacheLocker(this);
+                cacheLocker.cache().insert(key, g_synoSizeSmall, imageCacheVal);
+            }
+
+            imageDiskCache.insert(key, g_synoSizeSmall, imageCacheVal);
+        }
+
+        conn->releaseRequestHandle(handle);
+    });
+
+    sendWarmUpRequests();
 }
 
 QQuickImageResponse* SynoImageProvider::requestImageResponse(const QString& id,
@@ -108,6 +261,11 @@ SynoImageResponse::SynoImageResponse(SynoImageProvider* provider,
 {
 }
 
+SynoImageResponse::~SynoImageResponse()
+{
+    releaseRequest();
+}
+
 void SynoImageResponse::load()
 {
     Q_ASSERT(QThread::currentThread() == &m_provider->d_func()->threadWorker);
@@ -138,46 +296,73 @@ void SynoImageResponse::sendRequest()
 {
     Q_ASSERT(QThread::currentThread() == &m_provider->d_func()->threadWorker);
 
-    QByteArrayList formData;
+    SynoConn* conn = m_provider->d_func()->conn;
+
+    Q_ASSERT(!m_req);
+    m_req = conn->acquireRequestHandle(QByteArrayLiteral("SYNO.PhotoStation.Thumb"));
+
+    QByteArrayList& formData = m_req->formData();
     formData << QByteArrayLiteral("method=get");
     formData << QByteArrayLiteral("version=1");
     formData << QByteArrayLiteral("size=") + m_synoSize;
     formData << QByteArrayLiteral("id=") + m_id;
 
-    Q_ASSERT(!m_req);
-    m_req = m_provider->d_func()->conn->createRequest(QByteArrayLiteral("SYNO.PhotoStation.Thumb"), formData);
-    m_req->send(this, [this] {
-        Q_ASSERT(QThread::currentThread() == &m_provider->d_func()->threadWorker);
+    m_req->setCallback([this](SynoRequestHandle*) {
+        // the callback is invoked in connection thread, and is never invoked after the handle is released
+        QMetaObject::invokeMethod(this, [this]() {
+            onRequestFinished();
+        }, Qt::QueuedConnection);
+    });
 
-        CancelStatus cancel(Status_Cancelled);
-        if (!m_cancelStatus.compare_exchange_strong(cancel, Status_CancelledConfirmed)) {
+    conn->sendRequestHandle(m_req);
+}
 
-            if (!m_req->errorString().isEmpty()) {
-                setErrorString(tr("Network error: %1.").arg(m_req->errorString()));
-            } else {
-                if (m_req->contentType() == SynoRequest::TEXT) {
-                    // some syno error happened
-                    SynoReplyJSON replyJSON(m_req.get());
-                    if (!replyJSON.errorString().isEmpty()) {
-                        setErrorString(tr("Syno error: %1.").arg(replyJSON.errorString()));
-                    } else {
-                        setErrorString(tr("Unknown Syno error."));
-                    }
+void SynoImageResponse::releaseRequest()
+{
+    if (m_req) {
+        m_provider->d_func()->conn->releaseRequestHandle(m_req);
+        m_req = nullptr;
+    }
+}
+
+void SynoImageResponse::onRequestFinished()
+{
+    if (!m_req) {
+        // released on cancellation, the response is finished already
+        return;
+    }
+
+    CancelStatus cancel(Status_Cancelled);
+    if (!m_cancelStatus.compare_exchange_strong(cancel, Status_CancelledConfirmed)) {
+
+        if (!m_req->errorString().isEmpty()) {
+            setErrorString(tr("Network error: %1.").arg(m_req->errorString()));
+        } else {
+            if (m_req->contentType() == SynoRequest::TEXT) {
+                // some syno error happened
+                SynoReplyJSON replyJSON(m_req->replyBody());
+                if (!replyJSON.errorString().isEmpty()) {
+                    setErrorString(tr("Syno error: %1.").arg(replyJSON.errorString()));
                 } else {
-                    m_future = QtConcurrent::run([this]() {
-                        processNetworkRequest();
-                        postProcessImage();
-                        QMetaObject::invokeMethod(this, [this]() {
-                            emitFinished();
-                        }, Qt::QueuedConnection);
-                    });
-                    return;
+                    setErrorString(tr("Unknown Syno error."));
                 }
+            } else {
+                m_future = QtConcurrent::run([this]() {
+                    processNetworkRequest();
+                    postProcessImage();
+                    QMetaObject::invokeMethod(this, [this]() {
+                        // the reply body is decoded, the handle could be reused
+                        releaseRequest();
+                        emitFinished();
+                    }, Qt::QueuedConnection);
+                });
+                return;
             }
         }
+    }
 
-        emitFinished();
-    });
+    releaseRequest();
+    emitFinished();
 }
 
 QQuickTextureFactory* SynoImageResponse::textureFactory() const
@@ -194,17 +379,14 @@ void SynoImageResponse::cancel()
 {
     CancelStatus cancel(Status_NotCancelled);
     if (m_cancelStatus.compare_exchange_strong(cancel, Status_Cancelled)) {
-        if (m_req) {
-            m_req->cancel();
-
-            QMetaObject::invokeMethod(this, [this]() {
-                Q_ASSERT(QThread::currentThread() == &m_provider->d_func()->threadWorker);
-                // it is safe to check here, as this code runs in object's thread
-                if (!m_future.isRunning()) {
-                    emitFinished();
-                }
-            }, Qt::QueuedConnection);
-        }
+        QMetaObject::invokeMethod(this, [this]() {
+            // the request is in flight, or its reply is not processed yet
+            // it is safe to check here, as this code runs in object's thread
+            if (m_req && !m_future.isRunning()) {
+                releaseRequest();
+                emitFinished();
+            }
+        }, Qt::QueuedConnection);
     }
 }
 
@@ -230,9 +412,30 @@ void SynoImageResponse::emitFinished()
 
 bool SynoImageResponse::loadFromCache()
 {
-    SynoImageProviderPrivate::CacheLocker cacheLocker(m_provider->d_func());
-    SynoImageCacheValue imageCacheVal = cacheLocker.cache().object(m_id, m_synoSize);
+    SynoImageProviderPrivate* d = m_provider->d_func();
+
+    SynoImageCacheValue imageCacheVal;
+    {
+        SynoImageProviderPrivate::CacheLocker cacheLocker(d);
+        imageCacheVal = cacheLocker.cache().object(m_id, m_synoSize);
+    }
 
+    if (imageCacheVal.imageData.isEmpty() && d->isOffline) {
+        imageCacheVal = d->imageDiskCache.object(m_id, m_synoSize);
+        if (decodeImage(imageCacheVal)) {
+            SynoImageProviderPrivate::CacheLocker cacheLocker(d);
+            cacheLocker.cache().insert(m_id, m_synoSize, imageCacheVal);
+            return true;
+        }
+
+        return false;
+    }
+
+    return decodeImage(imageCacheVal);
+}
+
+bool SynoImageResponse::decodeImage(const SynoImageCacheValue& imageCacheVal)
+{
     if (!imageCacheVal.imageData.isEmpty()) {
         QByteArray data(imageCacheVal.imageData);
         QBuffer buffer(&data);
@@ -251,17 +454,8 @@ void SynoImageResponse::processNetworkRequest()
 {
     Q_ASSERT(m_req);
 
-    // assume JPEG as the most widely used format
-    QByteArray imageFormat(QByteArrayLiteral("JPG"));
-    if (m_req->contentType() != SynoRequest::IMAGE_JPEG) {
-        QList<QByteArray> imageFormatsForMimeType = QImageReader::imageFormatsForMimeType(m_req->contentMimeTypeRaw());
-        if (imageFormatsForMimeType.size() > 0) {
-            imageFormat = imageFormatsForMimeType[0];
-        } else {
-            // unknown mime type
-            imageFormat = QByteArray();
-        }
-    }
+    // image format is resolved on reply content type classification
+    QByteArray imageFormat(m_req->contentImageFormat());
 
     QByteArray data(m_req->replyBody());
     QBuffer buffer(&data);
@@ -270,8 +464,13 @@ void SynoImageResponse::processNetworkRequest()
 
     if (reader.read(&m_image) && !m_image.isNull()) {
         // save to cache
-        SynoImageProviderPrivate::CacheLocker cacheLocker(m_provider->d_func());
-        cacheLocker.cache().insert(m_id, m_synoSize, SynoImageCacheValue{imageFormat, data});
+        SynoImageCacheValue imageCacheVal{imageFormat, data};
+        {
+            SynoImageProviderPrivate::CacheLocker cacheLocker(m_provider->d_func());
+            cacheLocker.cache().insert(m_id, m_synoSize, imageCacheVal);
+        }
+
+        m_provider->d_func()->imageDiskCache.insert(m_id, m_synoSize, imageCacheVal);
     } else {
         QString readerError = reader.errorString();
         if (!readerError.isEmpty()) {
@@ -314,10 +513,13 @@ void SynoImageResponse::onCacheCheckFinished(bool success)
         emitFinished();
     } else {
         CancelStatus cancel(Status_Cancelled);
-        if (!m_cancelStatus.compare_exchange_strong(cancel, Status_CancelledConfirmed)) {
-            sendRequest();
-        } else {
+        if (m_cancelStatus.compare_exchange_strong(cancel, Status_CancelledConfirmed)) {
             emitFinished();
+        } else if (m_provider->d_func()->isOffline) {
+            setErrorString(tr("Image is not cached for offline mode."));
+            emitFinished();
+        } else {
+            sendRequest();
         }
     }
 }
@@ -20,8 +20,10 @@
 #define SYNOIMAGEPROVIDER_H
 
 #include <QQuickAsyncImageProvider>
+#include <QSet>
+
+#include "synoimagecache.h"
 
-class SynoImageCache;
 class SynoConn;
 class SynoImageProviderPrivate;
 
@@ -42,9 +44,35 @@ public:
     SynoImageProvider(SynoConn* conn);
     ~SynoImageProvider();
 
+    /*! Returns the provider registered in QML engine, or nullptr */
+    static SynoImageProvider* instance();
+
     /*! Invalidates cached image by id */
     Q_INVOKABLE void invalidateInCache(const QString& id);
 
+    /*!
+     * \brief Loads small thumbnail of the image into cache ahead of the views
+     *
+     * The thumbnail is requested in background, after the images requested by the views.
+     * Requests above the configured limit are queued, the oldest queued ones are dropped.
+     * Nothing is requested in offline mode.
+     *
+     * \param id Id of the image
+     */
+    void warmUp(const QByteArray& id);
+
+    /*!
+     * \brief Keeps small thumbnails of the images in memory, e.g. the ones to be displayed on back navigation
+     *
+     * \param ids Ids of the images, thumbnails pinned before and missing in the list are unpinned
+     */
+    void pinThumbnails(const QSet<QString>& ids);
+
+    /*! Returns small thumbnail of the image from memory cache, or empty value */
+    SynoImageCacheValue cachedThumbnail(const QString& id);
+    /*! Puts small thumbnail of the image into memory cache, e.g. the one persisted by a session snapshot */
+    void insertThumbnail(const QString& id, const SynoImageCacheValue& image);
+
     // ImageProvider API
     QQuickImageResponse* requestImageResponse(const QString &id,
                                               const QSize &requestedSize,
@@ -21,14 +21,18 @@
 #define SYNOIMAGEPROVIDER_P_H
 
 #include "synoimagecache.h"
+#include "synoimagediskcache.h"
 #include "synoimageprovider.h"
-#include "synorequest.h"
+#include "synorequesthandle.h"
 
 #include <QtConcurrent>
 #include <QColorSpace>
+#include <QHash>
 #include <QMutex>
+#include <QQueue>
 #include <QQuickImageResponse>
 #include <QThread>
+#include <QThreadPool>
 
 #include <QtCore/private/qobject_p.h>
 
@@ -36,9 +40,14 @@
 
 class SynoImageProviderPrivate : public QObjectPrivate
 {
+    Q_DECLARE_PUBLIC(SynoImageProvider)
+
 public:
     class CacheLocker;
 
+    void sendWarmUpRequests();
+    void onWarmUpFinished(const QByteArray& id);
+
 public:
     SynoImageProviderPrivate()
         : QObjectPrivate() {}
@@ -49,8 +58,20 @@ public:
     // NOTE: SynoImageCache is not thread-safe
     QMutex imageCacheMutex;
     SynoImageCache imageCache;
+    SynoImageDiskCache imageDiskCache;
+    /*! Connection is in offline mode, images are loaded from disk cache only */
+    std::atomic<bool> isOffline{false};
     QThread threadWorker;
     QPointer<QThread> threadRenderer;
+
+    /*! Requests of the thumbnails being warmed up, keyed by image id */
+    QHash<QByteArray, SynoRequestHandle*> warmUpHandles;
+    /*! Ids of the thumbnails waiting to be warmed up */
+    QQueue<QByteArray> warmUpQueue;
+    /*! Maximum amount of warm-up requests in flight */
+    int maxWarmUpRequests = 2;
+    /*! Thread storing warmed up thumbnails into caches */
+    QThreadPool warmUpPool;
 };
 
 class SynoImageResponse : public QQuickImageResponse
@@ -68,6 +89,7 @@ public:
                       const QByteArray& id,
                       const QSize& size,
                       const QQuickImageProviderOptions& options);
+    ~SynoImageResponse();
 
     void load();
 
@@ -82,7 +104,9 @@ protected:
     void setErrorString(const QString& err);
     void emitFinished();
     bool loadFromCache();
+    bool decodeImage(const SynoImageCacheValue& imageCacheVal);
     void sendRequest();
+    void releaseRequest();
     void processNetworkRequest();
     void postProcessImage();
 
@@ -90,6 +114,7 @@ protected:
 
 protected slots:
     void onCacheCheckFinished(bool success);
+    void onRequestFinished();
 
 protected:
     SynoImageProvider* m_provider;
@@ -99,7 +124,8 @@ protected:
     QQuickImageProviderOptions m_options;
     QString m_errorString;
     QImage m_image;
-    std::shared_ptr<SynoRequest> m_req;
+    /*! Pooled request handle, owned until released */
+    SynoRequestHandle* m_req = nullptr;
 
     QFuture<void> m_future;
     std::atomic<CancelStatus> m_cancelStatus;
@@ -0,0 +1,351 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synolibrarycrawler.h"
+#include "synoalbumreplyparser.h"
+#include "synoauth.h"
+#include "synoconn.h"
+#include "synolibraryindex.h"
+#include "synorequest.h"
+#include "synosettings.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
+#include <limits>
+
+static constexpr quint32 g_stateVersion = 1;
+
+// crawl counters of all crawlers
+static SynoLibraryCrawler::Statistics g_statistics;
+
+SynoLibraryCrawler::SynoLibraryCrawler(SynoConn* conn, QObject* parent)
+    : QObject(parent)
+    , m_conn(conn)
+    , m_isOnline(false)
+    , m_generation(0)
+{
+    Q_ASSERT(conn);
+
+    SynoSettings settings(QStringLiteral("performance"));
+    m_isEnabled = settings.value(QStringLiteral("libraryCrawlEnabled"), true).toBool();
+    m_maxAlbumsInFlight = qBound(1, settings.value(QStringLiteral("libraryCrawlConcurrency"), 2).toInt(), 16);
+    m_batchSize = qBound(1, settings.value(QStringLiteral("libraryCrawlBatchSize"), 500).toInt(), 5000);
+    m_idleTimeMs = qBound(0, settings.value(QStringLiteral("libraryCrawlIdleMs"), 3000).toInt(), 600000);
+    m_runIntervalSec = qBound(1, settings.value(QStringLiteral("libraryCrawlIntervalHours"), 24).toInt(), 24 * 365) * 3600LL;
+
+    m_scheduleTimer.setSingleShot(true);
+    connect(&m_scheduleTimer, &QTimer::timeout, this, &SynoLibraryCrawler::schedule);
+
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(5000);
+    connect(&m_saveTimer, &QTimer::timeout, this, &SynoLibraryCrawler::saveState);
+
+    connect(&SynoLibraryIndex::instance(), &SynoLibraryIndex::loaded, this, &SynoLibraryCrawler::onIndexLoaded);
+    connect(m_conn, &SynoConn::statusChanged, this, &SynoLibraryCrawler::onConnStatusChanged);
+    connect(m_conn->auth(), &SynoAuth::statusChanged, this, &SynoLibraryCrawler::onConnStatusChanged);
+}
+
+SynoLibraryCrawler::~SynoLibraryCrawler()
+{
+    stop();
+}
+
+bool SynoLibraryCrawler::isRunning() const
+{
+    return !m_pendingAlbums.isEmpty() || !m_crawls.isEmpty();
+}
+
+SynoLibraryCrawler::Statistics SynoLibraryCrawler::statistics()
+{
+    return g_statistics;
+}
+
+void SynoLibraryCrawler::onConnStatusChanged()
+{
+    const bool isOnline = m_isEnabled
+            && m_conn->status() == SynoConn::API_LOADED
+            && m_conn->auth()->status() == SynoAuth::AUTHORIZED;
+    if (isOnline == m_isOnline) {
+        return;
+    }
+
+    if (!isOnline) {
+        stop();
+        m_isOnline = false;
+        return;
+    }
+
+    m_isOnline = true;
+
+    // the index of another service or user is loaded in background
+    SynoLibraryIndex& index = SynoLibraryIndex::instance();
+    index.open(m_conn);
+    if (index.isLoaded()) {
+        schedule();
+    }
+}
+
+void SynoLibraryCrawler::onIndexLoaded()
+{
+    restoreState();
+    schedule();
+}
+
+void SynoLibraryCrawler::schedule()
+{
+    if (!m_isOnline || !SynoLibraryIndex::instance().isLoaded()) {
+        return;
+    }
+
+    if (!isRunning()) {
+        // the walk is repeated when the index gets outdated
+        const QDateTime now = QDateTime::currentDateTimeUtc();
+        const qint64 sinceLastRun = m_lastRunFinished.isValid() ? m_lastRunFinished.secsTo(now) : m_runIntervalSec;
+        if (sinceLastRun >= 0 && sinceLastRun < m_runIntervalSec) {
+            m_scheduleTimer.start(static_cast<int>(qMin<qint64>((m_runIntervalSec - sinceLastRun) * 1000,
+                                                                std::numeric_limits<int>::max())));
+            return;
+        }
+
+        // root album
+        m_pendingAlbums.append(QByteArray());
+    }
+
+    // the views have precedence, the crawler proceeds once they stop sending requests
+    const qint64 idleTime = m_conn->foregroundIdleTime();
+    if (idleTime < m_idleTimeMs) {
+        m_scheduleTimer.start(static_cast<int>(m_idleTimeMs - idleTime));
+        return;
+    }
+
+    for (auto iter = m_crawls.begin(); iter != m_crawls.end(); ++iter) {
+        if (!iter->isBusy) {
+            sendPage(iter.key());
+        }
+    }
+
+    while (m_crawls.size() < m_maxAlbumsInFlight && !m_pendingAlbums.isEmpty()) {
+        const QByteArray albumId = m_pendingAlbums.takeFirst();
+        m_crawls.insert(albumId, Crawl());
+        sendPage(albumId);
+    }
+}
+
+void SynoLibraryCrawler::stop()
+{
+    ++m_generation;
+    m_scheduleTimer.stop();
+
+    // albums being listed are listed from the beginning next time
+    for (auto iter = m_crawls.begin(); iter != m_crawls.end(); ++iter) {
+        if (iter->request) {
+            iter->request->cancel();
+        }
+        m_pendingAlbums.prepend(iter.key());
+    }
+    m_crawls.clear();
+
+    if (m_isOnline) {
+        m_saveTimer.stop();
+        saveState();
+    }
+}
+
+void SynoLibraryCrawler::sendPage(const QByteArray& albumId)
+{
+    Crawl& crawl = m_crawls[albumId];
+    const quint64 generation = m_generation;
+
+    std::shared_ptr<SynoRequest> req = m_conn->createRequest(QByteArrayLiteral("SYNO.PhotoStation.Album"),
+                                                             listFormData(albumId, crawl.items.size()));
+    req->setIsBackground(true);
+    crawl.request = req;
+    crawl.isBusy = true;
+
+    req->send(this, [this, albumId, generation, req] {
+        if (generation != m_generation) {
+            return;
+        }
+
+        auto iter = m_crawls.find(albumId);
+        if (iter == m_crawls.end() || iter->request != req) {
+            return;
+        }
+        iter->request.reset();
+
+        if (req->errorString().isEmpty()) {
+            processPage(albumId, req->replyBody());
+        } else {
+            qWarning() << __FUNCTION__ << tr("Error during crawling album data. %1").arg(req->errorString());
+            failAlbum(albumId);
+        }
+    });
+}
+
+void SynoLibraryCrawler::processPage(const QByteArray& albumId, const QByteArray& replyBody)
+{
+    const quint64 generation = m_generation;
+
+    // the watcher is released with the crawler, so the result is not delivered to released crawler
+    auto* watcher = new QFutureWatcher< std::shared_ptr<SynoAlbumReplyParser> >(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, albumId, generation]() {
+        std::shared_ptr<SynoAlbumReplyParser> parser = watcher->result();
+        watcher->deleteLater();
+
+        auto iter = m_crawls.find(albumId);
+        if (generation != m_generation || iter == m_crawls.end()) {
+            return;
+        }
+
+        if (!parser->errorString().isEmpty()) {
+            qWarning() << __FUNCTION__ << tr("Error during crawling album data. %1").arg(parser->errorString());
+            failAlbum(albumId);
+            return;
+        }
+
+        const QVector<SynoAlbumData>& items = parser->items();
+        iter->items += items;
+
+        if (items.isEmpty() || iter->items.size() >= parser->total()) {
+            completeAlbum(albumId);
+        } else {
+            iter->isBusy = false;
+            schedule();
+        }
+    });
+
+    watcher->setFuture(QtConcurrent::run([replyBody]() {
+        std::shared_ptr<SynoAlbumReplyParser> parser = std::make_shared<SynoAlbumReplyParser>();
+        parser->parse(replyBody);
+        return parser;
+    }));
+}
+
+void SynoLibraryCrawler::completeAlbum(const QByteArray& albumId)
+{
+    Crawl crawl = m_crawls.take(albumId);
+
+    for (const SynoAlbumData& item : std::as_const(crawl.items)) {
+        if (item.type() == QLatin1String("album")) {
+            m_pendingAlbums.append(item.id.toUtf8());
+        }
+    }
+
+    ++g_statistics.albums;
+    g_statistics.items += static_cast<quint64>(crawl.items.size());
+
+    SynoLibraryIndex::instance().setAlbumItems(albumId, crawl.items);
+
+    if (!isRunning()) {
+        finishRun();
+    } else {
+        if (!m_saveTimer.isActive()) {
+            m_saveTimer.start();
+        }
+        schedule();
+    }
+}
+
+void SynoLibraryCrawler::failAlbum(const QByteArray& albumId)
+{
+    // the album is retried in the next walk, its indexed content is kept meanwhile
+    m_crawls.remove(albumId);
+    ++g_statistics.failed;
+
+    if (!isRunning()) {
+        finishRun();
+    } else {
+        schedule();
+    }
+}
+
+void SynoLibraryCrawler::finishRun()
+{
+    m_lastRunFinished = QDateTime::currentDateTimeUtc();
+    m_saveTimer.stop();
+    saveState();
+
+    qDebug() << tr("Library crawl is completed. Albums: %1. Items: %2.")
+                .arg(SynoLibraryIndex::instance().albumCount())
+                .arg(SynoLibraryIndex::instance().itemCount());
+
+    schedule();
+}
+
+void SynoLibraryCrawler::restoreState()
+{
+    ++m_generation;
+    m_scheduleTimer.stop();
+    for (const Crawl& crawl : std::as_const(m_crawls)) {
+        if (crawl.request) {
+            crawl.request->cancel();
+        }
+    }
+    m_crawls.clear();
+    m_pendingAlbums.clear();
+    m_lastRunFinished = QDateTime();
+
+    QDataStream stream(SynoLibraryIndex::instance().crawlState());
+    stream.setVersion(QDataStream::Qt_5_15);
+
+    quint32 version = 0;
+    stream >> version;
+    if (version != g_stateVersion) {
+        return;
+    }
+
+    QDateTime lastRunFinished;
+    QByteArrayList pendingAlbums;
+    stream >> lastRunFinished >> pendingAlbums;
+    if (stream.status() == QDataStream::Ok) {
+        m_lastRunFinished = lastRunFinished;
+        m_pendingAlbums = pendingAlbums;
+    }
+}
+
+void SynoLibraryCrawler::saveState()
+{
+    // the index of another scope could be being loaded
+    if (!SynoLibraryIndex::instance().isLoaded()) {
+        return;
+    }
+
+    QByteArray state;
+    QDataStream stream(&state, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_15);
+    stream << g_stateVersion << m_lastRunFinished << (m_crawls.keys() + m_pendingAlbums);
+
+    SynoLibraryIndex::instance().setCrawlState(state);
+}
+
+QByteArrayList SynoLibraryCrawler::listFormData(const QByteArray& albumId, int offset) const
+{
+    QByteArrayList formData;
+    formData << QByteArrayLiteral("method=list");
+    formData << QByteArrayLiteral("version=1");
+    formData << QByteArrayLiteral("type=album,photo,video");
+    formData << QByteArrayLiteral("offset=") + QByteArray::number(offset);
+    formData << QByteArrayLiteral("limit=") + QByteArray::number(m_batchSize);
+    formData << QByteArrayLiteral("recursive=false");
+    formData << QByteArrayLiteral("additional=album_permission,photo_exif,video_codec,video_quality,thumb_size,file_location");
+    formData << QByteArrayLiteral("id=") + albumId;
+    return formData;
+}
@@ -0,0 +1,126 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNOLIBRARYCRAWLER_H
+#define SYNOLIBRARYCRAWLER_H
+
+#include "synoalbumdata.h"
+
+#include <QByteArray>
+#include <QByteArrayList>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+
+#include <memory>
+
+class SynoConn;
+class SynoRequest;
+
+/*!
+ * \brief Background crawler of the library
+ *
+ * The crawler walks the album tree from the root album, listing several albums
+ * at a time, and stores the listed items in SynoLibraryIndex. Each album replaces
+ * its indexed content once it is listed completely.
+ *
+ * Requests are sent only after the connection was not used by the views for a while,
+ * so browsing is not slowed down. Albums left to list are persisted, and the walk is
+ * resumed after restart. Completed walk is repeated after the configured interval.
+ */
+class SynoLibraryCrawler : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(SynoLibraryCrawler)
+
+public:
+    /*! Counters of all crawlers */
+    struct Statistics
+    {
+        quint64 albums = 0;
+        quint64 items = 0;
+        quint64 failed = 0;
+    };
+
+public:
+    explicit SynoLibraryCrawler(SynoConn* conn, QObject* parent = nullptr);
+    ~SynoLibraryCrawler();
+
+    /*! Returns TRUE if the walk is in progress */
+    bool isRunning() const;
+
+    static Statistics statistics();
+
+private:
+    /*! Album being listed */
+    struct Crawl
+    {
+        QVector<SynoAlbumData> items;
+        std::shared_ptr<SynoRequest> request;
+        /*! A page is requested or being parsed */
+        bool isBusy = false;
+    };
+
+    void onConnStatusChanged();
+    void onIndexLoaded();
+
+    void schedule();
+    void stop();
+    void sendPage(const QByteArray& albumId);
+    void processPage(const QByteArray& albumId, const QByteArray& replyBody);
+    void completeAlbum(const QByteArray& albumId);
+    void failAlbum(const QByteArray& albumId);
+    void finishRun();
+
+    void restoreState();
+    void saveState();
+
+    QByteArrayList listFormData(const QByteArray& albumId, int offset) const;
+
+private:
+    QPointer<SynoConn> m_conn;
+    /*! Albums left to list in the current walk */
+    QList<QByteArray> m_pendingAlbums;
+    /*! Albums being listed */
+    QHash<QByteArray, Crawl> m_crawls;
+    /*! Time the last walk was completed */
+    QDateTime m_lastRunFinished;
+    /*! Timer of the next attempt to send requests */
+    QTimer m_scheduleTimer;
+    /*! Timer of postponed state persisting */
+    QTimer m_saveTimer;
+    /*! Connection is authorized and the index is loaded */
+    bool m_isOnline;
+    /*! Incremented on stop, to discard replies of cancelled walk */
+    quint64 m_generation;
+
+    bool m_isEnabled;
+    /*! Amount of albums listed concurrently */
+    int m_maxAlbumsInFlight;
+    int m_batchSize;
+    /*! Time the connection should be idle before the crawler proceeds, in ms */
+    int m_idleTimeMs;
+    /*! Interval between walks, in seconds */
+    qint64 m_runIntervalSec;
+};
+
+#endif // SYNOLIBRARYCRAWLER_H
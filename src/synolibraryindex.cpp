@@ -0,0 +1,329 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synolibraryindex.h"
+#include "synoauth.h"
+#include "synoconn.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDirIterator>
+#include <QFile>
+#include <QFutureWatcher>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QtConcurrent>
+
+// "FSLI", followed by format version
+static constexpr quint32 g_fileMagic = 0x46534c49;
+static constexpr quint32 g_fileVersion = 2;
+
+static inline QString hashedName(const QByteArray& data)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex());
+}
+
+static inline QString crawlStateFileName()
+{
+    return QStringLiteral("crawlstate");
+}
+
+static inline bool isAlbum(const SynoAlbumData& item)
+{
+    return item.type() == QLatin1String("album");
+}
+
+static inline void writeFile(const QString& filePath, const QByteArray& data)
+{
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qWarning() << __FUNCTION__ << QObject::tr("Cannot write library index file: %1. %2")
+                      .arg(filePath).arg(file.errorString());
+    }
+}
+
+SynoLibraryIndex& SynoLibraryIndex::instance()
+{
+    static SynoLibraryIndex i;
+    return i;
+}
+
+SynoLibraryIndex::SynoLibraryIndex()
+    : QObject()
+    , m_isLoaded(false)
+    , m_generation(0)
+{
+    m_rootDir.setPath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    m_rootDir.mkpath(QStringLiteral("library"));
+    m_rootDir.cd(QStringLiteral("library"));
+
+    m_writePool.setMaxThreadCount(1);
+}
+
+void SynoLibraryIndex::open(const SynoConn* conn)
+{
+    QByteArray scope = conn->synoUrl().toEncoded() + '\n' + conn->auth()->username().toUtf8();
+    QString dirPath = m_rootDir.absoluteFilePath(hashedName(scope));
+    if (dirPath == m_scopeDirPath) {
+        return;
+    }
+
+    m_scopeDirPath = dirPath;
+    m_isLoaded = false;
+    m_content = Content();
+    const quint64 generation = ++m_generation;
+
+    // files of the scope could be still being written, if it was open before
+    m_writePool.waitForDone();
+    m_rootDir.mkpath(dirPath);
+
+    auto* watcher = new QFutureWatcher<Content>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, generation]() {
+        Content content = watcher->result();
+        watcher->deleteLater();
+
+        if (generation != m_generation) {
+            return;
+        }
+
+        m_content = std::move(content);
+        m_isLoaded = true;
+
+        qDebug() << tr("Library index is loaded. Albums: %1. Items: %2.")
+                    .arg(albumCount()).arg(itemCount());
+
+        emit loaded();
+    });
+
+    watcher->setFuture(QtConcurrent::run([dirPath]() {
+        return loadContent(dirPath);
+    }));
+}
+
+bool SynoLibraryIndex::isLoaded() const
+{
+    return m_isLoaded;
+}
+
+QVector<SynoAlbumData> SynoLibraryIndex::albumItems(const QByteArray& albumId) const
+{
+    return m_content.albums.value(albumId);
+}
+
+bool SynoLibraryIndex::containsAlbum(const QByteArray& albumId) const
+{
+    return m_content.albums.contains(albumId);
+}
+
+void SynoLibraryIndex::setAlbumItems(const QByteArray& albumId, const QVector<SynoAlbumData>& items)
+{
+    Q_ASSERT(m_isLoaded);
+
+    // sub-albums which are not listed anymore are removed with their content
+    auto iter = m_content.albums.constFind(albumId);
+    if (iter != m_content.albums.constEnd()) {
+        QSet<QString> childAlbumIds;
+        for (const SynoAlbumData& item : items) {
+            if (isAlbum(item)) {
+                childAlbumIds.insert(item.id);
+            }
+        }
+
+        QByteArrayList removedAlbumIds;
+        for (const SynoAlbumData& item : iter.value()) {
+            if (isAlbum(item) && !childAlbumIds.contains(item.id)) {
+                removedAlbumIds.append(item.id.toUtf8());
+            }
+        }
+
+        for (const QByteArray& removedAlbumId : std::as_const(removedAlbumIds)) {
+            removeAlbum(removedAlbumId);
+        }
+    }
+
+    emit albumAboutToChange(albumId);
+
+    removeAlbumContent(albumId);
+    m_content.albums.insert(albumId, items);
+    indexItems(m_content.items, albumId, items);
+
+    const QString filePath = albumFilePath(albumId);
+    QtConcurrent::run(&m_writePool, [filePath, albumId, items]() {
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_15);
+        stream << g_fileMagic << g_fileVersion << albumId << items;
+        writeFile(filePath, data);
+    });
+
+    emit albumChanged(albumId);
+}
+
+void SynoLibraryIndex::removeAlbum(const QByteArray& albumId)
+{
+    auto iter = m_content.albums.constFind(albumId);
+    if (iter == m_content.albums.constEnd()) {
+        return;
+    }
+
+    QByteArrayList childAlbumIds;
+    for (const SynoAlbumData& item : iter.value()) {
+        if (isAlbum(item)) {
+            childAlbumIds.append(item.id.toUtf8());
+        }
+    }
+
+    for (const QByteArray& childAlbumId : std::as_const(childAlbumIds)) {
+        removeAlbum(childAlbumId);
+    }
+
+    emit albumAboutToChange(albumId);
+
+    removeAlbumContent(albumId);
+    m_content.albums.remove(albumId);
+
+    const QString filePath = albumFilePath(albumId);
+    QtConcurrent::run(&m_writePool, [filePath]() {
+        QFile::remove(filePath);
+    });
+
+    emit albumChanged(albumId);
+}
+
+SynoAlbumData SynoLibraryIndex::item(const QString& itemId) const
+{
+    auto iter = m_content.items.constFind(itemId);
+    if (iter == m_content.items.constEnd()) {
+        return SynoAlbumData::null;
+    }
+
+    return m_content.albums.value(iter->albumId).value(iter->index, SynoAlbumData::null);
+}
+
+QByteArray SynoLibraryIndex::itemAlbumId(const QString& itemId) const
+{
+    return m_content.items.value(itemId).albumId;
+}
+
+const QHash<QByteArray, QVector<SynoAlbumData>>& SynoLibraryIndex::albums() const
+{
+    return m_content.albums;
+}
+
+QList<QByteArray> SynoLibraryIndex::albumIds() const
+{
+    return m_content.albums.keys();
+}
+
+int SynoLibraryIndex::albumCount() const
+{
+    return m_content.albums.size();
+}
+
+int SynoLibraryIndex::itemCount() const
+{
+    return m_content.items.size();
+}
+
+const QByteArray& SynoLibraryIndex::crawlState() const
+{
+    return m_content.crawlState;
+}
+
+void SynoLibraryIndex::setCrawlState(const QByteArray& state)
+{
+    Q_ASSERT(m_isLoaded);
+
+    m_content.crawlState = state;
+
+    const QString filePath = m_scopeDirPath + '/' + crawlStateFileName();
+    QtConcurrent::run(&m_writePool, [filePath, state]() {
+        writeFile(filePath, state);
+    });
+}
+
+SynoLibraryIndex::Content SynoLibraryIndex::loadContent(const QString& dirPath)
+{
+    Content content;
+
+    QDirIterator fileIter(dirPath, QDir::Files);
+    while (fileIter.hasNext()) {
+        QFile file(fileIter.next());
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+
+        if (fileIter.fileName() == crawlStateFileName()) {
+            content.crawlState = file.readAll();
+            continue;
+        }
+
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_15);
+
+        quint32 magic = 0;
+        quint32 version = 0;
+        stream >> magic >> version;
+        if (magic != g_fileMagic || version != g_fileVersion) {
+            // written by another version, the album is crawled again
+            continue;
+        }
+
+        QByteArray albumId;
+        QVector<SynoAlbumData> items;
+        stream >> albumId >> items;
+        if (stream.status() != QDataStream::Ok) {
+            qWarning() << __FUNCTION__ << tr("Corrupted library index file: %1").arg(file.fileName());
+            continue;
+        }
+
+        indexItems(content.items, albumId, items);
+        content.albums.insert(albumId, items);
+    }
+
+    return content;
+}
+
+void SynoLibraryIndex::indexItems(QHash<QString, ItemRef>& refs, const QByteArray& albumId, const QVector<SynoAlbumData>& items)
+{
+    for (int i = 0; i < items.size(); ++i) {
+        refs.insert(items[i].id, ItemRef{albumId, i});
+    }
+}
+
+void SynoLibraryIndex::removeAlbumContent(const QByteArray& albumId)
+{
+    auto iter = m_content.albums.constFind(albumId);
+    if (iter == m_content.albums.constEnd()) {
+        return;
+    }
+
+    // the item could be listed in another album meanwhile
+    for (const SynoAlbumData& item : iter.value()) {
+        auto refIter = m_content.items.find(item.id);
+        if (refIter != m_content.items.end() && refIter->albumId == albumId) {
+            m_content.items.erase(refIter);
+        }
+    }
+}
+
+QString SynoLibraryIndex::albumFilePath(const QByteArray& albumId) const
+{
+    return m_scopeDirPath + '/' + hashedName(albumId);
+}
@@ -0,0 +1,124 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNOLIBRARYINDEX_H
+#define SYNOLIBRARYINDEX_H
+
+#include "synoalbumdata.h"
+
+#include <QByteArray>
+#include <QByteArrayList>
+#include <QDir>
+#include <QHash>
+#include <QObject>
+#include <QThreadPool>
+#include <QVector>
+
+class SynoConn;
+
+/*!
+ * \brief Local index of library items
+ *
+ * Items are stored per album as listed by the service, and persisted on disk,
+ * so every view can look the library up without network round trips.
+ * The index is filled by SynoLibraryCrawler.
+ *
+ * Entries are scoped by service URL and user name.
+ *
+ * This class should be used from GUI thread only.
+ */
+class SynoLibraryIndex : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(SynoLibraryIndex)
+
+public:
+    /*!
+     * \brief This method returns instance of library index
+     */
+    static SynoLibraryIndex& instance();
+
+    /*! Loads persisted index of the connection scope in background, loaded() is emitted on completion */
+    void open(const SynoConn* conn);
+    bool isLoaded() const;
+
+    /*! Returns items of the album, or empty vector if the album is not indexed */
+    QVector<SynoAlbumData> albumItems(const QByteArray& albumId) const;
+    bool containsAlbum(const QByteArray& albumId) const;
+    /*! Replaces items of the album, child albums which are gone are removed with their content */
+    void setAlbumItems(const QByteArray& albumId, const QVector<SynoAlbumData>& items);
+    /*! Removes the album with its content */
+    void removeAlbum(const QByteArray& albumId);
+
+    /*! Returns item by id, or null record if the item is not indexed */
+    SynoAlbumData item(const QString& itemId) const;
+    /*! Returns id of album which contains the item */
+    QByteArray itemAlbumId(const QString& itemId) const;
+
+    /*! Returns items of all indexed albums, keyed by album id */
+    const QHash<QByteArray, QVector<SynoAlbumData>>& albums() const;
+    QList<QByteArray> albumIds() const;
+    int albumCount() const;
+    int itemCount() const;
+
+    /*! Returns opaque crawler state persisted along with the index */
+    const QByteArray& crawlState() const;
+    void setCrawlState(const QByteArray& state);
+
+signals:
+    void loaded();
+    /*! Emitted before items of the album are replaced or removed */
+    void albumAboutToChange(const QByteArray& albumId);
+    /*! Emitted after items of the album are replaced or removed */
+    void albumChanged(const QByteArray& albumId);
+
+private:
+    struct ItemRef
+    {
+        QByteArray albumId;
+        int index;
+    };
+
+    struct Content
+    {
+        QHash<QByteArray, QVector<SynoAlbumData>> albums;
+        QHash<QString, ItemRef> items;
+        QByteArray crawlState;
+    };
+
+    SynoLibraryIndex();
+
+    static Content loadContent(const QString& dirPath);
+    static void indexItems(QHash<QString, ItemRef>& refs, const QByteArray& albumId, const QVector<SynoAlbumData>& items);
+
+    void removeAlbumContent(const QByteArray& albumId);
+    QString albumFilePath(const QByteArray& albumId) const;
+
+private:
+    QDir m_rootDir;
+    /*! Directory of current scope */
+    QString m_scopeDirPath;
+    Content m_content;
+    bool m_isLoaded;
+    /*! Incremented on scope change, to discard outdated loading */
+    quint64 m_generation;
+    /*! Files are written in order by a single thread */
+    QThreadPool m_writePool;
+};
+
+#endif // SYNOLIBRARYINDEX_H
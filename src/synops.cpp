@@ -23,7 +23,9 @@
 
 #include "synoalbumfactory.h"
 #include "synoconn.h"
+#include "synolibrarycrawler.h"
 #include "synoreplyjson.h"
+#include "synosessionsnapshot.h"
 #include "synosize.h"
 
 static SynoPS* g_synoPS = nullptr;
@@ -33,10 +35,12 @@ class SynoPSPrivate : public QObjectPrivate
 public:
     SynoPSPrivate()
         : QObjectPrivate()
+        , crawler(&conn)
     {
     }
 
     SynoConn conn;
+    SynoLibraryCrawler crawler;
 };
 
 SynoPS::SynoPS()
@@ -83,6 +87,7 @@ void SynoPS::registerQmlTypes()
     qmlRegisterSingletonType<SynoPS>(qmlUrl, 1, 0, "SynoPS", SynoPS::fromQmlEngine);
     qmlRegisterSingletonType<SynoReplyJSONFactory>(qmlUrl, 1, 0, "SynoReplyJSONFactory", SynoReplyJSONFactory::fromQmlEngine);
     qmlRegisterSingletonType<SynoAlbumFactory>(qmlUrl, 1, 0, "SynoAlbumFactory", SynoAlbumFactory::fromQmlEngine);
+    qmlRegisterSingletonType<SynoSessionSnapshot>(qmlUrl, 1, 0, "SynoSessionSnapshot", SynoSessionSnapshot::fromQmlEngine);
     qmlRegisterSingletonType<SynoSizeGadget>(qmlUrl, 1, 0, "SynoSize", SynoSizeGadget::fromQmlEngine);
 }
 
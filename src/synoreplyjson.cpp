@@ -67,6 +67,15 @@ QString SynoReplyJSON::text() const
     return QString::fromUtf8(m_json.toJson(QJsonDocument::Indented));
 }
 
+QString SynoReplyJSON::errorStringForCode(int errorCode)
+{
+    if (const char* errorCodeEnum = SynoErrorGadget::metaEnum().valueToKey(errorCode)) {
+        return tr("SYNO error: %1 (%2)").arg(errorCodeEnum).arg(errorCode);
+    }
+
+    return tr("SYNO error: UNKNOWN (%1)").arg(errorCode);
+}
+
 void SynoReplyJSON::parseStatus()
 {
     QJsonValue jvError = m_json.object()[QStringLiteral("error")];
@@ -74,12 +83,7 @@ void SynoReplyJSON::parseStatus()
         QJsonObject joError = jvError.toObject();
         auto joiErrorCode = joError.find(QStringLiteral("code"));
         if (joiErrorCode != joError.end()) {
-            int errorCode = joiErrorCode.value().toInt(-1);
-            if (const char* errorCodeEnum = SynoErrorGadget::metaEnum().valueToKey(errorCode)) {
-                setErrorString(tr("SYNO error: %1 (%2)").arg(errorCodeEnum).arg(errorCode));
-            } else {
-                setErrorString(tr("SYNO error: UNKNOWN (%1)").arg(errorCode));
-            }
+            setErrorString(errorStringForCode(joiErrorCode.value().toInt(-1)));
         } else {
             setErrorString(tr("SYNO error: UNKNOWN"));
         }
@@ -46,6 +46,9 @@ public:
 
     QString text() const;
 
+    /*! Returns description of the error code reported by the service */
+    static QString errorStringForCode(int errorCode);
+
 signals:
     void errorStringChanged();
 
@@ -17,6 +17,7 @@
  */
 
 #include "synoconn.h"
+#include "synocontenttype.h"
 #include "synorequest.h"
 
 #include <QDebug>
@@ -34,6 +35,8 @@ SynoRequest::SynoRequest(const QByteArray& api, const QByteArrayList& formData,
     , m_reply(nullptr)
     , m_contentType(UNKNOWN)
     , m_intrusive(false)
+    , m_batchable(false)
+    , m_background(false)
 {
     Q_ASSERT(conn);
 
@@ -118,6 +121,26 @@ void SynoRequest::setIsIntrusive(bool value)
     }
 }
 
+bool SynoRequest::isBatchable() const
+{
+    return m_batchable;
+}
+
+void SynoRequest::setIsBatchable(bool value)
+{
+    m_batchable = value;
+}
+
+bool SynoRequest::isBackground() const
+{
+    return m_background;
+}
+
+void SynoRequest::setIsBackground(bool value)
+{
+    m_background = value;
+}
+
 const QByteArray& SynoRequest::contentMimeTypeRaw() const
 {
     return m_contentMimeTypeRaw;
@@ -125,6 +148,11 @@ const QByteArray& SynoRequest::contentMimeTypeRaw() const
 
 QMimeType SynoRequest::contentMimeType() const
 {
+    if (!m_contentMimeType.isValid() && !m_contentMimeTypeRaw.isEmpty()) {
+        QByteArray contentType = m_contentMimeTypeRaw.left(m_contentMimeTypeRaw.indexOf(';')).trimmed();
+        m_contentMimeType = QMimeDatabase().mimeTypeForName(QString::fromLatin1(contentType));
+    }
+
     return m_contentMimeType;
 }
 
@@ -138,6 +166,11 @@ const QByteArray& SynoRequest::contentEncoding() const
     return m_contentEncoding;
 }
 
+const QByteArray& SynoRequest::contentImageFormat() const
+{
+    return m_contentImageFormat;
+}
+
 void SynoRequest::send()
 {
     Q_ASSERT(m_conn);
@@ -188,39 +221,24 @@ void SynoRequest::cancel()
 
     if (QThread::currentThread() == m_conn->thread()) {
         QObject::disconnect(m_callbackConnection);
-        QObject::disconnect(m_reply, &QNetworkReply::finished, this, &SynoRequest::onReplyFinished);
+        if (m_reply) {
+            QObject::disconnect(m_reply, &QNetworkReply::finished, this, &SynoRequest::onReplyFinished);
+        }
         m_conn->cancelRequest(this);
     } else {
         QMetaObject::invokeMethod(this, std::bind(&SynoRequest::cancel, this), Qt::QueuedConnection);
     }
 }
 
-void SynoRequest::parseContentType()
+void SynoRequest::parseContentType(const QByteArray& contentTypeRaw)
 {
-    m_contentMimeTypeRaw = m_reply->header(QNetworkRequest::ContentTypeHeader).toByteArray();
-    QList<QByteArray> contentTypeList(m_contentMimeTypeRaw.split(';'));
-    QByteArray contentType;
-    if (contentTypeList.size() > 0) {
-        contentType = contentTypeList[0];
-    }
-
-    if (contentTypeList.size() > 1) {
-        QByteArray contentEncoding = contentTypeList[1].trimmed();
-        QByteArray charsetPrefix(QByteArrayLiteral("charset="));
-        if (contentEncoding.startsWith(charsetPrefix)) {
-            m_contentEncoding = contentEncoding.mid(charsetPrefix.size());
-        }
-    }
+    m_contentMimeTypeRaw = contentTypeRaw;
+    m_contentMimeType = QMimeType();
 
-    QMimeDatabase mimeDb;
-    m_contentMimeType = mimeDb.mimeTypeForName(contentType);
-    if (m_contentMimeType.inherits(QStringLiteral("text/plain"))) {
-        m_contentType = TEXT;
-    } else if (m_contentMimeType.inherits(QStringLiteral("image/jpeg"))) {
-        m_contentType = IMAGE_JPEG;
-    } else if (m_contentMimeType.inherits(QStringLiteral("image"))) {
-        m_contentType = IMAGE_OTHER;
-    }
+    SynoContentTypeInfo info = SynoContentTypeClassifier::instance().classify(contentTypeRaw);
+    m_contentType = info.type;
+    m_contentEncoding = info.encoding;
+    m_contentImageFormat = info.imageFormat;
 
     emit contentTypeChanged();
 }
@@ -245,7 +263,7 @@ void SynoRequest::onReplyFinished()
     } else {
         m_replyBody = m_reply->readAll();
         m_reply->close();
-        parseContentType();
+        parseContentType(m_reply->header(QNetworkRequest::ContentTypeHeader).toByteArray());
     }
 
 #ifdef QT_DEBUG
@@ -255,3 +273,21 @@ void SynoRequest::onReplyFinished()
 
     emit finished();
 }
+
+void SynoRequest::complete(const QByteArray& replyBody, const QString& errorString)
+{
+    if (!errorString.isEmpty()) {
+        setErrorString(errorString);
+    } else {
+        m_replyBody = replyBody;
+        // the content type is set as the service does for JSON replies
+        parseContentType(QByteArrayLiteral("text/plain; charset=utf-8"));
+    }
+
+#ifdef QT_DEBUG
+    qDebug() << QStringLiteral("RP:Batched:API: ") << m_api;
+    qDebug() << QStringLiteral("RP:Body: ") << m_replyBody;
+#endif
+
+    emit finished();
+}
@@ -30,6 +30,7 @@
 #include <QQmlEngine>
 
 class SynoConn;
+class SynoConnPrivate;
 
 class SynoRequest : public QObject
 {
@@ -54,6 +55,8 @@ public:
     };
     Q_ENUM(ContentType)
 
+    friend class SynoConnPrivate;
+
 public:
     SynoRequest(const QByteArray& api, const QByteArrayList& formData, SynoConn* conn);
     ~SynoRequest();
@@ -75,10 +78,30 @@ public:
     bool isIntrusive() const;
     void setIsIntrusive(bool value);
 
+    /*!
+     * \brief Allows the request to be coalesced with other requests into a compound request
+     *
+     * Only requests replying with JSON can be batched.
+     */
+    bool isBatchable() const;
+    void setIsBatchable(bool value);
+
+    /*!
+     * \brief Marks the request as not caused by user interaction
+     *
+     * Background work yields the connection while foreground requests are sent.
+     * The request is sent with low network priority.
+     */
+    bool isBackground() const;
+    void setIsBackground(bool value);
+
     const QByteArray& contentMimeTypeRaw() const;
+    /*! Returns MIME type of the reply. It is resolved on first call, as the lookup is expensive. */
     QMimeType contentMimeType() const;
     ContentType contentType() const;
     const QByteArray& contentEncoding() const;
+    /*! Returns image format suitable for QImageReader, or empty value if the reply is not an image */
+    const QByteArray& contentImageFormat() const;
 
 public slots:
     void send();
@@ -93,7 +116,8 @@ signals:
     void finished();
 
 private:
-    void parseContentType();
+    void parseContentType(const QByteArray& contentTypeRaw);
+    void complete(const QByteArray& replyBody, const QString& errorString);
 
 private slots:
     void onReplyFinished();
@@ -107,11 +131,14 @@ private:
     QPointer<QNetworkReply> m_reply;
     QString m_errorString;
     QByteArray m_contentMimeTypeRaw;
-    QMimeType m_contentMimeType;
+    mutable QMimeType m_contentMimeType;
     ContentType m_contentType;
     QByteArray m_contentEncoding;
+    QByteArray m_contentImageFormat;
     QByteArray m_replyBody;
     bool m_intrusive;
+    bool m_batchable;
+    bool m_background;
 };
 
 #endif // SYNOREPLY_H
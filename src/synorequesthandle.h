@@ -0,0 +1,120 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNOREQUESTHANDLE_H
+#define SYNOREQUESTHANDLE_H
+
+#include "synorequest.h"
+
+#include <QByteArray>
+#include <QByteArrayList>
+#include <QString>
+
+#include <atomic>
+#include <functional>
+
+class QNetworkReply;
+
+/*!
+ * \brief Lightweight request for C++ callers
+ *
+ * Handles are pooled by SynoConn and reused, the completion is dispatched
+ * with a plain callback instead of signal-slot connections.
+ * SynoRequest remains the interface for QML and for JSON replies.
+ *
+ * Use SynoConn::acquireRequestHandle() to obtain an instance, and
+ * SynoConn::releaseRequestHandle() to return it back.
+ */
+class SynoRequestHandle
+{
+    Q_DISABLE_COPY(SynoRequestHandle)
+
+    friend class SynoConn;
+    friend class SynoConnPrivate;
+
+public:
+    /*! Callback is invoked in thread of connection object */
+    using Callback = std::function<void(SynoRequestHandle*)>;
+
+public:
+    const QByteArray& api() const { return m_api; }
+
+    QByteArrayList& formData() { return m_formData; }
+    const QByteArrayList& formData() const { return m_formData; }
+
+    void setCallback(const Callback& callback) { m_callback = callback; }
+
+    /*! Background request is sent with low priority, and is not accounted as activity of the views */
+    bool isBackground() const { return m_background; }
+    void setIsBackground(bool value) { m_background = value; }
+
+    const QByteArray& replyBody() const { return m_replyBody; }
+    const QString& errorString() const { return m_errorString; }
+    SynoRequest::ContentType contentType() const { return m_contentType; }
+    const QByteArray& contentImageFormat() const { return m_contentImageFormat; }
+
+private:
+    enum State {
+        /*! Handle is in the pool, or owned by the caller before sending */
+        State_Idle = 0,
+        /*! Request is sent, the handle is owned by connection */
+        State_InFlight,
+        /*! Callback is being invoked */
+        State_Dispatching,
+        /*! Reply is delivered, the handle is owned by the caller */
+        State_Completed,
+        /*! Request is cancelled, the handle is recycled by connection */
+        State_Cancelled,
+        /*! Handle is released while the callback is invoked, it is recycled once the callback returns */
+        State_Released
+    };
+
+    SynoRequestHandle() {}
+
+    void reset(const QByteArray& api, quint64 generation)
+    {
+        m_api = api;
+        // capacity of the list is preserved for reuse
+        m_formData.clear();
+        m_callback = Callback();
+        m_background = false;
+        m_replyBody.clear();
+        m_errorString.clear();
+        m_contentType = SynoRequest::UNKNOWN;
+        m_contentImageFormat.clear();
+        m_reply = nullptr;
+        m_generation = generation;
+        m_state = State_Idle;
+    }
+
+private:
+    QByteArray m_api;
+    QByteArrayList m_formData;
+    Callback m_callback;
+    bool m_background = false;
+    QByteArray m_replyBody;
+    QString m_errorString;
+    SynoRequest::ContentType m_contentType = SynoRequest::UNKNOWN;
+    QByteArray m_contentImageFormat;
+    QNetworkReply* m_reply = nullptr;
+    /*! Unique number of handle usage, protects against stale cancellations */
+    quint64 m_generation = 0;
+    std::atomic<int> m_state{State_Idle};
+};
+
+#endif // SYNOREQUESTHANDLE_H
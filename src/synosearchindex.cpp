@@ -0,0 +1,331 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synosearchindex.h"
+#include "synolibraryindex.h"
+#include "synosettings.h"
+
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// words are split on separators and on letter-digit boundaries, e.g. "IMG_0042.jpg" gives "img", "0042", "jpg"
+static void appendWords(const QString& text, QVector<QByteArray>& words)
+{
+    int start = -1;
+    bool isDigitWord = false;
+
+    for (int i = 0; i <= text.size(); ++i) {
+        const QChar ch = (i < text.size()) ? text[i] : QChar();
+        const bool isWordChar = ch.isLetterOrNumber();
+        const bool isDigit = ch.isDigit();
+
+        if (start >= 0 && (!isWordChar || isDigit != isDigitWord)) {
+            words.append(text.midRef(start, i - start).toString().toCaseFolded().toUtf8());
+            start = -1;
+        }
+
+        if (isWordChar && start < 0) {
+            start = i;
+            isDigitWord = isDigit;
+        }
+    }
+}
+
+static inline void sortUnique(QVector<QByteArray>& words)
+{
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+}
+
+static QVector<QByteArray> documentWords(const SynoAlbumData& item)
+{
+    QVector<QByteArray> words;
+    appendWords(item.title, words);
+    appendWords(item.description, words);
+    appendWords(item.name, words);
+    appendWords(item.path(), words);
+    sortUnique(words);
+    return words;
+}
+
+SynoSearchIndex& SynoSearchIndex::instance()
+{
+    static SynoSearchIndex i;
+    return i;
+}
+
+SynoSearchIndex::SynoSearchIndex()
+    : QObject()
+    , m_buildGeneration(0)
+    , m_isBuilding(false)
+    , m_queryCount(0)
+    , m_queryTimeUs(0)
+{
+    SynoSettings settings(QStringLiteral("performance"));
+    m_rebuildThreshold = qBound(0, settings.value(QStringLiteral("searchRebuildThreshold"), 10000).toInt(), std::numeric_limits<int>::max());
+
+    SynoLibraryIndex& libraryIndex = SynoLibraryIndex::instance();
+    connect(&libraryIndex, &SynoLibraryIndex::loaded, this, [this]() {
+        // the content of another scope is not searched meanwhile
+        m_content = Content();
+        rebuild();
+        emit changed();
+    });
+    connect(&libraryIndex, &SynoLibraryIndex::albumChanged, this, &SynoSearchIndex::onAlbumChanged);
+
+    if (libraryIndex.isLoaded()) {
+        rebuild();
+    }
+}
+
+SynoSearchIndex::SynoSearchIndex(const QHash<QByteArray, QVector<SynoAlbumData>>& albums, QObject* parent)
+    : QObject(parent)
+    , m_content(build(albums))
+    , m_buildGeneration(0)
+    , m_isBuilding(false)
+    , m_rebuildThreshold(std::numeric_limits<int>::max())
+    , m_queryCount(0)
+    , m_queryTimeUs(0)
+{
+}
+
+QStringList SynoSearchIndex::search(const QString& query, int maxResults) const
+{
+    QElapsedTimer elapsedTimer;
+    elapsedTimer.start();
+
+    QVector<QByteArray> words;
+    appendWords(query, words);
+    sortUnique(words);
+
+    QStringList itemIds;
+    if (words.isEmpty() || maxResults <= 0) {
+        return itemIds;
+    }
+
+    // prefix ranges of the query words, with the amount of documents they list
+    struct WordRange
+    {
+        QMap<QByteArray, QVector<quint32>>::const_iterator first;
+        QMap<QByteArray, QVector<quint32>>::const_iterator last;
+        int termCount = 0;
+        qint64 postingCount = 0;
+    };
+
+    QVector<WordRange> ranges;
+    ranges.reserve(words.size());
+    for (const QByteArray& word : std::as_const(words)) {
+        WordRange range;
+        range.first = m_content.terms.lowerBound(word);
+        for (range.last = range.first; range.last != m_content.terms.constEnd() && range.last.key().startsWith(word); ++range.last) {
+            ++range.termCount;
+            range.postingCount += range.last.value().size();
+        }
+        ranges.append(range);
+    }
+
+    // the most selective word gives the candidates, the others only filter them
+    std::sort(ranges.begin(), ranges.end(), [](const WordRange& a, const WordRange& b) {
+        return a.postingCount < b.postingCount;
+    });
+
+    const int docCount = m_content.docItemIds.size();
+    QVector<quint32> candidates;
+    if (ranges.first().termCount == 1) {
+        // document numbers of a word are sorted already
+        candidates = ranges.first().first.value();
+    } else if (ranges.first().termCount > 1) {
+        QBitArray matched(docCount);
+        for (auto iter = ranges.first().first; iter != ranges.first().last; ++iter) {
+            for (quint32 doc : iter.value()) {
+                matched.setBit(static_cast<int>(doc));
+            }
+        }
+
+        candidates.reserve(static_cast<int>(std::min<qint64>(ranges.first().postingCount, docCount)));
+        for (int doc = 0; doc < docCount; ++doc) {
+            if (matched.testBit(doc)) {
+                candidates.append(static_cast<quint32>(doc));
+            }
+        }
+    }
+
+    for (int i = 1; i < ranges.size() && !candidates.isEmpty(); ++i) {
+        const WordRange& range = ranges[i];
+        auto isMatched = [](const QVector<quint32>& docs, quint32 doc) {
+            return std::binary_search(docs.cbegin(), docs.cend(), doc);
+        };
+
+        const qint64 lookupCost = static_cast<qint64>(candidates.size()) * range.termCount
+                                  * (1 + static_cast<qint64>(std::ceil(std::log2(1.0 + range.postingCount / std::max(1, range.termCount)))));
+        if (lookupCost < range.postingCount) {
+            // few candidates are looked up in the sorted document numbers of the words
+            auto iter = std::remove_if(candidates.begin(), candidates.end(), [&range, &isMatched](quint32 doc) {
+                for (auto termIter = range.first; termIter != range.last; ++termIter) {
+                    if (isMatched(termIter.value(), doc)) {
+                        return false;
+                    }
+                }
+                return true;
+            });
+            candidates.erase(iter, candidates.end());
+        } else {
+            QBitArray wordMatched(docCount);
+            for (auto termIter = range.first; termIter != range.last; ++termIter) {
+                for (quint32 doc : termIter.value()) {
+                    wordMatched.setBit(static_cast<int>(doc));
+                }
+            }
+
+            auto iter = std::remove_if(candidates.begin(), candidates.end(), [&wordMatched](quint32 doc) {
+                return !wordMatched.testBit(static_cast<int>(doc));
+            });
+            candidates.erase(iter, candidates.end());
+        }
+    }
+
+    // candidates are in indexing order, so the first results are taken
+    for (quint32 doc : std::as_const(candidates)) {
+        if (itemIds.size() >= maxResults) {
+            break;
+        }
+        if (!m_content.docRemoved.testBit(static_cast<int>(doc))) {
+            itemIds.append(m_content.docItemIds[static_cast<int>(doc)]);
+        }
+    }
+
+    ++m_queryCount;
+    m_queryTimeUs += static_cast<quint64>(elapsedTimer.nsecsElapsed() / 1000);
+
+    return itemIds;
+}
+
+int SynoSearchIndex::documentCount() const
+{
+    return m_content.docItemIds.size() - m_content.removedCount;
+}
+
+int SynoSearchIndex::termCount() const
+{
+    return m_content.terms.size();
+}
+
+QPair<quint64, quint64> SynoSearchIndex::queryStatistics() const
+{
+    return qMakePair(m_queryCount, m_queryTimeUs);
+}
+
+SynoSearchIndex::Content SynoSearchIndex::build(const QHash<QByteArray, QVector<SynoAlbumData>>& albums)
+{
+    Content content;
+    for (auto iter = albums.constBegin(); iter != albums.constEnd(); ++iter) {
+        addAlbumDocs(content, iter.key(), iter.value());
+    }
+    return content;
+}
+
+void SynoSearchIndex::addAlbumDocs(Content& content, const QByteArray& albumId, const QVector<SynoAlbumData>& items)
+{
+    if (items.isEmpty()) {
+        return;
+    }
+
+    // documents are numbered in ascending order, so the word lists stay sorted on appending
+    QVector<quint32>& docs = content.albumDocs[albumId];
+    for (const SynoAlbumData& item : items) {
+        const quint32 doc = static_cast<quint32>(content.docItemIds.size());
+        content.docItemIds.append(item.id);
+        docs.append(doc);
+
+        const QVector<QByteArray> words = documentWords(item);
+        for (const QByteArray& word : words) {
+            content.terms[word].append(doc);
+        }
+    }
+
+    content.docRemoved.resize(content.docItemIds.size());
+}
+
+void SynoSearchIndex::removeAlbumDocs(Content& content, const QByteArray& albumId)
+{
+    const QVector<quint32> docs = content.albumDocs.take(albumId);
+    for (quint32 doc : docs) {
+        content.docRemoved.setBit(static_cast<int>(doc));
+        content.docItemIds[static_cast<int>(doc)].clear();
+    }
+
+    content.removedCount += docs.size();
+}
+
+void SynoSearchIndex::rebuild()
+{
+    const quint64 generation = ++m_buildGeneration;
+    m_isBuilding = true;
+    // the snapshot contains all changes made so far
+    m_dirtyAlbums.clear();
+
+    auto* watcher = new QFutureWatcher<Content>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, generation]() {
+        Content content = watcher->result();
+        watcher->deleteLater();
+
+        if (generation != m_buildGeneration) {
+            return;
+        }
+
+        m_content = std::move(content);
+        m_isBuilding = false;
+
+        QSet<QByteArray> dirtyAlbums;
+        std::swap(dirtyAlbums, m_dirtyAlbums);
+        for (const QByteArray& albumId : std::as_const(dirtyAlbums)) {
+            removeAlbumDocs(m_content, albumId);
+            addAlbumDocs(m_content, albumId, SynoLibraryIndex::instance().albumItems(albumId));
+        }
+
+        emit changed();
+    });
+
+    QHash<QByteArray, QVector<SynoAlbumData>> albums = SynoLibraryIndex::instance().albums();
+    watcher->setFuture(QtConcurrent::run([albums]() {
+        return build(albums);
+    }));
+}
+
+void SynoSearchIndex::onAlbumChanged(const QByteArray& albumId)
+{
+    if (m_isBuilding) {
+        m_dirtyAlbums.insert(albumId);
+        return;
+    }
+
+    removeAlbumDocs(m_content, albumId);
+    addAlbumDocs(m_content, albumId, SynoLibraryIndex::instance().albumItems(albumId));
+
+    // removed documents are kept in the word lists until rebuild
+    if (m_content.removedCount > m_rebuildThreshold && m_content.removedCount > documentCount()) {
+        rebuild();
+    }
+
+    emit changed();
+}
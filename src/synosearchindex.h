@@ -0,0 +1,118 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNOSEARCHINDEX_H
+#define SYNOSEARCHINDEX_H
+
+#include "synoalbumdata.h"
+
+#include <QBitArray>
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QPair>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+/*!
+ * \brief Full-text index over items of SynoLibraryIndex
+ *
+ * Title, description, name and path of each item are split into words,
+ * which are case folded and mapped to sorted lists of document numbers.
+ * Query words are matched as prefixes of the indexed words, and all of them
+ * should match. The documents of the most selective query word are the candidates,
+ * which are filtered by the other words.
+ *
+ * The index follows changes of SynoLibraryIndex album by album. Removed documents
+ * are only marked as such, the index is rebuilt in background once they dominate.
+ *
+ * This class should be used from GUI thread only.
+ */
+class SynoSearchIndex : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(SynoSearchIndex)
+
+public:
+    /*!
+     * \brief This method returns instance of search index
+     */
+    static SynoSearchIndex& instance();
+
+    /*!
+     * \brief Creates standalone index over the albums, keyed by album id
+     *
+     * The index is built at once and does not follow SynoLibraryIndex.
+     */
+    explicit SynoSearchIndex(const QHash<QByteArray, QVector<SynoAlbumData>>& albums, QObject* parent = nullptr);
+
+    /*! Returns ids of the items matching the query, in indexing order */
+    QStringList search(const QString& query, int maxResults) const;
+
+    /*! Returns amount of indexed items */
+    int documentCount() const;
+    /*! Returns amount of distinct words */
+    int termCount() const;
+
+    /*! Returns amount of queries, and total time spent on them in microseconds */
+    QPair<quint64, quint64> queryStatistics() const;
+
+signals:
+    /*! Emitted when indexed content is changed */
+    void changed();
+
+private:
+    struct Content
+    {
+        /*! Word to sorted document numbers */
+        QMap<QByteArray, QVector<quint32>> terms;
+        /*! Document number to item id, empty for removed documents */
+        QVector<QString> docItemIds;
+        /*! Document number to removal mark */
+        QBitArray docRemoved;
+        /*! Album id to its document numbers */
+        QHash<QByteArray, QVector<quint32>> albumDocs;
+        int removedCount = 0;
+    };
+
+    SynoSearchIndex();
+
+    static Content build(const QHash<QByteArray, QVector<SynoAlbumData>>& albums);
+    static void addAlbumDocs(Content& content, const QByteArray& albumId, const QVector<SynoAlbumData>& items);
+    static void removeAlbumDocs(Content& content, const QByteArray& albumId);
+
+    void rebuild();
+    void onAlbumChanged(const QByteArray& albumId);
+
+private:
+    Content m_content;
+    /*! Incremented on each rebuild, to discard outdated one */
+    quint64 m_buildGeneration;
+    bool m_isBuilding;
+    /*! Albums changed while the index is being rebuilt */
+    QSet<QByteArray> m_dirtyAlbums;
+    /*! Removed documents which trigger rebuild, if they outnumber the alive ones */
+    int m_rebuildThreshold;
+
+    mutable quint64 m_queryCount;
+    mutable quint64 m_queryTimeUs;
+};
+
+#endif // SYNOSEARCHINDEX_H
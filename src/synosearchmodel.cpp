@@ -0,0 +1,162 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synosearchmodel.h"
+#include "synolibraryindex.h"
+#include "synosearchindex.h"
+#include "synosettings.h"
+
+#include <QStringList>
+
+#include <algorithm>
+
+SynoSearchModel::SynoSearchModel(QObject* parent)
+    : QAbstractListModel(parent)
+{
+    SynoSettings settings(QStringLiteral("performance"));
+    m_maxResults = qBound(1, settings.value(QStringLiteral("searchMaxResults"), 1000).toInt(), 100000);
+
+    // the index changes album by album during crawling, the results are updated in bulk
+    m_updateTimer.setSingleShot(true);
+    m_updateTimer.setInterval(500);
+    connect(&m_updateTimer, &QTimer::timeout, this, &SynoSearchModel::update);
+    connect(&SynoSearchIndex::instance(), &SynoSearchIndex::changed, this, [this]() {
+        if (!m_query.isEmpty() && !m_updateTimer.isActive()) {
+            m_updateTimer.start();
+        }
+    });
+}
+
+QHash<int, QByteArray> SynoSearchModel::roleNames() const
+{
+    QHash<int, QByteArray> roles = QAbstractListModel::roleNames();
+    roles.insert(RoleSynoData, QByteArrayLiteral("synoData"));
+    roles.insert(RoleId, QByteArrayLiteral("itemId"));
+    roles.insert(RoleType, QByteArrayLiteral("itemType"));
+    roles.insert(RoleAlbumPath, QByteArrayLiteral("albumPath"));
+    return roles;
+}
+
+int SynoSearchModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+
+    return m_results.size();
+}
+
+QVariant SynoSearchModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_results.size()) {
+        return QVariant();
+    }
+
+    const SynoAlbumData& synoData = m_results[index.row()];
+
+    switch (role) {
+    case Qt::DisplayRole:
+        return synoData.name;
+    case RoleSynoData:
+        return QVariant::fromValue(synoData);
+    case RoleId:
+        return synoData.id;
+    case RoleType:
+        return synoData.type();
+    case RoleAlbumPath: {
+        const QString path = synoData.path();
+        const int sepIdx = path.lastIndexOf(QLatin1Char('/'));
+        return sepIdx > 0 ? path.left(sepIdx) : QString();
+    }
+    default:
+        break;
+    }
+
+    return QVariant();
+}
+
+SynoAlbumData SynoSearchModel::get(int row) const
+{
+    return m_results.value(row, SynoAlbumData::null);
+}
+
+const QString& SynoSearchModel::query() const
+{
+    return m_query;
+}
+
+void SynoSearchModel::setQuery(const QString& query)
+{
+    if (query != m_query) {
+        m_query = query;
+        // queries are answered locally, so results follow typing without delay
+        update();
+        emit queryChanged();
+    }
+}
+
+int SynoSearchModel::maxResults() const
+{
+    return m_maxResults;
+}
+
+void SynoSearchModel::setMaxResults(int value)
+{
+    value = std::max(1, value);
+    if (value != m_maxResults) {
+        m_maxResults = value;
+        update();
+        emit maxResultsChanged();
+    }
+}
+
+int SynoSearchModel::count() const
+{
+    return m_results.size();
+}
+
+void SynoSearchModel::update()
+{
+    m_updateTimer.stop();
+
+    const QStringList itemIds = SynoSearchIndex::instance().search(m_query, m_maxResults);
+
+    QVector<SynoAlbumData> results;
+    results.reserve(itemIds.size());
+    const SynoLibraryIndex& libraryIndex = SynoLibraryIndex::instance();
+    for (const QString& itemId : itemIds) {
+        SynoAlbumData item = libraryIndex.item(itemId);
+        if (!item.id.isEmpty()) {
+            results.append(item);
+        }
+    }
+
+    if (results == m_results) {
+        return;
+    }
+
+    const int oldCount = m_results.size();
+
+    beginResetModel();
+    m_results = std::move(results);
+    endResetModel();
+
+    if (m_results.size() != oldCount) {
+        emit countChanged();
+    }
+}
@@ -0,0 +1,97 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNOSEARCHMODEL_H
+#define SYNOSEARCHMODEL_H
+
+#include <QAbstractListModel>
+#include <QQmlEngine>
+#include <QTimer>
+#include <QVector>
+
+#include "synoalbumdata.h"
+
+/*!
+ * \brief Model of library items matching a text query
+ *
+ * The query is answered by SynoSearchIndex, without network requests.
+ * Items ids are suitable for the thumbnail image provider.
+ * Results are updated as the library index changes.
+ */
+class SynoSearchModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+    QML_ELEMENT
+
+    Q_PROPERTY(QString query READ query WRITE setQuery NOTIFY queryChanged)
+    Q_PROPERTY(int maxResults READ maxResults WRITE setMaxResults NOTIFY maxResultsChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    enum SynoSearchRoles
+    {
+        RoleSynoData = Qt::UserRole + 1,
+        RoleId,
+        RoleType,
+        /*! Path of album which contains the item */
+        RoleAlbumPath
+    };
+    Q_ENUM(SynoSearchRoles)
+
+public:
+    explicit SynoSearchModel(QObject* parent = nullptr);
+
+    QHash<int, QByteArray> roleNames() const override;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    /*!
+     * \brief This method returns album data for the specified row.
+     *
+     * \param row Row of the model
+     *
+     * \returns Album data for the row, or empty data
+     */
+    Q_INVOKABLE SynoAlbumData get(int row) const;
+
+    const QString& query() const;
+    void setQuery(const QString& query);
+
+    int maxResults() const;
+    void setMaxResults(int value);
+
+    int count() const;
+
+signals:
+    void queryChanged();
+    void maxResultsChanged();
+    void countChanged();
+
+private:
+    void update();
+
+private:
+    QString m_query;
+    int m_maxResults;
+    QVector<SynoAlbumData> m_results;
+    /*! Timer of postponed update on index change */
+    QTimer m_updateTimer;
+};
+
+#endif // SYNOSEARCHMODEL_H
@@ -0,0 +1,282 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synosessionsnapshot.h"
+#include "qmlobjectwrapper.h"
+#include "synoalbum.h"
+#include "synoalbumfactory.h"
+#include "synoauth.h"
+#include "synoconn.h"
+#include "synoimageprovider.h"
+#include "synops.h"
+#include "synosettings.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QQmlEngine>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+// "FSSS", followed by format version
+static constexpr quint32 g_fileMagic = 0x46535353;
+static constexpr quint32 g_fileVersion = 1;
+
+static inline bool isAuthorized(const SynoConn* conn)
+{
+    return (conn->status() == SynoConn::API_LOADED || conn->status() == SynoConn::OFFLINE)
+            && conn->auth()->status() == SynoAuth::AUTHORIZED;
+}
+
+SynoSessionSnapshot& SynoSessionSnapshot::instance()
+{
+    static SynoSessionSnapshot i;
+    return i;
+}
+
+QObject* SynoSessionSnapshot::fromQmlEngine(QQmlEngine* engine, QJSEngine* scriptEngine)
+{
+    Q_UNUSED(engine)
+    Q_UNUSED(scriptEngine)
+
+    SynoSessionSnapshot* i = &SynoSessionSnapshot::instance();
+    QQmlEngine::setObjectOwnership(i, QQmlEngine::CppOwnership);
+    return i;
+}
+
+SynoSessionSnapshot::SynoSessionSnapshot()
+    : QObject()
+    , m_conn(SynoPS::instance()->conn())
+    , m_isAvailable(false)
+    , m_total(0)
+    , m_batchSize(0)
+    , m_viewIndex(-1)
+    , m_contentY(0)
+{
+    SynoSettings settings(QStringLiteral("performance"));
+    m_isEnabled = settings.value(QStringLiteral("sessionSnapshotEnabled"), true).toBool();
+    m_maxItems = qBound(0, settings.value(QStringLiteral("sessionSnapshotItems"), 500).toInt(), 100000);
+    m_maxThumbs = qBound(0, settings.value(QStringLiteral("sessionSnapshotThumbs"), 100).toInt(), 10000);
+
+    m_rootDir.setPath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    m_rootDir.mkpath(QStringLiteral("session"));
+    m_rootDir.cd(QStringLiteral("session"));
+
+    connect(m_conn, &SynoConn::statusChanged, this, &SynoSessionSnapshot::onConnStatusChanged);
+    connect(m_conn->auth(), &SynoAuth::statusChanged, this, &SynoSessionSnapshot::onConnStatusChanged);
+
+    if (m_isEnabled) {
+        // the snapshot is small, and it is needed for the first frame
+        load();
+    }
+}
+
+bool SynoSessionSnapshot::isAvailable() const
+{
+    return m_isAvailable;
+}
+
+qreal SynoSessionSnapshot::contentY() const
+{
+    return m_contentY;
+}
+
+QObject* SynoSessionSnapshot::createAlbum()
+{
+    if (!m_isAvailable) {
+        return nullptr;
+    }
+
+    QmlObjectWrapper* wrapper = qobject_cast<QmlObjectWrapper*>(SynoAlbumFactory::instance().createAlbumForPath(m_path));
+    SynoAlbum* album = qobject_cast<SynoAlbum*>(wrapper->object());
+    if (album != m_album) {
+        m_album = album;
+
+        album->setBatchSize(m_batchSize);
+        album->restoreSnapshot(m_selfData, m_total, m_pages);
+        album->setViewIndex(m_viewIndex);
+    }
+
+    // the session could be restored already
+    onConnStatusChanged();
+
+    return wrapper;
+}
+
+void SynoSessionSnapshot::save(SynoAlbum* album, const QVariantList& visibleRows, int viewIndex, qreal contentY)
+{
+    if (!m_isEnabled || !album || !isAuthorized(m_conn)) {
+        return;
+    }
+
+    const int total = album->rowCount(QModelIndex());
+    const int batchSize = album->batchSize();
+
+    QMap< int, QVector<SynoAlbumData> > pages;
+    int itemCount = 0;
+    auto addPage = [&](int pageIndex) {
+        const int offset = pageIndex * batchSize;
+        const int size = qMin(batchSize, total - offset);
+        if (pages.contains(pageIndex) || size <= 0 || itemCount + size > m_maxItems) {
+            return;
+        }
+
+        // only completely loaded pages are persisted
+        QVector<SynoAlbumData> records;
+        records.reserve(size);
+        for (int i = offset; i < offset + size; ++i) {
+            const SynoAlbumData* record = album->peek(i);
+            if (!record) {
+                return;
+            }
+            records.append(*record);
+        }
+
+        pages.insert(pageIndex, records);
+        itemCount += size;
+    };
+
+    // the first page is shown on scrolling to the top, the visible ones restore the position
+    addPage(0);
+
+    QStringList thumbIds;
+    for (const QVariant& value : visibleRows) {
+        const int row = value.toInt();
+        if (row < 0 || row >= total) {
+            continue;
+        }
+
+        addPage(row / batchSize);
+
+        const SynoAlbumData* record = album->peek(row);
+        if (record && thumbIds.size() < m_maxThumbs) {
+            thumbIds.append(record->id);
+        }
+    }
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_15);
+    stream << g_fileMagic << g_fileVersion << scope() << album->path() << album->synoData()
+           << total << batchSize << pages << viewIndex << contentY;
+
+    // thumbnails which are not in memory are loaded from the service as usual
+    QVector< QPair<QString, SynoImageCacheValue> > thumbs;
+    if (SynoImageProvider* provider = SynoImageProvider::instance()) {
+        for (const QString& id : std::as_const(thumbIds)) {
+            SynoImageCacheValue image = provider->cachedThumbnail(id);
+            if (!image.imageData.isEmpty()) {
+                thumbs.append(qMakePair(id, image));
+            }
+        }
+    }
+
+    stream << thumbs.size();
+    for (const QPair<QString, SynoImageCacheValue>& thumb : std::as_const(thumbs)) {
+        stream << thumb.first << thumb.second.imageFormat << thumb.second.imageData;
+    }
+
+    // the application is about to quit, so the file is written at once
+    QSaveFile file(filePath());
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qWarning() << __FUNCTION__ << tr("Cannot write session snapshot: %1. %2")
+                      .arg(file.fileName()).arg(file.errorString());
+    }
+}
+
+void SynoSessionSnapshot::load()
+{
+    QFile file(filePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_15);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+    if (magic != g_fileMagic || version != g_fileVersion) {
+        // written by another version
+        return;
+    }
+
+    stream >> m_scope >> m_path >> m_selfData >> m_total >> m_batchSize >> m_pages >> m_viewIndex >> m_contentY;
+
+    int thumbCount = 0;
+    stream >> thumbCount;
+    QVector< QPair<QString, SynoImageCacheValue> > thumbs;
+    for (int i = 0; i < thumbCount && stream.status() == QDataStream::Ok; ++i) {
+        QPair<QString, SynoImageCacheValue> thumb;
+        stream >> thumb.first >> thumb.second.imageFormat >> thumb.second.imageData;
+        thumbs.append(thumb);
+    }
+
+    if (stream.status() != QDataStream::Ok || m_batchSize <= 0) {
+        qWarning() << __FUNCTION__ << tr("Corrupted session snapshot: %1").arg(file.fileName());
+        m_pages.clear();
+        return;
+    }
+
+    // thumbnails are served from memory, before the session is authorized
+    if (SynoImageProvider* provider = SynoImageProvider::instance()) {
+        for (const QPair<QString, SynoImageCacheValue>& thumb : std::as_const(thumbs)) {
+            provider->insertThumbnail(thumb.first, thumb.second);
+        }
+    }
+
+    m_isAvailable = true;
+}
+
+void SynoSessionSnapshot::onConnStatusChanged()
+{
+    if (!m_isAvailable || !isAuthorized(m_conn)) {
+        return;
+    }
+
+    const bool isDiscarded = (scope() != m_scope);
+    if (m_album) {
+        if (isDiscarded) {
+            // the album is replaced by the views, and is not served from cache anymore
+            SynoAlbumFactory::instance().removeAlbum(m_path);
+        } else {
+            m_album->reconcileSnapshot();
+        }
+    }
+
+    m_isAvailable = false;
+    m_album.clear();
+    m_selfData = SynoAlbumData();
+    m_pages.clear();
+    emit isAvailableChanged();
+
+    if (isDiscarded) {
+        emit discarded();
+    }
+}
+
+QByteArray SynoSessionSnapshot::scope() const
+{
+    return m_conn->synoUrl().toEncoded() + '\n' + m_conn->auth()->username().toUtf8();
+}
+
+QString SynoSessionSnapshot::filePath() const
+{
+    return m_rootDir.absoluteFilePath(QStringLiteral("snapshot"));
+}
@@ -0,0 +1,118 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNOSESSIONSNAPSHOT_H
+#define SYNOSESSIONSNAPSHOT_H
+
+#include "synoalbumdata.h"
+
+#include <QByteArray>
+#include <QDir>
+#include <QMap>
+#include <QObject>
+#include <QPointer>
+#include <QVariantList>
+#include <QVector>
+
+class QJSEngine;
+class QQmlEngine;
+class SynoAlbum;
+class SynoConn;
+
+/*!
+ * \brief Snapshot of the last session, displayed at launch before the session is restored
+ *
+ * On exit the displayed album is persisted with its info, the pages of the visible items,
+ * the scroll position and the small thumbnails of the visible items. At launch the snapshot
+ * is loaded, its album is shown as stale, and nothing is requested for it until the session
+ * is authorized. Then the album is reconciled with the service without resetting the view.
+ * The snapshot of another service or user is discarded.
+ */
+class SynoSessionSnapshot : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(SynoSessionSnapshot)
+
+    Q_PROPERTY(bool isAvailable READ isAvailable NOTIFY isAvailableChanged)
+    Q_PROPERTY(qreal contentY READ contentY NOTIFY isAvailableChanged)
+
+public:
+    /*!
+     * \brief This method returns instance of session snapshot
+     */
+    static SynoSessionSnapshot& instance();
+    static QObject* fromQmlEngine(QQmlEngine* engine, QJSEngine* scriptEngine);
+
+    /*! Returns true if the snapshot is loaded, and is not reconciled nor discarded yet */
+    bool isAvailable() const;
+
+    /*! Returns vertical scroll position of the view */
+    qreal contentY() const;
+
+    /*!
+     * \brief This method returns QmlObjectWrapper with album of the snapshot
+     *
+     * \returns QmlObjectWrapper, or null if the snapshot is not available
+     */
+    Q_INVOKABLE QObject* createAlbum();
+
+    /*!
+     * \brief This method persists the snapshot of the displayed album
+     *
+     * \param album Displayed album
+     * \param visibleRows Album rows of the visible items
+     * \param viewIndex Index of the current item of the view
+     * \param contentY Vertical scroll position of the view
+     */
+    Q_INVOKABLE void save(SynoAlbum* album, const QVariantList& visibleRows, int viewIndex, qreal contentY);
+
+signals:
+    void isAvailableChanged();
+    /*! The snapshot belongs to another service or user, its album should be replaced */
+    void discarded();
+
+protected:
+    SynoSessionSnapshot();
+
+    void load();
+    void onConnStatusChanged();
+    QByteArray scope() const;
+    QString filePath() const;
+
+protected:
+    SynoConn* m_conn;
+    QDir m_rootDir;
+    bool m_isEnabled;
+    /*! Maximum amount of persisted records */
+    int m_maxItems;
+    /*! Maximum amount of persisted thumbnails */
+    int m_maxThumbs;
+    bool m_isAvailable;
+    QByteArray m_scope;
+    QString m_path;
+    SynoAlbumData m_selfData;
+    int m_total;
+    int m_batchSize;
+    QMap< int, QVector<SynoAlbumData> > m_pages;
+    int m_viewIndex;
+    qreal m_contentY;
+    /*! Album showing the snapshot until it is reconciled */
+    QPointer<SynoAlbum> m_album;
+};
+
+#endif // SYNOSESSIONSNAPSHOT_H
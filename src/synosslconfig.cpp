@@ -28,9 +28,12 @@
 #include <QAbstractListModel>
 #include <QByteArray>
 #include <QDataStream>
+#include <QDateTime>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QNetworkRequest>
 #include <QSslCertificate>
+#include <QSslConfiguration>
 #include <QSslError>
 #include <QSslSocket>
 #include <QUrl>
@@ -163,6 +166,9 @@ public:
     void loadAllExceptionsFromStorage(LoadAllExceptionsFromStorageCallback callback,
                                       SynoSettings::SecureFailureCallback callbackFailure = SynoSettings::SecureFailureCallback());
 
+    void warmUpConnections(const QString& hostName, quint16 port);
+    void saveSessionToStorage(const QByteArray& ticket, int lifeTimeHint);
+
 public:
     /*! Connection object */
     SynoConn* conn;
@@ -178,6 +184,20 @@ public:
     QList<QSslError> expectedSslErrors;
     /*! Settings object */
     SynoSettings settings;
+    /*! SSL configuration of the session */
+    QSslConfiguration sslConfiguration;
+    /*! Amount of connections opened in advance */
+    int warmConnections;
+    /*! Session ticket is being loaded from storage */
+    bool isSessionLoading;
+    /*! Number of session load, results of the superseded loads are dropped */
+    quint64 sessionLoadGeneration;
+    /*! Session ticket has been saved for current connection */
+    bool isSessionSaved;
+    /*! Host awaiting connection until session ticket is loaded */
+    QString pendingHostName;
+    /*! Port awaiting connection until session ticket is loaded */
+    quint16 pendingPort;
 };
 
 SynoSslConfig::SynoSslConfig(QNetworkAccessManager* nma, SynoConn* parent)
@@ -195,11 +215,24 @@ SynoSslConfig::SynoSslConfig(QNetworkAccessManager* nma, SynoConn* parent)
 
     d->settings.setGroup(QStringLiteral("ssl"));
 
+    SynoSettings performanceSettings(QStringLiteral("performance"));
+    d->warmConnections = qBound(1, performanceSettings.value(QStringLiteral("sslWarmConnections"), 4).toInt(), 6);
+
+    // session tickets are not kept by default
+    d->sslConfiguration = QSslConfiguration::defaultConfiguration();
+    d->sslConfiguration.setSslOption(QSsl::SslOptionDisableSessionTickets, false);
+    d->sslConfiguration.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+    d->isSessionLoading = false;
+    d->sessionLoadGeneration = 0;
+    d->isSessionSaved = false;
+    d->pendingPort = 0;
+
     connect(d->nma, &QNetworkAccessManager::sslErrors, this, [d](QNetworkReply *reply, const QList<QSslError> &errors) {
         d->onSslErrors(reply, errors);
     });
 
     loadExceptionsFromStorage();
+    loadSessionFromStorage();
 }
 
 bool SynoSslConfig::isSslAvailable() const
@@ -218,7 +251,52 @@ void SynoSslConfig::connectToHostEncrypted(const QString& hostName, quint16 port
 {
     Q_D(SynoSslConfig);
 
-    d->nma->connectToHostEncrypted(hostName, port);
+    d->isSessionSaved = false;
+
+    if (d->isSessionLoading) {
+        // connect once the session ticket is available
+        d->pendingHostName = hostName;
+        d->pendingPort = port;
+    } else {
+        d->warmUpConnections(hostName, port);
+    }
+}
+
+void SynoSslConfig::applySslConfiguration(QNetworkRequest& request) const
+{
+    Q_D(const SynoSslConfig);
+
+    request.setSslConfiguration(d->sslConfiguration);
+}
+
+bool SynoSslConfig::updateSessionTicket(QNetworkReply* reply)
+{
+    Q_D(SynoSslConfig);
+
+    if (d->isSessionSaved) {
+        return false;
+    }
+
+    QSslConfiguration replyConfiguration = reply->sslConfiguration();
+    QByteArray ticket = replyConfiguration.sessionTicket();
+    if (!ticket.isEmpty()) {
+        d->isSessionSaved = true;
+
+        if (ticket != d->sslConfiguration.sessionTicket()) {
+            d->sslConfiguration.setSessionTicket(ticket);
+            d->saveSessionToStorage(ticket, replyConfiguration.sessionTicketLifeTimeHint());
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool SynoSslConfig::isSessionLoading() const
+{
+    Q_D(const SynoSslConfig);
+
+    return d->isSessionLoading;
 }
 
 void SynoSslConfig::clearErrors()
@@ -323,6 +401,90 @@ void SynoSslConfig::saveExceptionsToStorage()
     });
 }
 
+void SynoSslConfig::loadSessionFromStorage()
+{
+    Q_D(SynoSslConfig);
+
+    d->isSessionLoading = true;
+    const quint64 generation = ++d->sessionLoadGeneration;
+
+    auto finishLoading = [this, d]() {
+        d->isSessionLoading = false;
+
+        if (!d->pendingHostName.isEmpty()) {
+            d->warmUpConnections(d->pendingHostName, d->pendingPort);
+            d->pendingHostName.clear();
+            d->pendingPort = 0;
+        }
+
+        emit sessionLoaded();
+    };
+
+    d->settings.readSecureC(QStringLiteral("session"), this,
+                            [d, generation, finishLoading](const QString&, const QString& secureValue) {
+        if (generation != d->sessionLoadGeneration) {
+            // another URL is being loaded
+            return;
+        }
+
+        QByteArray ba = QByteArray::fromHex(secureValue.toUtf8());
+        QDataStream ds(&ba, QIODevice::ReadOnly);
+
+        QUrl url;
+        QByteArray ticket;
+        QDateTime expiry;
+        ds >> url >> ticket >> expiry;
+
+        bool isExpired = expiry.isValid() && expiry < QDateTime::currentDateTimeUtc();
+        if (ds.status() == QDataStream::Ok && url == d->conn->synoUrl() && !isExpired) {
+            d->sslConfiguration.setSessionTicket(ticket);
+        } else {
+            d->sslConfiguration.setSessionTicket(QByteArray());
+        }
+
+        finishLoading();
+    }, [d, generation, finishLoading](const QString&, const QString&) {
+        if (generation != d->sessionLoadGeneration) {
+            return;
+        }
+
+        d->sslConfiguration.setSessionTicket(QByteArray());
+        finishLoading();
+    });
+}
+
+void SynoSslConfigPrivate::warmUpConnections(const QString& hostName, quint16 port)
+{
+    // every call reserves one more channel of the host connection pool
+    for (int i = 0; i < warmConnections; ++i) {
+        nma->connectToHostEncrypted(hostName, port, sslConfiguration);
+    }
+}
+
+void SynoSslConfigPrivate::saveSessionToStorage(const QByteArray& ticket, int lifeTimeHint)
+{
+    Q_Q(SynoSslConfig);
+
+    QDateTime expiry;
+    if (lifeTimeHint > 0) {
+        expiry = QDateTime::currentDateTimeUtc().addSecs(lifeTimeHint);
+    }
+
+    QByteArray ba;
+    ba.reserve(ticket.size() + 256);
+
+    {
+        QDataStream ds(&ba, QIODevice::WriteOnly);
+        ds << conn->synoUrl() << ticket << expiry;
+    }
+
+    QString secureValue = QString::fromUtf8(ba.toHex());
+
+    settings.saveSecureC(QStringLiteral("session"), secureValue, q, SynoSettings::SecureSuccessCallback(), [](const QString&, const QString&) {
+        qWarning() << QObject::tr("TLS session is not stored due to keychain error.");
+    });
+}
+
 void SynoSslConfigPrivate::onSslErrors(QNetworkReply* reply, const QList<QSslError>& errors)
 {
     QList<QSslError> unexpectedSslErrors;
@@ -386,6 +548,24 @@ void SynoSslConfig::connectToHostEncrypted(const QString&, quint16)
 {
 }
 
+void SynoSslConfig::applySslConfiguration(QNetworkRequest&) const
+{
+}
+
+bool SynoSslConfig::updateSessionTicket(QNetworkReply*)
+{
+    return false;
+}
+
+bool SynoSslConfig::isSessionLoading() const
+{
+    return false;
+}
+
+void SynoSslConfig::loadSessionFromStorage()
+{
+}
+
 QObject* SynoSslConfig::errorsModel() const
 {
     return nullptr;
@@ -23,6 +23,8 @@
 #include <QQmlEngine>
 
 class QNetworkAccessManager;
+class QNetworkReply;
+class QNetworkRequest;
 
 class SynoConn;
 class SynoSslConfigPrivate;
@@ -46,9 +48,29 @@ public:
     bool isSslAvailable() const;
     bool isSslError() const;
 
+    /*!
+     * \brief Opens encrypted connections to the host in advance
+     *
+     * Several connections are opened at once, so the first burst of requests
+     * does not wait for TLS handshakes serially. Persisted session ticket is
+     * used for the handshakes if available.
+     */
     void connectToHostEncrypted(const QString &hostName, quint16 port);
     void clearErrors();
 
+    /*! Applies SSL configuration of the session to the request */
+    void applySslConfiguration(QNetworkRequest& request) const;
+
+    /*!
+     * \brief Stores TLS session ticket received with the reply for resumption on next launch
+     *
+     * \returns True if SSL configuration of the session is changed
+     */
+    bool updateSessionTicket(QNetworkReply* reply);
+
+    /*! Returns true while the persisted session ticket is being loaded from storage */
+    bool isSessionLoading() const;
+
     QObject* errorsModel() const;
     QObject* expectedErrorsModel() const;
 
@@ -56,10 +78,13 @@ public slots:
     void confirmSslExceptions();
     void loadExceptionsFromStorage();
     void saveExceptionsToStorage();
+    void loadSessionFromStorage();
 
 signals:
     void isSslErrorChanged();
     void confirmedSslExceptions();
+    /*! Persisted session ticket is loaded, or found missing */
+    void sessionLoaded();
 
     // those signals are never emitted, it is added to suppress
     // Qt warning about non-NOTIFYable properties
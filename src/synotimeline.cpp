@@ -0,0 +1,285 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synotimeline.h"
+#include "synolibraryindex.h"
+
+#include <QFutureWatcher>
+#include <QPair>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <limits>
+
+static constexpr qint64 g_epochJulianDay = 2440588;
+static constexpr qint64 g_secsPerDay = 86400;
+
+// capture time is the wall clock time given in UTC, so days are counted without time zone
+static inline qint64 dayOfTime(qint64 time)
+{
+    return (time >= 0) ? time / g_secsPerDay : (time - g_secsPerDay + 1) / g_secsPerDay;
+}
+
+SynoTimeline& SynoTimeline::instance()
+{
+    static SynoTimeline i;
+    return i;
+}
+
+SynoTimeline::SynoTimeline()
+    : QObject()
+    , m_mergeGeneration(0)
+{
+    m_mergeTimer.setSingleShot(true);
+    m_mergeTimer.setInterval(1000);
+    connect(&m_mergeTimer, &QTimer::timeout, this, &SynoTimeline::startMerge);
+
+    SynoLibraryIndex& libraryIndex = SynoLibraryIndex::instance();
+    connect(&libraryIndex, &SynoLibraryIndex::loaded, this, &SynoTimeline::onIndexLoaded);
+    connect(&libraryIndex, &SynoLibraryIndex::albumChanged, this, &SynoTimeline::onAlbumChanged);
+
+    if (libraryIndex.isLoaded()) {
+        onIndexLoaded();
+    }
+}
+
+int SynoTimeline::itemCount() const
+{
+    return m_columns.items.times.size();
+}
+
+QString SynoTimeline::itemId(int position) const
+{
+    return m_columns.items.ids.value(position);
+}
+
+qint64 SynoTimeline::itemTime(int position) const
+{
+    return m_columns.items.times.value(position);
+}
+
+int SynoTimeline::bucketCount(Granularity granularity) const
+{
+    return m_columns.bucketKeys[granularity].size();
+}
+
+SynoTimeline::Bucket SynoTimeline::bucket(Granularity granularity, int index) const
+{
+    const QVector<qint32>& keys = m_columns.bucketKeys[granularity];
+    const QVector<int>& offsets = m_columns.bucketOffsets[granularity];
+    if (index < 0 || index >= keys.size()) {
+        return Bucket();
+    }
+
+    Bucket result;
+    result.date = bucketDate(granularity, keys[index]);
+    result.offset = offsets[index];
+    result.count = ((index + 1 < offsets.size()) ? offsets[index + 1] : itemCount()) - result.offset;
+    return result;
+}
+
+int SynoTimeline::bucketIndex(Granularity granularity, const QDate& date) const
+{
+    const QVector<qint32>& keys = m_columns.bucketKeys[granularity];
+    if (keys.isEmpty() || !date.isValid()) {
+        return -1;
+    }
+
+    auto iter = std::lower_bound(keys.constBegin(), keys.constEnd(), bucketKey(granularity, date));
+    return std::min(static_cast<int>(iter - keys.constBegin()), keys.size() - 1);
+}
+
+SynoTimeline::ItemColumns SynoTimeline::albumColumns(const QVector<SynoAlbumData>& items)
+{
+    QVector<QPair<qint64, QString>> datedItems;
+    for (const SynoAlbumData& item : items) {
+        if (item.takenTime()) {
+            datedItems.append(qMakePair(item.takenTime(), item.id));
+        }
+    }
+
+    std::sort(datedItems.begin(), datedItems.end());
+
+    ItemColumns columns;
+    columns.times.reserve(datedItems.size());
+    columns.ids.reserve(datedItems.size());
+    for (const QPair<qint64, QString>& datedItem : std::as_const(datedItems)) {
+        columns.times.append(datedItem.first);
+        columns.ids.append(datedItem.second);
+    }
+
+    return columns;
+}
+
+SynoTimeline::Columns SynoTimeline::merge(const QHash<QByteArray, ItemColumns>& albums)
+{
+    // albums are sorted already, so they are merged through a heap of their cursors
+    struct Cursor
+    {
+        const ItemColumns* album;
+        int albumIndex;
+        int pos;
+    };
+
+    QVector<Cursor> heap;
+    heap.reserve(albums.size());
+    int totalCount = 0;
+    int albumIndex = 0;
+    for (const ItemColumns& album : albums) {
+        totalCount += album.times.size();
+        if (!album.times.isEmpty()) {
+            heap.append(Cursor{&album, albumIndex, 0});
+        }
+        ++albumIndex;
+    }
+
+    // the earliest item is on top, items of the same time are taken in album order
+    auto isLater = [](const Cursor& a, const Cursor& b) {
+        const qint64 timeA = a.album->times.at(a.pos);
+        const qint64 timeB = b.album->times.at(b.pos);
+        return (timeA != timeB) ? timeA > timeB : a.albumIndex > b.albumIndex;
+    };
+    std::make_heap(heap.begin(), heap.end(), isLater);
+
+    Columns columns;
+    columns.items.times.reserve(totalCount);
+    columns.items.ids.reserve(totalCount);
+
+    qint64 lastDay = std::numeric_limits<qint64>::min();
+    while (!heap.isEmpty()) {
+        std::pop_heap(heap.begin(), heap.end(), isLater);
+        Cursor& cursor = heap.last();
+
+        const int pos = columns.items.times.size();
+        const qint64 time = cursor.album->times.at(cursor.pos);
+        columns.items.times.append(time);
+        columns.items.ids.append(cursor.album->ids.at(cursor.pos));
+
+        if (++cursor.pos < cursor.album->times.size()) {
+            std::push_heap(heap.begin(), heap.end(), isLater);
+        } else {
+            heap.removeLast();
+        }
+
+        // items are sorted, so buckets change only with the day
+        const qint64 day = dayOfTime(time);
+        if (day == lastDay) {
+            continue;
+        }
+        lastDay = day;
+
+        const QDate date = QDate::fromJulianDay(day + g_epochJulianDay);
+        for (int granularity = 0; granularity < GranularityCount; ++granularity) {
+            const qint32 key = bucketKey(static_cast<Granularity>(granularity), date);
+            QVector<qint32>& keys = columns.bucketKeys[granularity];
+            if (keys.isEmpty() || keys.last() != key) {
+                keys.append(key);
+                columns.bucketOffsets[granularity].append(pos);
+            }
+        }
+    }
+
+    return columns;
+}
+
+qint32 SynoTimeline::bucketKey(Granularity granularity, const QDate& date)
+{
+    switch (granularity) {
+    case Year:
+        return date.year();
+    case Month:
+        return date.year() * 12 + date.month() - 1;
+    case Day:
+        break;
+    }
+
+    return static_cast<qint32>(date.toJulianDay() - g_epochJulianDay);
+}
+
+QDate SynoTimeline::bucketDate(Granularity granularity, qint32 key)
+{
+    switch (granularity) {
+    case Year:
+        return QDate(key, 1, 1);
+    case Month: {
+        // floor division, years before Christ are negative
+        const int year = (key >= 0) ? key / 12 : (key - 11) / 12;
+        return QDate(year, key - year * 12 + 1, 1);
+    }
+    case Day:
+        break;
+    }
+
+    return QDate::fromJulianDay(key + g_epochJulianDay);
+}
+
+void SynoTimeline::onIndexLoaded()
+{
+    m_albums.clear();
+
+    const QHash<QByteArray, QVector<SynoAlbumData>>& albums = SynoLibraryIndex::instance().albums();
+    for (auto iter = albums.constBegin(); iter != albums.constEnd(); ++iter) {
+        ItemColumns columns = albumColumns(iter.value());
+        if (!columns.times.isEmpty()) {
+            m_albums.insert(iter.key(), columns);
+        }
+    }
+
+    startMerge();
+}
+
+void SynoTimeline::onAlbumChanged(const QByteArray& albumId)
+{
+    ItemColumns columns = albumColumns(SynoLibraryIndex::instance().albumItems(albumId));
+    if (columns.times.isEmpty()) {
+        if (!m_albums.remove(albumId)) {
+            return;
+        }
+    } else {
+        m_albums.insert(albumId, columns);
+    }
+
+    if (!m_mergeTimer.isActive()) {
+        m_mergeTimer.start();
+    }
+}
+
+void SynoTimeline::startMerge()
+{
+    m_mergeTimer.stop();
+    const quint64 generation = ++m_mergeGeneration;
+
+    auto* watcher = new QFutureWatcher<Columns>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, generation]() {
+        Columns columns = watcher->result();
+        watcher->deleteLater();
+
+        if (generation != m_mergeGeneration) {
+            return;
+        }
+
+        m_columns = std::move(columns);
+        emit changed();
+    });
+
+    // album columns are implicitly shared, the snapshot is not affected by later changes
+    QHash<QByteArray, ItemColumns> albums = m_albums;
+    watcher->setFuture(QtConcurrent::run([albums]() {
+        return merge(albums);
+    }));
+}
@@ -0,0 +1,131 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNOTIMELINE_H
+#define SYNOTIMELINE_H
+
+#include "synoalbumdata.h"
+
+#include <QByteArray>
+#include <QDate>
+#include <QHash>
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+
+/*!
+ * \brief Aggregation of library items by capture date
+ *
+ * Dated items of SynoLibraryIndex are kept in columns sorted by capture time:
+ * times and ids are stored in separate arrays. Year, month and day buckets
+ * are runs of these arrays, stored as bucket keys and offsets of the first items.
+ *
+ * Sorted columns of each album are updated as the album changes in the index,
+ * and merged into the library columns in background shortly after.
+ *
+ * This class should be used from GUI thread only.
+ */
+class SynoTimeline : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(SynoTimeline)
+
+public:
+    enum Granularity
+    {
+        Year = 0,
+        Month,
+        Day
+    };
+    Q_ENUM(Granularity)
+
+    struct Bucket
+    {
+        /*! First day of the bucket */
+        QDate date;
+        /*! Position of the first item of the bucket */
+        int offset = 0;
+        int count = 0;
+    };
+
+public:
+    /*!
+     * \brief This method returns instance of timeline
+     */
+    static SynoTimeline& instance();
+
+    /*! Returns amount of dated items */
+    int itemCount() const;
+    /*! Returns id of the item at the position in capture time order */
+    QString itemId(int position) const;
+    /*! Returns capture time of the item at the position, in seconds since epoch */
+    qint64 itemTime(int position) const;
+
+    int bucketCount(Granularity granularity) const;
+    Bucket bucket(Granularity granularity, int index) const;
+    /*!
+     * \brief Returns index of the bucket containing the date
+     *
+     * If there is no such bucket, the closest later one is returned, or the last one.
+     * Returns -1 if the timeline is empty.
+     */
+    int bucketIndex(Granularity granularity, const QDate& date) const;
+
+signals:
+    /*! Emitted when the buckets are changed */
+    void changed();
+
+private:
+    static constexpr int GranularityCount = Day + 1;
+
+    /*! Dated items sorted by capture time */
+    struct ItemColumns
+    {
+        QVector<qint64> times;
+        QVector<QString> ids;
+    };
+
+    struct Columns
+    {
+        ItemColumns items;
+        /*! Bucket keys and offsets of the first items, per granularity */
+        QVector<qint32> bucketKeys[GranularityCount];
+        QVector<int> bucketOffsets[GranularityCount];
+    };
+
+    SynoTimeline();
+
+    static ItemColumns albumColumns(const QVector<SynoAlbumData>& items);
+    static Columns merge(const QHash<QByteArray, ItemColumns>& albums);
+    static qint32 bucketKey(Granularity granularity, const QDate& date);
+    static QDate bucketDate(Granularity granularity, qint32 key);
+
+    void onIndexLoaded();
+    void onAlbumChanged(const QByteArray& albumId);
+    void startMerge();
+
+private:
+    QHash<QByteArray, ItemColumns> m_albums;
+    Columns m_columns;
+    /*! Timer of postponed merge, changes of many albums are merged at once */
+    QTimer m_mergeTimer;
+    /*! Incremented on each merge, to discard outdated one */
+    quint64 m_mergeGeneration;
+};
+
+#endif // SYNOTIMELINE_H
@@ -0,0 +1,152 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synotimelinemodel.h"
+
+#include <QLocale>
+
+#include <algorithm>
+
+SynoTimelineModel::SynoTimelineModel(QObject* parent)
+    : QAbstractListModel(parent)
+    , m_granularity(Month)
+{
+    SynoTimeline& timeline = SynoTimeline::instance();
+    m_count = timeline.bucketCount(SynoTimeline::Granularity(m_granularity));
+
+    connect(&timeline, &SynoTimeline::changed, this, [this]() {
+        const int oldCount = m_count;
+
+        beginResetModel();
+        m_count = SynoTimeline::instance().bucketCount(SynoTimeline::Granularity(m_granularity));
+        endResetModel();
+
+        if (m_count != oldCount) {
+            emit countChanged();
+        }
+    });
+}
+
+QHash<int, QByteArray> SynoTimelineModel::roleNames() const
+{
+    QHash<int, QByteArray> roles = QAbstractListModel::roleNames();
+    roles.insert(RoleDate, QByteArrayLiteral("date"));
+    roles.insert(RoleCount, QByteArrayLiteral("itemCount"));
+    roles.insert(RoleCoverId, QByteArrayLiteral("coverId"));
+    return roles;
+}
+
+int SynoTimelineModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+
+    return m_count;
+}
+
+QVariant SynoTimelineModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_count) {
+        return QVariant();
+    }
+
+    const SynoTimeline::Bucket bucket = bucketAt(index.row());
+
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (m_granularity) {
+        case Year:
+            return QString::number(bucket.date.year());
+        case Month:
+            return QLocale().toString(bucket.date, QStringLiteral("MMMM yyyy"));
+        case Day:
+            return QLocale().toString(bucket.date, QLocale::ShortFormat);
+        }
+        break;
+    case RoleDate:
+        return bucket.date;
+    case RoleCount:
+        return bucket.count;
+    case RoleCoverId:
+        // the latest item, as the rows are ordered newest first
+        return SynoTimeline::instance().itemId(bucket.offset + bucket.count - 1);
+    default:
+        break;
+    }
+
+    return QVariant();
+}
+
+int SynoTimelineModel::indexOfDate(const QDate& date) const
+{
+    const int bucketIndex = SynoTimeline::instance().bucketIndex(SynoTimeline::Granularity(m_granularity), date);
+    return (bucketIndex < 0) ? -1 : m_count - 1 - bucketIndex;
+}
+
+QStringList SynoTimelineModel::itemIds(int row, int maxCount) const
+{
+    QStringList ids;
+    if (row < 0 || row >= m_count) {
+        return ids;
+    }
+
+    const SynoTimeline::Bucket bucket = bucketAt(row);
+    const int count = (maxCount < 0) ? bucket.count : std::min(maxCount, bucket.count);
+
+    const SynoTimeline& timeline = SynoTimeline::instance();
+    ids.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        ids.append(timeline.itemId(bucket.offset + i));
+    }
+
+    return ids;
+}
+
+SynoTimelineModel::Granularity SynoTimelineModel::granularity() const
+{
+    return m_granularity;
+}
+
+void SynoTimelineModel::setGranularity(Granularity granularity)
+{
+    if (granularity != m_granularity) {
+        const int oldCount = m_count;
+
+        beginResetModel();
+        m_granularity = granularity;
+        m_count = SynoTimeline::instance().bucketCount(SynoTimeline::Granularity(m_granularity));
+        endResetModel();
+
+        emit granularityChanged();
+        if (m_count != oldCount) {
+            emit countChanged();
+        }
+    }
+}
+
+int SynoTimelineModel::count() const
+{
+    return m_count;
+}
+
+SynoTimeline::Bucket SynoTimelineModel::bucketAt(int row) const
+{
+    // rows are ordered newest first
+    return SynoTimeline::instance().bucket(SynoTimeline::Granularity(m_granularity), m_count - 1 - row);
+}
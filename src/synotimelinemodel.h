@@ -0,0 +1,103 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNOTIMELINEMODEL_H
+#define SYNOTIMELINEMODEL_H
+
+#include <QAbstractListModel>
+#include <QDate>
+#include <QQmlEngine>
+#include <QStringList>
+
+#include "synotimeline.h"
+
+/*!
+ * \brief Model of timeline buckets of the whole library
+ *
+ * Each row is a year, month or day with the amount of items captured in it,
+ * newest first. The buckets are read from SynoTimeline, without network requests.
+ */
+class SynoTimelineModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+    QML_ELEMENT
+
+    Q_PROPERTY(Granularity granularity READ granularity WRITE setGranularity NOTIFY granularityChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    enum Granularity
+    {
+        Year = SynoTimeline::Year,
+        Month = SynoTimeline::Month,
+        Day = SynoTimeline::Day
+    };
+    Q_ENUM(Granularity)
+
+    enum SynoTimelineRoles
+    {
+        RoleDate = Qt::UserRole + 1,
+        RoleCount,
+        /*! Id of the first item of the bucket, suitable for the thumbnail image provider */
+        RoleCoverId
+    };
+    Q_ENUM(SynoTimelineRoles)
+
+public:
+    explicit SynoTimelineModel(QObject* parent = nullptr);
+
+    QHash<int, QByteArray> roleNames() const override;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    /*!
+     * \brief This method returns the row of the bucket containing the date.
+     *
+     * If there is no such bucket, the row of the closest later bucket is returned.
+     *
+     * \returns Row of the bucket, or -1 if the model is empty
+     */
+    Q_INVOKABLE int indexOfDate(const QDate& date) const;
+
+    /*!
+     * \brief This method returns ids of the items of the bucket, in capture time order.
+     *
+     * \param row Row of the bucket
+     * \param maxCount Maximum amount of ids, or negative value for all
+     */
+    Q_INVOKABLE QStringList itemIds(int row, int maxCount = -1) const;
+
+    Granularity granularity() const;
+    void setGranularity(Granularity granularity);
+
+    int count() const;
+
+signals:
+    void granularityChanged();
+    void countChanged();
+
+private:
+    SynoTimeline::Bucket bucketAt(int row) const;
+
+private:
+    Granularity m_granularity;
+    int m_count;
+};
+
+#endif // SYNOTIMELINEMODEL_H
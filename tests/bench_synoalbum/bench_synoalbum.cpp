@@ -0,0 +1,411 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synoalbum.h"
+#include "synoalbumdata.h"
+#include "synoconn.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThreadPool>
+#include <QtTest>
+
+#if defined(Q_OS_LINUX)
+#include <unistd.h>
+#endif
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+/*!
+ * \brief Album item record as it was before the compact representation
+ *
+ * Every value is a string of its own, flags are separate booleans,
+ * so the peak memory of compact records is compared against it.
+ */
+struct LooseAlbumData
+{
+    QString id;
+    QString name;
+    QString path;
+    QString sharepath;
+    QString title;
+    QString description;
+    int hits = 0;
+    QString info_type;
+    bool conversion = false;
+    bool allow_comment = false;
+    bool allow_embed = false;
+    QString type;
+    bool perm_browse = false;
+    bool perm_upload = false;
+    bool perm_manage = false;
+    QString file_location;
+    QSize thumb_preview_size;
+    int thumb_preview_mtime = 0;
+    QSize thumb_small_size;
+    int thumb_small_mtime = 0;
+    QSize thumb_large_size;
+    int thumb_large_mtime = 0;
+    QString thumb_sig;
+    QStringList thumbnail_status;
+};
+
+/*!
+ * \brief Measures item storage and data access of SynoAlbum
+ *
+ * The album is filled with 50,000 synthetic records, the way a session snapshot
+ * is restored, so nothing is requested from the service. Heap memory in use and
+ * reset time, deallocation included, are compared with the flat layout the items
+ * were stored in before: a vector of records allocated one by one.
+ *
+ * Resident memory of 100,000 complete records is measured for compact records
+ * and for the loose ones, with values allocated per record as a parser does.
+ */
+class BenchSynoAlbum : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void memoryPerItem_data();
+    void memoryPerItem();
+    void reset_data();
+    void reset();
+    void dataSynoDataRole();
+    void dataItemRoles();
+    void residentSizePerItem_data();
+    void residentSizePerItem();
+
+private:
+    void fill();
+    QMap< int, QVector<SynoAlbumData> > records() const;
+    static QVector<SynoAlbumData*> flatRecords(const QMap< int, QVector<SynoAlbumData> >& pages);
+    static qint64 heapInUse();
+    template <typename T, typename F>
+    static qint64 residentSizeOfPages(F record);
+    static SynoAlbumData compactRecord(int n);
+    static LooseAlbumData looseRecord(int n);
+    static qint64 residentSize();
+
+private:
+    SynoConn* m_conn = nullptr;
+    SynoAlbum* m_album = nullptr;
+};
+
+static constexpr int g_itemCount = 50000;
+static constexpr int g_residentItemCount = 100000;
+
+void BenchSynoAlbum::initTestCase()
+{
+    m_conn = new SynoConn(this);
+    m_album = new SynoAlbum(m_conn, QStringLiteral("/Library"), this);
+}
+
+void BenchSynoAlbum::cleanupTestCase()
+{
+    delete m_album;
+    delete m_conn;
+}
+
+void BenchSynoAlbum::memoryPerItem_data()
+{
+    QTest::addColumn<bool>("isPaged");
+
+    QTest::newRow("album pages") << true;
+    QTest::newRow("flat vector") << false;
+}
+
+void BenchSynoAlbum::memoryPerItem()
+{
+    QFETCH(bool, isPaged);
+
+    if (heapInUse() < 0) {
+        QSKIP("Heap counters are not available");
+    }
+
+    // everything the storage holds is counted, records and their strings included
+    m_album->clear();
+    QThreadPool::globalInstance()->waitForDone();
+
+    const qint64 baseSize = heapInUse();
+    qint64 size = 0;
+    if (isPaged) {
+        fill();
+        QVERIFY(m_album->isLoaded());
+        size = heapInUse() - baseSize;
+    } else {
+        QVector<SynoAlbumData*> flat = flatRecords(records());
+        size = heapInUse() - baseSize;
+        qDeleteAll(flat);
+    }
+
+    QTest::setBenchmarkResult(static_cast<qreal>(size) / g_itemCount, QTest::BytesAllocated);
+}
+
+void BenchSynoAlbum::reset_data()
+{
+    memoryPerItem_data();
+}
+
+void BenchSynoAlbum::reset()
+{
+    QFETCH(bool, isPaged);
+
+    // the reset is timed until the records are released, also by worker threads; the storage is built again before each run
+    static constexpr int runs = 10;
+    qint64 elapsedNs = 0;
+    for (int run = 0; run < runs; ++run) {
+        if (isPaged) {
+            fill();
+            QThreadPool::globalInstance()->waitForDone();
+
+            QElapsedTimer elapsedTimer;
+            elapsedTimer.start();
+            m_album->clear();
+            QThreadPool::globalInstance()->waitForDone();
+            elapsedNs += elapsedTimer.nsecsElapsed();
+
+            QCOMPARE(m_album->rowCount(QModelIndex()), 0);
+        } else {
+            QVector<SynoAlbumData*> flat = flatRecords(records());
+
+            QElapsedTimer elapsedTimer;
+            elapsedTimer.start();
+            qDeleteAll(flat);
+            flat.clear();
+            elapsedNs += elapsedTimer.nsecsElapsed();
+        }
+    }
+
+    QTest::setBenchmarkResult(elapsedNs / 1e6 / runs, QTest::WalltimeMilliseconds);
+}
+
+void BenchSynoAlbum::dataSynoDataRole()
+{
+    // delegates read the fields they bind from the whole record
+    fill();
+
+    int checksum = 0;
+    QBENCHMARK {
+        for (int row = 0; row < g_itemCount; row += 10) {
+            const QModelIndex index = m_album->index(row);
+            const SynoAlbumData record = m_album->data(index, SynoAlbum::RoleSynoData).value<SynoAlbumData>();
+            checksum += record.id.size() + record.type().size() + record.thumb_small_size.width();
+        }
+    }
+
+    QVERIFY(checksum > 0);
+}
+
+void BenchSynoAlbum::dataItemRoles()
+{
+    // delegates read the fields they bind through dedicated roles
+    fill();
+
+    int checksum = 0;
+    QBENCHMARK {
+        for (int row = 0; row < g_itemCount; row += 10) {
+            const QModelIndex index = m_album->index(row);
+            checksum += m_album->data(index, SynoAlbum::RoleId).toString().size()
+                      + m_album->data(index, SynoAlbum::RoleType).toString().size()
+                      + m_album->data(index, SynoAlbum::RoleThumbSmallSize).toSize().width();
+        }
+    }
+
+    QVERIFY(checksum > 0);
+}
+
+void BenchSynoAlbum::residentSizePerItem_data()
+{
+    QTest::addColumn<bool>("isCompact");
+
+    QTest::newRow("compact records") << true;
+    QTest::newRow("loose records") << false;
+}
+
+void BenchSynoAlbum::residentSizePerItem()
+{
+    QFETCH(bool, isCompact);
+
+    if (residentSize() < 0) {
+        QSKIP("Resident size is not available");
+    }
+
+    // the interned values are shared by all records, they are created once before the measurement
+    compactRecord(0);
+
+    const qint64 size = isCompact ? residentSizeOfPages<SynoAlbumData>(compactRecord)
+                                  : residentSizeOfPages<LooseAlbumData>(looseRecord);
+    QVERIFY(size > 0);
+
+    QTest::setBenchmarkResult(static_cast<qreal>(size) / g_residentItemCount, QTest::BytesAllocated);
+}
+
+template <typename T, typename F>
+qint64 BenchSynoAlbum::residentSizeOfPages(F record)
+{
+#if defined(__GLIBC__)
+    // the memory released by the previous measurement is returned, so it is not reused
+    malloc_trim(0);
+#endif
+
+    const qint64 baseSize = residentSize();
+
+    // records are stored in pages of the batch size, as the album does
+    const int batchSize = 50;
+    QVector< QVector<T> > pages((g_residentItemCount + batchSize - 1) / batchSize);
+    for (int pageIndex = 0; pageIndex < pages.size(); ++pageIndex) {
+        QVector<T>& page = pages[pageIndex];
+        page.reserve(batchSize);
+        for (int n = pageIndex * batchSize; n < std::min(g_residentItemCount, (pageIndex + 1) * batchSize); ++n) {
+            page.append(record(n));
+        }
+    }
+
+    return residentSize() - baseSize;
+}
+
+SynoAlbumData BenchSynoAlbum::compactRecord(int n)
+{
+    const QString number = QString::number(n);
+    const QString name = QStringLiteral("IMG_") + number + QStringLiteral(".JPG");
+
+    SynoAlbumData record;
+    record.id = QStringLiteral("photo_4c6962726172792f32303139_") + number;
+    record.name = name;
+    record.title = QStringLiteral("IMG_") + number;
+    record.description = QStringLiteral("Trip to the mountains, day ") + number;
+    record.thumb_sig = QStringLiteral("c2lnXzAwMDAw") + number;
+    record.hits = n;
+    record.setType(QString::fromLatin1("photo"));
+    record.setInfoType(QString::fromLatin1("photo"));
+    record.setSharepath(QString::fromLatin1("Library/2019"));
+    record.setFileLocation(QString::fromLatin1("/volume1/photo/Library/2019/") + name);
+    record.setThumbnailStatus(QString::fromLatin1("small,large"));
+    record.setTakenDate(QString::fromLatin1("2019-07-14 10:21:00"));
+    record.setConversion(true);
+    record.setPermBrowse(true);
+    record.thumb_preview_size = QSize(120, 80);
+    record.thumb_small_size = QSize(320, 213);
+    record.thumb_large_size = QSize(1280, 853);
+    return record;
+}
+
+LooseAlbumData BenchSynoAlbum::looseRecord(int n)
+{
+    const QString number = QString::number(n);
+    const QString name = QStringLiteral("IMG_") + number + QStringLiteral(".JPG");
+
+    LooseAlbumData record;
+    record.id = QStringLiteral("photo_4c6962726172792f32303139_") + number;
+    record.name = name;
+    record.title = QStringLiteral("IMG_") + number;
+    record.description = QStringLiteral("Trip to the mountains, day ") + number;
+    record.thumb_sig = QStringLiteral("c2lnXzAwMDAw") + number;
+    record.hits = n;
+    record.type = QString::fromLatin1("photo");
+    record.info_type = QString::fromLatin1("photo");
+    record.sharepath = QString::fromLatin1("Library/2019");
+    record.file_location = QString::fromLatin1("/volume1/photo/Library/2019/") + name;
+    record.path = QString::fromLatin1("/volume1/photo/Library/2019/") + name;
+    record.thumbnail_status = QString::fromLatin1("small,large").split(QLatin1Char(','));
+    record.conversion = true;
+    record.perm_browse = true;
+    record.thumb_preview_size = QSize(120, 80);
+    record.thumb_small_size = QSize(320, 213);
+    record.thumb_large_size = QSize(1280, 853);
+    return record;
+}
+
+qint64 BenchSynoAlbum::residentSize()
+{
+#if defined(Q_OS_LINUX)
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (statm.open(QIODevice::ReadOnly)) {
+        // the second field is the resident set size in pages
+        const QList<QByteArray> fields = statm.readAll().split(' ');
+        return fields.value(1).toLongLong() * sysconf(_SC_PAGESIZE);
+    }
+#endif
+
+    return -1;
+}
+
+void BenchSynoAlbum::fill()
+{
+    m_album->restoreSnapshot(SynoAlbumData(), g_itemCount, records());
+}
+
+QMap< int, QVector<SynoAlbumData> > BenchSynoAlbum::records() const
+{
+    // records are created for each fill, so the storage is their only owner
+    const int batchSize = m_album->batchSize();
+    QMap< int, QVector<SynoAlbumData> > pages;
+    for (int offset = 0; offset < g_itemCount; offset += batchSize) {
+        QVector<SynoAlbumData> records(qMin(batchSize, g_itemCount - offset));
+        for (int i = 0; i < records.size(); ++i) {
+            const QString n = QString::number(offset + i);
+            SynoAlbumData& record = records[i];
+            record.id = QStringLiteral("photo_4c6962726172792f32303139_") + n;
+            record.name = QStringLiteral("IMG_") + n + QStringLiteral(".JPG");
+            record.title = QStringLiteral("IMG_") + n;
+            record.description = QStringLiteral("Trip to the mountains, day ") + n;
+            record.thumb_sig = QStringLiteral("c2lnXzAwMDAw") + n;
+        }
+
+        pages.insert(offset / batchSize, records);
+    }
+
+    return pages;
+}
+
+QVector<SynoAlbumData*> BenchSynoAlbum::flatRecords(const QMap< int, QVector<SynoAlbumData> >& pages)
+{
+    // each record is allocated on its own, it takes over the strings once the pages are released
+    QVector<SynoAlbumData*> flat;
+    flat.reserve(g_itemCount);
+    for (const QVector<SynoAlbumData>& page : pages) {
+        for (const SynoAlbumData& record : page) {
+            flat.append(new SynoAlbumData(record));
+        }
+    }
+
+    return flat;
+}
+
+qint64 BenchSynoAlbum::heapInUse()
+{
+    // allocated bytes of all arenas, and of the chunks mapped separately
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    const struct mallinfo2 info = mallinfo2();
+    return static_cast<qint64>(info.uordblks + info.hblkhd);
+#elif defined(__GLIBC__)
+    const struct mallinfo info = mallinfo();
+    return static_cast<qint64>(info.uordblks) + info.hblkhd;
+#else
+    return -1;
+#endif
+}
+
+QTEST_GUILESS_MAIN(BenchSynoAlbum)
+
+#include "bench_synoalbum.moc"
@@ -0,0 +1,298 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synoalbum.h"
+#include "synoalbumreplycache.h"
+#include "synoconn.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QQueue>
+#include <QStandardPaths>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrlQuery>
+#include <QtTest>
+
+/*!
+ * \brief Measures time to fill an album of 10,000 items over a slow link
+ *
+ * QTcpServer is the HTTP stand-in of the service, it replies to each request
+ * after the simulated round trip time. The view scrolls through the album
+ * page by page, the album is filled once every item is received.
+ */
+class BenchSynoAlbumFill : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void timeToFill_data();
+    void timeToFill();
+    void batchSizeChange();
+
+private:
+    qint64 fill(SynoAlbum* album);
+    void onNewConnection();
+    void onReadyRead(QTcpSocket* socket);
+    QByteArray replyBody(const QByteArray& requestBody);
+    static QByteArray listReply(int offset, int limit);
+
+private:
+    QTcpServer m_server;
+    SynoConn* m_conn = nullptr;
+    int m_latencyMs = 0;
+    int m_listRequestCount = 0;
+    QHash<QTcpSocket*, QByteArray> m_buffers;
+    QHash<QTcpSocket*, QQueue<QByteArray>> m_responses;
+};
+
+static constexpr int g_itemCount = 10000;
+static constexpr int g_fillTimeoutMs = 120000;
+
+void BenchSynoAlbumFill::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+
+    connect(&m_server, &QTcpServer::newConnection, this, &BenchSynoAlbumFill::onNewConnection);
+    QVERIFY(m_server.listen(QHostAddress::LocalHost));
+
+    m_conn = new SynoConn(this);
+    m_conn->connectToSyno(QUrl(QStringLiteral("http://localhost:%1/photo").arg(m_server.serverPort())));
+    QTRY_COMPARE(m_conn->status(), SynoConn::API_LOADED);
+}
+
+void BenchSynoAlbumFill::cleanupTestCase()
+{
+    delete m_conn;
+    m_server.close();
+}
+
+void BenchSynoAlbumFill::timeToFill_data()
+{
+    QTest::addColumn<int>("latencyMs");
+    QTest::addColumn<int>("batchSize");
+
+    QTest::newRow("rtt 20 ms, 50 items") << 20 << 50;
+    QTest::newRow("rtt 20 ms, 200 items") << 20 << 200;
+    QTest::newRow("rtt 100 ms, 50 items") << 100 << 50;
+    QTest::newRow("rtt 100 ms, 200 items") << 100 << 200;
+}
+
+void BenchSynoAlbumFill::timeToFill()
+{
+    QFETCH(int, latencyMs);
+    QFETCH(int, batchSize);
+
+    // every item is requested from the service
+    SynoAlbumReplyCache::instance().clear();
+    m_latencyMs = latencyMs;
+    m_listRequestCount = 0;
+
+    SynoAlbum album(m_conn, QStringLiteral("/Library"));
+    album.setBatchSize(batchSize);
+
+    const qint64 elapsedMs = fill(&album);
+    QVERIFY(album.isLoaded());
+    QCOMPARE(m_listRequestCount, (g_itemCount + batchSize - 1) / batchSize);
+
+    QTest::setBenchmarkResult(elapsedMs, QTest::WalltimeMilliseconds);
+}
+
+void BenchSynoAlbumFill::batchSizeChange()
+{
+    // the pages of another size are served from the replies cached with the previous one
+    SynoAlbumReplyCache::instance().clear();
+    m_latencyMs = 50;
+
+    SynoAlbum album(m_conn, QStringLiteral("/Library"));
+    album.setBatchSize(50);
+    fill(&album);
+    QVERIFY(album.isLoaded());
+
+    m_listRequestCount = 0;
+    const quint64 hitCount = SynoAlbumReplyCache::instance().hitCount();
+
+    QElapsedTimer elapsedTimer;
+    elapsedTimer.start();
+    album.setBatchSize(200);
+    QCOMPARE(album.rowCount(QModelIndex()), g_itemCount);
+    for (int row = 0; row < g_itemCount; row += album.batchSize()) {
+        album.data(album.index(row), SynoAlbum::RoleId);
+    }
+    QTRY_VERIFY_WITH_TIMEOUT(album.isLoaded(), g_fillTimeoutMs);
+    const qint64 elapsedMs = elapsedTimer.elapsed();
+
+    QCOMPARE(m_listRequestCount, 0);
+    QCOMPARE(SynoAlbumReplyCache::instance().hitCount() - hitCount, static_cast<quint64>(g_itemCount / 200));
+
+    QTest::setBenchmarkResult(elapsedMs, QTest::WalltimeMilliseconds);
+}
+
+qint64 BenchSynoAlbumFill::fill(SynoAlbum* album)
+{
+    QElapsedTimer elapsedTimer;
+    elapsedTimer.start();
+
+    album->refresh(true);
+    if (!QTest::qWaitFor([album]() { return album->rowCount(QModelIndex()) == g_itemCount; }, g_fillTimeoutMs)) {
+        return -1;
+    }
+
+    // the view scrolls through the album without jumps, so every page is requested
+    for (int row = 0; row < g_itemCount; row += album->batchSize()) {
+        album->data(album->index(row), SynoAlbum::RoleId);
+    }
+
+    QTest::qWaitFor([album]() { return album->isLoaded(); }, g_fillTimeoutMs);
+    return elapsedTimer.elapsed();
+}
+
+void BenchSynoAlbumFill::onNewConnection()
+{
+    while (QTcpSocket* socket = m_server.nextPendingConnection()) {
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            onReadyRead(socket);
+        });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            m_buffers.remove(socket);
+            m_responses.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void BenchSynoAlbumFill::onReadyRead(QTcpSocket* socket)
+{
+    QByteArray& buffer = m_buffers[socket];
+    buffer += socket->readAll();
+
+    // pipelined requests are replied in order, each one after the round trip time
+    forever {
+        const int headerEnd = buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0) {
+            return;
+        }
+
+        int contentLength = 0;
+        for (const QByteArray& line : buffer.left(headerEnd).split('\n')) {
+            if (line.toLower().startsWith("content-length:")) {
+                contentLength = line.mid(15).trimmed().toInt();
+            }
+        }
+
+        const int requestSize = headerEnd + 4 + contentLength;
+        if (buffer.size() < requestSize) {
+            return;
+        }
+
+        const QByteArray body = replyBody(buffer.mid(headerEnd + 4, contentLength));
+        buffer.remove(0, requestSize);
+
+        m_responses[socket].enqueue(QByteArrayLiteral("HTTP/1.1 200 OK\r\n"
+                                                      "Content-Type: application/json\r\n"
+                                                      "Content-Length: ") + QByteArray::number(body.size())
+                                    + QByteArrayLiteral("\r\n\r\n") + body);
+
+        QTimer::singleShot(m_latencyMs, socket, [this, socket]() {
+            QQueue<QByteArray>& responses = m_responses[socket];
+            if (!responses.isEmpty()) {
+                socket->write(responses.dequeue());
+            }
+        });
+    }
+}
+
+QByteArray BenchSynoAlbumFill::replyBody(const QByteArray& requestBody)
+{
+    const QUrlQuery query(QString::fromLatin1(requestBody));
+    const QString api = query.queryItemValue(QStringLiteral("api"));
+    const QString method = query.queryItemValue(QStringLiteral("method"));
+
+    if (api == QStringLiteral("SYNO.API.Info")) {
+        return QByteArrayLiteral("{\"success\":true,\"data\":{"
+                                 "\"SYNO.PhotoStation.Album\":{\"path\":\"album.php\",\"minVersion\":1,\"maxVersion\":1}"
+                                 "}}");
+    }
+
+    if (api == QStringLiteral("SYNO.PhotoStation.Album") && method == QStringLiteral("getinfo")) {
+        return QByteArrayLiteral("{\"success\":true,\"data\":{\"total\":1,\"offset\":0,\"items\":[{"
+                                 "\"id\":\"album_4c696272617279\","
+                                 "\"type\":\"album\","
+                                 "\"info\":{\"sharepath\":\"Library\",\"name\":\"Library\",\"title\":\"Library\"},"
+                                 "\"additional\":{\"thumb_size\":{\"sig\":\"c2lnX2FsYnVt\"}}"
+                                 "}]}}");
+    }
+
+    if (api == QStringLiteral("SYNO.PhotoStation.Album") && method == QStringLiteral("list")) {
+        ++m_listRequestCount;
+        return listReply(query.queryItemValue(QStringLiteral("offset")).toInt(),
+                         query.queryItemValue(QStringLiteral("limit")).toInt());
+    }
+
+    return QByteArrayLiteral("{\"success\":false,\"error\":{\"code\":102}}");
+}
+
+QByteArray BenchSynoAlbumFill::listReply(int offset, int limit)
+{
+    const int end = std::min(g_itemCount, offset + limit);
+
+    QByteArray reply;
+    reply.reserve((end - offset) * 512);
+    reply += "{\"success\":true,\"data\":{\"total\":" + QByteArray::number(g_itemCount)
+           + ",\"offset\":" + QByteArray::number(offset) + ",\"items\":[";
+
+    for (int i = offset; i < end; ++i) {
+        const QByteArray n = QByteArray::number(i);
+        if (i != offset) {
+            reply += ',';
+        }
+
+        reply += "{\"id\":\"photo_4c696272617279_" + n + "\","
+                 "\"type\":\"photo\","
+                 "\"thumbnail_status\":\"small,large\","
+                 "\"info\":{"
+                     "\"sharepath\":\"Library\","
+                     "\"name\":\"IMG_" + n + ".JPG\","
+                     "\"title\":\"IMG_" + n + "\","
+                     "\"type\":\"photo\","
+                     "\"takendate\":\"2019-07-14 10:21:00\","
+                     "\"resolutionx\":6000,"
+                     "\"resolutiony\":4000"
+                 "},"
+                 "\"additional\":{"
+                     "\"file_location\":\"/volume1/photo/Library/IMG_" + n + ".JPG\","
+                     "\"thumb_size\":{"
+                         "\"sig\":\"c2lnXzAwMDAw" + n + "\","
+                         "\"small\":{\"resolutionx\":320,\"resolutiony\":213,\"mtime\":1563099660},"
+                         "\"large\":{\"resolutionx\":1280,\"resolutiony\":853,\"mtime\":1563099660}"
+                     "}"
+                 "}"
+             "}";
+    }
+
+    reply += "]}}";
+    return reply;
+}
+
+QTEST_GUILESS_MAIN(BenchSynoAlbumFill)
+
+#include "bench_synoalbumfill.moc"
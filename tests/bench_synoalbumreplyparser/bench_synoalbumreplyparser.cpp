@@ -0,0 +1,155 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synoalbumdata.h"
+#include "synoalbumreplyparser.h"
+#include "synoreplyjson.h"
+
+#include <QJsonArray>
+#include <QtTest>
+
+/*!
+ * \brief Compares the streaming parser of album replies with the JSON document
+ *
+ * The reply is a synthetic listing of 5,000 photos with all additional fields
+ * requested by SynoAlbum. The document path is the one replies were parsed with
+ * before the streaming parser: SynoReplyJSON followed by SynoAlbumData::readFrom().
+ */
+class BenchSynoAlbumReplyParser : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void streamingParser();
+    void document();
+
+private:
+    static QByteArray listReply(int itemCount);
+
+private:
+    QByteArray m_reply;
+};
+
+static constexpr int g_itemCount = 5000;
+
+void BenchSynoAlbumReplyParser::initTestCase()
+{
+    m_reply = listReply(g_itemCount);
+
+    // both parsers produce the same records
+    SynoAlbumReplyParser parser;
+    QVERIFY2(parser.parse(m_reply), qPrintable(parser.errorString()));
+    QCOMPARE(parser.total(), g_itemCount);
+    QCOMPARE(parser.items().size(), g_itemCount);
+
+    SynoReplyJSON replyJSON(m_reply);
+    QVERIFY2(replyJSON.errorString().isEmpty(), qPrintable(replyJSON.errorString()));
+    const QJsonArray items = replyJSON.dataObject()[QStringLiteral("items")].toArray();
+    QCOMPARE(items.size(), g_itemCount);
+
+    for (int i = 0; i < g_itemCount; i += 997) {
+        SynoAlbumData record;
+        record.readFrom(items[i].toObject());
+        QCOMPARE(parser.items()[i].contentHash(), record.contentHash());
+    }
+}
+
+void BenchSynoAlbumReplyParser::streamingParser()
+{
+    QBENCHMARK {
+        SynoAlbumReplyParser parser;
+        parser.parse(m_reply);
+        QVector<SynoAlbumData> records(std::move(parser.items()));
+        Q_UNUSED(records)
+    }
+}
+
+void BenchSynoAlbumReplyParser::document()
+{
+    QBENCHMARK {
+        SynoReplyJSON replyJSON(m_reply);
+        const QJsonArray items = replyJSON.dataObject()[QStringLiteral("items")].toArray();
+
+        QVector<SynoAlbumData> records(items.size());
+        for (int i = 0; i < items.size(); ++i) {
+            records[i].readFrom(items[i].toObject());
+        }
+    }
+}
+
+QByteArray BenchSynoAlbumReplyParser::listReply(int itemCount)
+{
+    QByteArray reply;
+    reply.reserve(itemCount * 1024);
+    reply += "{\"success\":true,\"data\":{\"total\":" + QByteArray::number(itemCount)
+           + ",\"offset\":0,\"items\":[";
+
+    for (int i = 0; i < itemCount; ++i) {
+        const QByteArray n = QByteArray::number(i);
+        if (i) {
+            reply += ',';
+        }
+
+        reply += "{\"id\":\"photo_4c6962726172792f32303139_" + n + "\","
+                 "\"type\":\"photo\","
+                 "\"thumbnail_status\":\"small,large\","
+                 "\"info\":{"
+                     "\"sharepath\":\"Library/2019\","
+                     "\"name\":\"IMG_" + n + ".JPG\","
+                     "\"title\":\"IMG_" + n + "\","
+                     "\"description\":\"Trip to the mountains, day " + n + "\","
+                     "\"hits\":" + n + ","
+                     "\"type\":\"photo\","
+                     "\"takendate\":\"2019-07-14 10:21:" + QByteArray::number(i % 60).rightJustified(2, '0') + "\","
+                     "\"conversion\":true,"
+                     "\"allow_comment\":false,"
+                     "\"allow_embed\":false,"
+                     "\"resolutionx\":6000,"
+                     "\"resolutiony\":4000"
+                 "},"
+                 "\"additional\":{"
+                     "\"file_location\":\"/volume1/photo/Library/2019/IMG_" + n + ".JPG\","
+                     "\"photo_exif\":{"
+                         "\"takendate\":\"2019-07-14 10:21:00\","
+                         "\"camera\":\"Canon EOS 80D\","
+                         "\"lens\":\"EF-S18-135mm f/3.5-5.6 IS USM\","
+                         "\"exposure\":\"1/250\","
+                         "\"aperture\":\"F8\","
+                         "\"iso\":100,"
+                         "\"gps\":{\"latitude\":47.5,\"longitude\":11.1}"
+                     "},"
+                     "\"album_permission\":{\"browse\":true,\"upload\":false,\"manage\":false},"
+                     "\"thumb_size\":{"
+                         "\"sig\":\"c2lnXzAwMDAw" + n + "\","
+                         "\"preview\":{\"resolutionx\":120,\"resolutiony\":80,\"mtime\":1563099660},"
+                         "\"small\":{\"resolutionx\":320,\"resolutiony\":213,\"mtime\":1563099660},"
+                         "\"large\":{\"resolutionx\":1280,\"resolutiony\":853,\"mtime\":1563099660}"
+                     "}"
+                 "}"
+             "}";
+    }
+
+    reply += "]}}";
+    return reply;
+}
+
+QTEST_GUILESS_MAIN(BenchSynoAlbumReplyParser)
+
+#include "bench_synoalbumreplyparser.moc"
@@ -0,0 +1,159 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synoconn.h"
+#include "synoconn_p.h"
+#include "synorequest.h"
+
+#include <QtTest>
+
+/*!
+ * \brief Measures the send path of SynoConn up to the network access manager
+ *
+ * The API map is filled directly, so nothing is sent. Each run prepares 1,000
+ * requests of the album listing from the endpoint template: the template lookup,
+ * the merge of its URL and headers, and the form body. The merge is compared
+ * with walking the headers of the template, as it was done for each request before.
+ */
+class BenchSynoConn : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void endpointForAPI();
+    void prepareRequest();
+    void templateHeaderList();
+    void buildRequestBody();
+
+private:
+    SynoConnPrivate* d() const;
+
+private:
+    SynoConn* m_conn = nullptr;
+    std::shared_ptr<SynoRequest> m_request;
+};
+
+static const QByteArray g_api = QByteArrayLiteral("SYNO.PhotoStation.Album");
+static constexpr int g_requestCount = 1000;
+
+void BenchSynoConn::initTestCase()
+{
+    m_conn = new SynoConn(this);
+    d()->synoUrl = QUrl(QStringLiteral("http://localhost/photo"));
+    d()->apiMap.insert(g_api, QStringLiteral("album.php"));
+
+    m_request = m_conn->createRequest(g_api, {
+        QByteArrayLiteral("method=list"),
+        QByteArrayLiteral("version=1"),
+        QByteArrayLiteral("type=album,photo,video"),
+        QByteArrayLiteral("offset=200"),
+        QByteArrayLiteral("limit=50"),
+        QByteArrayLiteral("recursive=false"),
+        QByteArrayLiteral("additional=album_permission,photo_exif,video_codec,video_quality,thumb_size,file_location"),
+        QByteArrayLiteral("id=album_4c696272617279")
+    });
+
+    // the prepared request carries the URL and headers of the template
+    const SynoEndpoint* endpoint = d()->endpointForAPI(g_api);
+    QVERIFY(endpoint);
+    const QByteArray body = d()->prepareRequest(m_request.get(), *endpoint);
+    QCOMPARE(m_request->request().url(), QUrl(QStringLiteral("http://localhost/photo/webapi/album.php")));
+    QCOMPARE(m_request->request().header(QNetworkRequest::ContentTypeHeader).toByteArray(),
+             QByteArrayLiteral("application/x-www-form-urlencoded"));
+    QVERIFY(body.startsWith("api=SYNO.PhotoStation.Album&method=list&"));
+}
+
+void BenchSynoConn::cleanupTestCase()
+{
+    m_request.reset();
+    delete m_conn;
+}
+
+void BenchSynoConn::endpointForAPI()
+{
+    const SynoEndpoint* endpoint = nullptr;
+    QBENCHMARK {
+        for (int i = 0; i < g_requestCount; ++i) {
+            endpoint = d()->endpointForAPI(g_api);
+        }
+    }
+    QVERIFY(endpoint);
+}
+
+void BenchSynoConn::prepareRequest()
+{
+    // the request is reset for each send, as a new request has no headers of its own
+    const SynoEndpoint* endpoint = d()->endpointForAPI(g_api);
+    QByteArray body;
+    QBENCHMARK {
+        for (int i = 0; i < g_requestCount; ++i) {
+            m_request->request() = QNetworkRequest();
+            body = d()->prepareRequest(m_request.get(), *endpoint);
+        }
+    }
+    QVERIFY(!body.isEmpty());
+}
+
+void BenchSynoConn::templateHeaderList()
+{
+    // headers merged by walking the template, the URL and body are the same as above
+    const SynoEndpoint* endpoint = d()->endpointForAPI(g_api);
+    QByteArray body;
+    QBENCHMARK {
+        for (int i = 0; i < g_requestCount; ++i) {
+            m_request->request() = QNetworkRequest();
+            QNetworkRequest& networkRequest = m_request->request();
+            networkRequest.setUrl(endpoint->request.url());
+            networkRequest.setRawHeader(QByteArrayLiteral("X-SYNO-TOKEN"), endpoint->request.rawHeader(QByteArrayLiteral("X-SYNO-TOKEN")));
+
+            const QList<QByteArray> headers = endpoint->request.rawHeaderList();
+            for (const QByteArray& header : headers) {
+                if (!networkRequest.hasRawHeader(header)) {
+                    networkRequest.setRawHeader(header, endpoint->request.rawHeader(header));
+                }
+            }
+
+            body = d()->buildRequestBody(*endpoint, m_request->formData());
+        }
+    }
+    QVERIFY(!body.isEmpty());
+}
+
+void BenchSynoConn::buildRequestBody()
+{
+    const SynoEndpoint* endpoint = d()->endpointForAPI(g_api);
+    QByteArray body;
+    QBENCHMARK {
+        for (int i = 0; i < g_requestCount; ++i) {
+            body = d()->buildRequestBody(*endpoint, m_request->formData());
+        }
+    }
+    QVERIFY(!body.isEmpty());
+}
+
+SynoConnPrivate* BenchSynoConn::d() const
+{
+    return static_cast<SynoConnPrivate*>(QObjectPrivate::get(m_conn));
+}
+
+QTEST_GUILESS_MAIN(BenchSynoConn)
+
+#include "bench_synoconn.moc"
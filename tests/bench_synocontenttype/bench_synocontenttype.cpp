@@ -0,0 +1,139 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synocontenttype.h"
+
+#include <QMimeDatabase>
+#include <QtTest>
+
+/*!
+ * \brief Compares interned classification of Content-Type values with parsing of each reply
+ *
+ * The parsing is the one replies were classified with before the classifier:
+ * the value is split, and the MIME type is looked up and compared by name.
+ */
+class BenchSynoContentType : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void classify_data();
+    void classify();
+    void parse_data();
+    void parse();
+
+private:
+    void contentTypes();
+    static SynoContentTypeInfo parseContentType(const QByteArray& contentTypeRaw);
+};
+
+void BenchSynoContentType::initTestCase()
+{
+    // both approaches agree on the values replied by the service
+    const QByteArrayList values = {
+        QByteArrayLiteral("image/jpeg"),
+        QByteArrayLiteral("image/png"),
+        QByteArrayLiteral("text/plain; charset=utf-8"),
+        QByteArrayLiteral("application/octet-stream")
+    };
+
+    for (const QByteArray& value : values) {
+        SynoContentTypeInfo classified = SynoContentTypeClassifier::instance().classify(value);
+        SynoContentTypeInfo parsed = parseContentType(value);
+        QCOMPARE(classified.type, parsed.type);
+        QCOMPARE(classified.encoding, parsed.encoding);
+    }
+}
+
+void BenchSynoContentType::classify_data()
+{
+    contentTypes();
+}
+
+void BenchSynoContentType::classify()
+{
+    QFETCH(QByteArray, contentType);
+
+    SynoContentTypeClassifier& classifier = SynoContentTypeClassifier::instance();
+    SynoRequest::ContentType type = SynoRequest::UNKNOWN;
+    QBENCHMARK {
+        type = classifier.classify(contentType).type;
+    }
+    Q_UNUSED(type)
+}
+
+void BenchSynoContentType::parse_data()
+{
+    contentTypes();
+}
+
+void BenchSynoContentType::parse()
+{
+    QFETCH(QByteArray, contentType);
+
+    SynoRequest::ContentType type = SynoRequest::UNKNOWN;
+    QBENCHMARK {
+        type = parseContentType(contentType).type;
+    }
+    Q_UNUSED(type)
+}
+
+void BenchSynoContentType::contentTypes()
+{
+    QTest::addColumn<QByteArray>("contentType");
+
+    QTest::newRow("jpeg") << QByteArrayLiteral("image/jpeg");
+    QTest::newRow("json") << QByteArrayLiteral("text/plain; charset=utf-8");
+}
+
+SynoContentTypeInfo BenchSynoContentType::parseContentType(const QByteArray& contentTypeRaw)
+{
+    SynoContentTypeInfo info;
+
+    QList<QByteArray> contentTypeList(contentTypeRaw.split(';'));
+    QByteArray contentType;
+    if (contentTypeList.size() > 0) {
+        contentType = contentTypeList[0];
+    }
+
+    if (contentTypeList.size() > 1) {
+        QByteArray contentEncoding = contentTypeList[1].trimmed();
+        QByteArray charsetPrefix(QByteArrayLiteral("charset="));
+        if (contentEncoding.startsWith(charsetPrefix)) {
+            info.encoding = contentEncoding.mid(charsetPrefix.size());
+        }
+    }
+
+    QMimeDatabase mimeDb;
+    QMimeType mimeType = mimeDb.mimeTypeForName(QString::fromLatin1(contentType));
+    if (mimeType.inherits(QStringLiteral("text/plain"))) {
+        info.type = SynoRequest::TEXT;
+    } else if (mimeType.inherits(QStringLiteral("image/jpeg"))) {
+        info.type = SynoRequest::IMAGE_JPEG;
+    } else if (mimeType.inherits(QStringLiteral("image"))) {
+        info.type = SynoRequest::IMAGE_OTHER;
+    }
+
+    return info;
+}
+
+QTEST_GUILESS_MAIN(BenchSynoContentType)
+
+#include "bench_synocontenttype.moc"
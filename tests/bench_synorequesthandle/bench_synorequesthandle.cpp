@@ -0,0 +1,271 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synoconn.h"
+#include "synorequest.h"
+#include "synorequesthandle.h"
+
+#include <QHash>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUrlQuery>
+#include <QtTest>
+
+#include <atomic>
+
+#if defined(__GLIBC__)
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+// heap allocations of all threads, the network stack included
+static std::atomic<quint64> g_allocationCount{0};
+
+extern "C" void* malloc(size_t size)
+{
+    g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+    g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+    g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+/*!
+ * \brief Counts heap allocations per thumbnail of pooled request handles and SynoRequest
+ *
+ * QTcpServer is the HTTP stand-in of the service, it replies to each thumbnail
+ * request with 10 KB image at once. Thumbnails are requested in waves, as the views
+ * do, and the allocations of all threads are divided by the amount of thumbnails.
+ * The connections and the handle pool are warmed up before counting.
+ */
+class BenchSynoRequestHandle : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void allocationsPerThumbnail_data();
+    void allocationsPerThumbnail();
+
+private:
+    int fetchWithHandles(int count);
+    int fetchWithRequests(int count);
+    static QByteArrayList thumbFormData(int index);
+    void onNewConnection();
+    void onReadyRead(QTcpSocket* socket);
+
+private:
+    QTcpServer m_server;
+    SynoConn* m_conn = nullptr;
+    QHash<QTcpSocket*, QByteArray> m_buffers;
+    QByteArray m_thumbReply;
+};
+
+static const QByteArray g_thumbApi = QByteArrayLiteral("SYNO.PhotoStation.Thumb");
+static constexpr int g_waveSize = 40;
+static constexpr int g_thumbCount = 2000;
+static constexpr int g_timeoutMs = 60000;
+
+void BenchSynoRequestHandle::initTestCase()
+{
+#if !defined(__GLIBC__)
+    QSKIP("Allocations are counted with glibc only");
+#endif
+
+    QByteArray image(10 * 1024, '\xA5');
+    m_thumbReply = QByteArrayLiteral("HTTP/1.1 200 OK\r\n"
+                                     "Content-Type: image/jpeg\r\n"
+                                     "Content-Length: ") + QByteArray::number(image.size())
+                 + QByteArrayLiteral("\r\n\r\n") + image;
+
+    connect(&m_server, &QTcpServer::newConnection, this, &BenchSynoRequestHandle::onNewConnection);
+    QVERIFY(m_server.listen(QHostAddress::LocalHost));
+
+    m_conn = new SynoConn(this);
+    m_conn->connectToSyno(QUrl(QStringLiteral("http://localhost:%1/photo").arg(m_server.serverPort())));
+    QTRY_COMPARE(m_conn->status(), SynoConn::API_LOADED);
+}
+
+void BenchSynoRequestHandle::cleanupTestCase()
+{
+    delete m_conn;
+    m_server.close();
+}
+
+void BenchSynoRequestHandle::allocationsPerThumbnail_data()
+{
+    QTest::addColumn<bool>("isHandle");
+
+    QTest::newRow("pooled handle") << true;
+    QTest::newRow("SynoRequest") << false;
+}
+
+void BenchSynoRequestHandle::allocationsPerThumbnail()
+{
+#if defined(__GLIBC__)
+    QFETCH(bool, isHandle);
+
+    auto fetch = [this, isHandle](int count) {
+        return isHandle ? fetchWithHandles(count) : fetchWithRequests(count);
+    };
+
+    QCOMPARE(fetch(g_waveSize * 2), g_waveSize * 2);
+
+    const quint64 allocationCount = g_allocationCount.load();
+    QCOMPARE(fetch(g_thumbCount), g_thumbCount);
+    const quint64 thumbAllocationCount = g_allocationCount.load() - allocationCount;
+
+    QTest::setBenchmarkResult(static_cast<qreal>(thumbAllocationCount) / g_thumbCount, QTest::Events);
+#endif
+}
+
+int BenchSynoRequestHandle::fetchWithHandles(int count)
+{
+    int receivedCount = 0;
+    for (int wave = 0; wave < count; wave += g_waveSize) {
+        const int waveSize = std::min(g_waveSize, count - wave);
+        int finishedCount = 0;
+
+        for (int i = 0; i < waveSize; ++i) {
+            SynoRequestHandle* handle = m_conn->acquireRequestHandle(g_thumbApi);
+            handle->formData() = thumbFormData(wave + i);
+            handle->setCallback([this, &finishedCount, &receivedCount](SynoRequestHandle* handle) {
+                if (handle->errorString().isEmpty() && handle->replyBody().size() == 10 * 1024) {
+                    ++receivedCount;
+                }
+                ++finishedCount;
+                m_conn->releaseRequestHandle(handle);
+            });
+            m_conn->sendRequestHandle(handle);
+        }
+
+        if (!QTest::qWaitFor([&finishedCount, waveSize]() { return finishedCount == waveSize; }, g_timeoutMs)) {
+            break;
+        }
+    }
+
+    return receivedCount;
+}
+
+int BenchSynoRequestHandle::fetchWithRequests(int count)
+{
+    int receivedCount = 0;
+    for (int wave = 0; wave < count; wave += g_waveSize) {
+        const int waveSize = std::min(g_waveSize, count - wave);
+        int finishedCount = 0;
+
+        for (int i = 0; i < waveSize; ++i) {
+            std::shared_ptr<SynoRequest> req = m_conn->createRequest(g_thumbApi, thumbFormData(wave + i));
+            req->send(this, [req, &finishedCount, &receivedCount]() {
+                if (req->errorString().isEmpty() && req->replyBody().size() == 10 * 1024) {
+                    ++receivedCount;
+                }
+                ++finishedCount;
+            });
+        }
+
+        if (!QTest::qWaitFor([&finishedCount, waveSize]() { return finishedCount == waveSize; }, g_timeoutMs)) {
+            break;
+        }
+    }
+
+    // requests are released with deferred deletion
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+
+    return receivedCount;
+}
+
+QByteArrayList BenchSynoRequestHandle::thumbFormData(int index)
+{
+    QByteArrayList formData;
+    formData << QByteArrayLiteral("method=get");
+    formData << QByteArrayLiteral("version=1");
+    formData << QByteArrayLiteral("size=small");
+    formData << QByteArrayLiteral("id=photo_4c696272617279_") + QByteArray::number(index);
+    return formData;
+}
+
+void BenchSynoRequestHandle::onNewConnection()
+{
+    while (QTcpSocket* socket = m_server.nextPendingConnection()) {
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            onReadyRead(socket);
+        });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            m_buffers.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void BenchSynoRequestHandle::onReadyRead(QTcpSocket* socket)
+{
+    QByteArray& buffer = m_buffers[socket];
+    buffer += socket->readAll();
+
+    // pipelined requests are replied in order
+    forever {
+        const int headerEnd = buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0) {
+            return;
+        }
+
+        int contentLength = 0;
+        for (const QByteArray& line : buffer.left(headerEnd).split('\n')) {
+            if (line.toLower().startsWith("content-length:")) {
+                contentLength = line.mid(15).trimmed().toInt();
+            }
+        }
+
+        const int requestSize = headerEnd + 4 + contentLength;
+        if (buffer.size() < requestSize) {
+            return;
+        }
+
+        const QUrlQuery query(QString::fromLatin1(buffer.mid(headerEnd + 4, contentLength)));
+        buffer.remove(0, requestSize);
+
+        if (query.queryItemValue(QStringLiteral("api")) == QStringLiteral("SYNO.API.Info")) {
+            const QByteArray body = QByteArrayLiteral("{\"success\":true,\"data\":{"
+                                                      "\"SYNO.PhotoStation.Thumb\":{\"path\":\"thumb.php\",\"minVersion\":1,\"maxVersion\":1}"
+                                                      "}}");
+            socket->write(QByteArrayLiteral("HTTP/1.1 200 OK\r\n"
+                                            "Content-Type: application/json\r\n"
+                                            "Content-Length: ") + QByteArray::number(body.size())
+                          + QByteArrayLiteral("\r\n\r\n") + body);
+        } else {
+            socket->write(m_thumbReply);
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(BenchSynoRequestHandle)
+
+#include "bench_synorequesthandle.moc"
@@ -0,0 +1,196 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synoalbumdata.h"
+#include "synosearchindex.h"
+
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QtTest>
+
+/*!
+ * \brief Measures query latency of SynoSearchIndex over 500,000 documents
+ *
+ * The index is built from a synthetic library of 500 albums with 1,000 photos each.
+ * Every photo has a unique numbered file name and a title of three words out of
+ * 8,000, every fourth one has a description. The index is standalone,
+ * so the library index is neither opened nor written.
+ */
+class BenchSynoSearchIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void multiWordPrefix();
+    void search_data();
+    void search();
+    void latency();
+
+private:
+    void queries();
+    static QString vocabularyWord(int index);
+
+private:
+    QHash<QByteArray, QVector<SynoAlbumData>> m_albums;
+    SynoSearchIndex* m_index = nullptr;
+};
+
+static constexpr int g_albumCount = 500;
+static constexpr int g_albumSize = 1000;
+static constexpr int g_vocabularySize = 8000;
+static constexpr int g_maxResults = 1000;
+static constexpr qint64 g_maxQueryUs = 10000;
+
+void BenchSynoSearchIndex::initTestCase()
+{
+    QRandomGenerator random(46);
+
+    for (int album = 0; album < g_albumCount; ++album) {
+        const QString albumName = QStringLiteral("album_%1").arg(album);
+
+        QVector<SynoAlbumData> items(g_albumSize);
+        for (int i = 0; i < g_albumSize; ++i) {
+            const int number = album * g_albumSize + i;
+            SynoAlbumData& item = items[i];
+            item.id = QStringLiteral("photo_%1").arg(number);
+            item.setType(QStringLiteral("photo"));
+            item.name = QStringLiteral("IMG_%1.JPG").arg(number, 6, 10, QLatin1Char('0'));
+            item.setFileLocation(albumName + QLatin1Char('/') + item.name);
+
+            QStringList title;
+            for (int w = 0; w < 3; ++w) {
+                title.append(vocabularyWord(random.bounded(g_vocabularySize)));
+            }
+            item.title = title.join(QLatin1Char(' '));
+
+            if (i % 4 == 0) {
+                QStringList description;
+                for (int w = 0; w < 6; ++w) {
+                    description.append(vocabularyWord(random.bounded(g_vocabularySize)));
+                }
+                item.description = description.join(QLatin1Char(' '));
+            }
+        }
+
+        m_albums.insert(albumName.toUtf8(), items);
+    }
+
+    m_index = new SynoSearchIndex(m_albums, this);
+    QCOMPARE(m_index->documentCount(), g_albumCount * g_albumSize);
+
+    // the numbered file name matches exactly one photo
+    const QStringList itemIds = m_index->search(QStringLiteral("IMG_123456"), g_maxResults);
+    QCOMPARE(itemIds, QStringList{ QStringLiteral("photo_123456") });
+}
+
+void BenchSynoSearchIndex::multiWordPrefix()
+{
+    // a word with a short prefix of many distinct numbers finds every photo having both
+    const QString word = vocabularyWord(123);
+    const QString prefix = QStringLiteral("4");
+
+    QSet<QString> expected;
+    for (auto iter = m_albums.constBegin(); iter != m_albums.constEnd(); ++iter) {
+        const QString albumNumber = QString::fromUtf8(iter.key()).section(QLatin1Char('_'), 1);
+        for (const SynoAlbumData& item : iter.value()) {
+            const QStringList itemWords = (item.title + QLatin1Char(' ') + item.description).split(QLatin1Char(' '));
+            const QString itemNumber = item.id.section(QLatin1Char('_'), 1).rightJustified(6, QLatin1Char('0'));
+            if (itemWords.contains(word) && (itemNumber.startsWith(prefix) || albumNumber.startsWith(prefix))) {
+                expected.insert(item.id);
+            }
+        }
+    }
+    QVERIFY(!expected.isEmpty());
+
+    const QStringList itemIds = m_index->search(word + QLatin1Char(' ') + prefix, g_albumCount * g_albumSize);
+    QCOMPARE(QSet<QString>(itemIds.cbegin(), itemIds.cend()), expected);
+}
+
+void BenchSynoSearchIndex::search_data()
+{
+    queries();
+}
+
+void BenchSynoSearchIndex::search()
+{
+    QFETCH(QString, query);
+
+    QStringList itemIds;
+    QBENCHMARK {
+        itemIds = m_index->search(query, g_maxResults);
+    }
+    QVERIFY(itemIds.size() <= g_maxResults);
+}
+
+void BenchSynoSearchIndex::latency()
+{
+    // every query stays within a frame budget, the average over the runs is checked
+    static constexpr int runs = 20;
+
+    const QStringList queryList = {
+        vocabularyWord(123),
+        vocabularyWord(123).left(2),
+        QStringLiteral("img"),
+        QStringLiteral("1"),
+        vocabularyWord(123) + QStringLiteral(" jpg"),
+        QStringLiteral("album 12 img")
+    };
+
+    for (const QString& query : queryList) {
+        QElapsedTimer elapsedTimer;
+        elapsedTimer.start();
+        for (int run = 0; run < runs; ++run) {
+            m_index->search(query, g_maxResults);
+        }
+        const qint64 averageUs = elapsedTimer.nsecsElapsed() / 1000 / runs;
+
+        QVERIFY2(averageUs < g_maxQueryUs,
+                 qPrintable(QStringLiteral("Query \"%1\" takes %2 us").arg(query).arg(averageUs)));
+    }
+}
+
+void BenchSynoSearchIndex::queries()
+{
+    QTest::addColumn<QString>("query");
+
+    QTest::newRow("word") << vocabularyWord(123);
+    QTest::newRow("short prefix") << vocabularyWord(123).left(2);
+    QTest::newRow("common word") << QStringLiteral("img");
+    QTest::newRow("digit prefix") << QStringLiteral("1");
+    QTest::newRow("two words") << vocabularyWord(123) + QStringLiteral(" jpg");
+    QTest::newRow("no match") << QStringLiteral("qqq");
+}
+
+QString BenchSynoSearchIndex::vocabularyWord(int index)
+{
+    // three syllables out of twenty give 8,000 distinct words of the same length
+    static const char* const syllables[] = {
+        "ba", "ce", "di", "fo", "gu", "ha", "ke", "li", "mo", "nu",
+        "pa", "re", "si", "to", "vu", "wa", "xe", "yi", "zo", "ru"
+    };
+
+    return QString::fromLatin1(syllables[index % 20])
+         + QString::fromLatin1(syllables[(index / 20) % 20])
+         + QString::fromLatin1(syllables[(index / 400) % 20]);
+}
+
+QTEST_GUILESS_MAIN(BenchSynoSearchIndex)
+
+#include "bench_synosearchindex.moc"
@@ -0,0 +1,72 @@
+#
+# GNU General Public License (GPL)
+# Copyright (c) 2020 by Aleksei Ilin
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+# Common configuration of tests and benchmarks.
+# The sources of network and album layers are compiled into each target,
+# the QML and image layers are not used by the tests.
+
+QT += concurrent core core-private network qml testlib
+CONFIG += c++17 console testcase no_private_qt_headers_warning
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+# the secure storage is used by the TLS session tests if available
+include($$PWD/../3rdParty/qtkeychain/qt5keychain.pri): {
+    DEFINES += USE_KEYCHAIN
+}
+
+SRC_DIR = $$PWD/../src
+INCLUDEPATH += $$SRC_DIR
+
+HEADERS += \
+    $$SRC_DIR/synoalbum.h \
+    $$SRC_DIR/synoalbumdata.h \
+    $$SRC_DIR/synoalbumpager.h \
+    $$SRC_DIR/synoalbumreplycache.h \
+    $$SRC_DIR/synoalbumreplyparser.h \
+    $$SRC_DIR/synoauth.h \
+    $$SRC_DIR/synoconn.h \
+    $$SRC_DIR/synoconn_p.h \
+    $$SRC_DIR/synocontenttype.h \
+    $$SRC_DIR/synoerror.h \
+    $$SRC_DIR/synolibraryindex.h \
+    $$SRC_DIR/synoreplyjson.h \
+    $$SRC_DIR/synorequest.h \
+    $$SRC_DIR/synorequesthandle.h \
+    $$SRC_DIR/synosearchindex.h \
+    $$SRC_DIR/synosettings.h \
+    $$SRC_DIR/synosslconfig.h \
+    $$SRC_DIR/synotraits.h
+
+SOURCES += \
+    $$SRC_DIR/synoalbum.cpp \
+    $$SRC_DIR/synoalbumdata.cpp \
+    $$SRC_DIR/synoalbumpager.cpp \
+    $$SRC_DIR/synoalbumreplycache.cpp \
+    $$SRC_DIR/synoalbumreplyparser.cpp \
+    $$SRC_DIR/synoauth.cpp \
+    $$SRC_DIR/synoconn.cpp \
+    $$SRC_DIR/synocontenttype.cpp \
+    $$SRC_DIR/synoerror.cpp \
+    $$SRC_DIR/synolibraryindex.cpp \
+    $$SRC_DIR/synoreplyjson.cpp \
+    $$SRC_DIR/synorequest.cpp \
+    $$SRC_DIR/synosearchindex.cpp \
+    $$SRC_DIR/synosettings.cpp \
+    $$SRC_DIR/synosslconfig.cpp
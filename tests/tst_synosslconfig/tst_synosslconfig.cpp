@@ -0,0 +1,284 @@
+/*
+ * GNU General Public License (GPL)
+ * Copyright (c) 2020 by Aleksei Ilin
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synoconn.h"
+#include "synosettings.h"
+#include "synosslconfig.h"
+
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QProcess>
+#include <QScopedPointer>
+#include <QSignalSpy>
+#include <QSslSocket>
+#include <QStandardPaths>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QtTest>
+
+/*!
+ * \brief Verifies that a persisted TLS session is resumed by a new connection manager
+ *
+ * OpenSSL s_server is the TLS stand-in of the service. In -www mode it replies
+ * with the state of the handshake, which reads "Reused" for a resumed session.
+ * Connections opened in advance are counted by a plain TCP server, as s_server
+ * serves one connection at a time.
+ */
+class TestSynoSslConfig : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void resumesSessionOnRelaunch();
+    void reloadsSessionFromStorage();
+    void warmsUpConnections();
+
+private:
+    QNetworkReply* get(QNetworkAccessManager& nma, const SynoSslConfig& sslConfig);
+    static QByteArray sessionTicket(const SynoSslConfig& sslConfig);
+    static QByteArray reloadSessionTicket(SynoSslConfig* sslConfig);
+    bool isServerListening() const;
+
+private:
+    QTemporaryDir m_dir;
+    QProcess m_server;
+    quint16 m_port = 0;
+};
+
+void TestSynoSslConfig::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+
+    if (!QSslSocket::supportsSsl()) {
+        QSKIP("SSL is not available");
+    }
+
+    const QString openssl = QStandardPaths::findExecutable(QStringLiteral("openssl"));
+    if (openssl.isEmpty()) {
+        QSKIP("openssl is required for the TLS stand-in server");
+    }
+
+    QVERIFY(m_dir.isValid());
+    const QString certPath = m_dir.filePath(QStringLiteral("cert.pem"));
+    const QString keyPath = m_dir.filePath(QStringLiteral("key.pem"));
+
+    QCOMPARE(QProcess::execute(openssl, { QStringLiteral("req"), QStringLiteral("-x509"),
+                                          QStringLiteral("-newkey"), QStringLiteral("rsa:2048"),
+                                          QStringLiteral("-nodes"), QStringLiteral("-days"), QStringLiteral("1"),
+                                          QStringLiteral("-subj"), QStringLiteral("/CN=localhost"),
+                                          QStringLiteral("-keyout"), keyPath,
+                                          QStringLiteral("-out"), certPath }), 0);
+
+    {
+        // free port for the server
+        QTcpServer probe;
+        QVERIFY(probe.listen(QHostAddress::LocalHost));
+        m_port = probe.serverPort();
+    }
+
+    // TLS 1.2 delivers the session within the handshake, so the ticket is available with the first reply
+    m_server.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    m_server.start(openssl, { QStringLiteral("s_server"), QStringLiteral("-quiet"), QStringLiteral("-www"),
+                              QStringLiteral("-tls1_2"),
+                              QStringLiteral("-accept"), QString::number(m_port),
+                              QStringLiteral("-cert"), certPath,
+                              QStringLiteral("-key"), keyPath });
+    QVERIFY(m_server.waitForStarted());
+    QTRY_VERIFY_WITH_TIMEOUT(isServerListening(), 10000);
+}
+
+void TestSynoSslConfig::cleanupTestCase()
+{
+    if (m_server.state() != QProcess::NotRunning) {
+        m_server.kill();
+        m_server.waitForFinished();
+    }
+}
+
+void TestSynoSslConfig::resumesSessionOnRelaunch()
+{
+    SynoConn conn;
+    SynoSslConfig* sslConfig = conn.sslConfig();
+    QTRY_VERIFY(!sslConfig->isSessionLoading());
+
+    {
+        // the first launch performs full handshake, and keeps the session ticket of the reply
+        QNetworkAccessManager nma;
+        QScopedPointer<QNetworkReply, QScopedPointerDeleteLater> reply(get(nma, *sslConfig));
+        QVERIFY(reply);
+        QCOMPARE(reply->error(), QNetworkReply::NoError);
+
+        const QByteArray body = reply->readAll();
+        QVERIFY2(body.contains("New, "), body.constData());
+        QVERIFY(sslConfig->updateSessionTicket(reply.data()));
+    }
+
+    {
+        // the next launch connects with another connection manager, nothing is shared but the ticket
+        QNetworkAccessManager nma;
+        QScopedPointer<QNetworkReply, QScopedPointerDeleteLater> reply(get(nma, *sslConfig));
+        QVERIFY(reply);
+        QCOMPARE(reply->error(), QNetworkReply::NoError);
+
+        const QByteArray body = reply->readAll();
+        QVERIFY2(body.contains("Reused, "), body.constData());
+    }
+}
+
+void TestSynoSslConfig::reloadsSessionFromStorage()
+{
+    {
+        // the stored session is cleared, the write also tells whether the keychain is available
+        SynoSettings settings(QStringLiteral("ssl"));
+        bool isFinished = false;
+        bool isCleared = false;
+        settings.saveSecureC(QStringLiteral("session"), QString(), &settings, [&isFinished, &isCleared](const QString&) {
+            isCleared = true;
+            isFinished = true;
+        }, [&isFinished](const QString&, const QString&) {
+            isFinished = true;
+        });
+
+        QTRY_VERIFY(isFinished);
+        if (!isCleared) {
+            QSKIP("Keychain is not available");
+        }
+    }
+
+    SynoConn conn;
+    SynoSslConfig* sslConfig = conn.sslConfig();
+    QTRY_VERIFY(!sslConfig->isSessionLoading());
+    QVERIFY(sessionTicket(*sslConfig).isEmpty());
+
+    {
+        // the ticket of the first reply is stored in the keychain
+        QNetworkAccessManager nma;
+        QScopedPointer<QNetworkReply, QScopedPointerDeleteLater> reply(get(nma, *sslConfig));
+        QVERIFY(reply);
+        QCOMPARE(reply->error(), QNetworkReply::NoError);
+
+        const QByteArray body = reply->readAll();
+        QVERIFY2(body.contains("New, "), body.constData());
+        QVERIFY(sslConfig->updateSessionTicket(reply.data()));
+    }
+
+    const QByteArray ticket = sessionTicket(*sslConfig);
+    QVERIFY(!ticket.isEmpty());
+
+    // another instance loads the ticket, the write is asynchronous so it is read until found
+    SynoConn relaunchedConn;
+    SynoSslConfig* relaunchedSslConfig = relaunchedConn.sslConfig();
+    QTRY_VERIFY(!relaunchedSslConfig->isSessionLoading());
+    QTRY_COMPARE(reloadSessionTicket(relaunchedSslConfig), ticket);
+
+    {
+        QNetworkAccessManager nma;
+        QScopedPointer<QNetworkReply, QScopedPointerDeleteLater> reply(get(nma, *relaunchedSslConfig));
+        QVERIFY(reply);
+        QCOMPARE(reply->error(), QNetworkReply::NoError);
+
+        const QByteArray body = reply->readAll();
+        QVERIFY2(body.contains("Reused, "), body.constData());
+    }
+}
+
+void TestSynoSslConfig::warmsUpConnections()
+{
+    static constexpr int warmConnections = 3;
+
+    SynoSettings performanceSettings(QStringLiteral("performance"));
+    performanceSettings.setValue(QStringLiteral("sslWarmConnections"), warmConnections);
+
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+
+    int connectionCount = 0;
+    connect(&server, &QTcpServer::newConnection, &server, [&server, &connectionCount]() {
+        // the sockets are children of the server, the handshakes are never answered
+        while (server.nextPendingConnection()) {
+            ++connectionCount;
+        }
+    });
+
+    SynoConn conn;
+    SynoSslConfig* sslConfig = conn.sslConfig();
+
+    // the connections requested while the session is loading are opened once it is loaded
+    sslConfig->connectToHostEncrypted(QStringLiteral("127.0.0.1"), server.serverPort());
+    QTRY_VERIFY(!sslConfig->isSessionLoading());
+    QTRY_COMPARE(connectionCount, warmConnections);
+
+    // no more connections are opened than configured
+    QTest::qWait(200);
+    QCOMPARE(connectionCount, warmConnections);
+}
+
+QNetworkReply* TestSynoSslConfig::get(QNetworkAccessManager& nma, const SynoSslConfig& sslConfig)
+{
+    QNetworkRequest request(QUrl(QStringLiteral("https://localhost:%1/").arg(m_port)));
+    sslConfig.applySslConfiguration(request);
+
+    QNetworkReply* reply = nma.get(request);
+    // the certificate of the stand-in is self-signed
+    connect(reply, &QNetworkReply::sslErrors, reply, [reply]() {
+        reply->ignoreSslErrors();
+    });
+
+    QSignalSpy finishedSpy(reply, &QNetworkReply::finished);
+    if (!reply->isFinished() && !finishedSpy.wait(10000)) {
+        reply->deleteLater();
+        return nullptr;
+    }
+
+    return reply;
+}
+
+QByteArray TestSynoSslConfig::sessionTicket(const SynoSslConfig& sslConfig)
+{
+    QNetworkRequest request;
+    sslConfig.applySslConfiguration(request);
+    return request.sslConfiguration().sessionTicket();
+}
+
+QByteArray TestSynoSslConfig::reloadSessionTicket(SynoSslConfig* sslConfig)
+{
+    // the load finishes at once if the keychain fails
+    QSignalSpy loadedSpy(sslConfig, &SynoSslConfig::sessionLoaded);
+    sslConfig->loadSessionFromStorage();
+    if (loadedSpy.isEmpty() && !loadedSpy.wait(5000)) {
+        return QByteArray();
+    }
+
+    return sessionTicket(*sslConfig);
+}
+
+bool TestSynoSslConfig::isServerListening() const
+{
+    QTcpSocket socket;
+    socket.connectToHost(QHostAddress::LocalHost, m_port);
+    return socket.waitForConnected(100);
+}
+
+QTEST_GUILESS_MAIN(TestSynoSslConfig)
+
+#include "tst_synosslconfig.moc"